@@ -0,0 +1,68 @@
+#include <BootProfiler.hpp>
+#include <MqttLog.hpp>
+#include <MqttManager.hpp>
+#include <NSPMConfig.h>
+#include <esp_timer.h>
+#include <string.h>
+
+void BootProfiler::mark(const char *name) {
+  int64_t timestamp = esp_timer_get_time();
+  portENTER_CRITICAL(&BootProfiler::_mux);
+  bool record = !BootProfiler::_complete && BootProfiler::_numberOfMilestones < BOOT_PROFILER_MAX_MILESTONES;
+  for (uint8_t i = 0; i < BootProfiler::_numberOfMilestones && record; i++) {
+    if (strcmp(BootProfiler::_milestones[i].name, name) == 0) {
+      record = false;
+    }
+  }
+  if (record) {
+    BootProfiler::_milestones[BootProfiler::_numberOfMilestones].name = name;
+    BootProfiler::_milestones[BootProfiler::_numberOfMilestones].timestamp_us = timestamp;
+    BootProfiler::_numberOfMilestones++;
+  }
+  portEXIT_CRITICAL(&BootProfiler::_mux);
+}
+
+void BootProfiler::complete(const char *name) {
+  BootProfiler::mark(name);
+  portENTER_CRITICAL(&BootProfiler::_mux);
+  bool was_complete = BootProfiler::_complete;
+  BootProfiler::_complete = true;
+  portEXIT_CRITICAL(&BootProfiler::_mux);
+  if (!was_complete) {
+    LOG_INFO("Boot completed in ", (uint32_t)(BootProfiler::_milestones[BootProfiler::_numberOfMilestones - 1].timestamp_us / 1000), " ms.");
+  }
+}
+
+bool BootProfiler::isComplete() {
+  return BootProfiler::_complete;
+}
+
+void BootProfiler::publishIfComplete() {
+  if (!BootProfiler::_complete || BootProfiler::_published) {
+    return;
+  }
+
+  JsonDocument doc;
+  BootProfiler::toJson(doc.to<JsonObject>());
+  std::string payload;
+  serializeJson(doc, payload);
+  if (MqttManager::publish(NSPMConfig::instance->mqtt_panel_boot_timeline_topic, payload, true)) {
+    BootProfiler::_published = true;
+  }
+}
+
+void BootProfiler::toJson(JsonObject timeline) {
+  // Milestones are only ever appended, copy the count and read the entries before it without holding the lock
+  portENTER_CRITICAL(&BootProfiler::_mux);
+  uint8_t numberOfMilestones = BootProfiler::_numberOfMilestones;
+  bool complete = BootProfiler::_complete;
+  portEXIT_CRITICAL(&BootProfiler::_mux);
+
+  timeline["complete"] = complete;
+  JsonArray milestones = timeline["milestones"].to<JsonArray>();
+  for (uint8_t i = 0; i < numberOfMilestones; i++) {
+    JsonObject milestone = milestones.add<JsonObject>();
+    milestone["name"] = BootProfiler::_milestones[i].name;
+    milestone["us"] = BootProfiler::_milestones[i].timestamp_us;
+  }
+}
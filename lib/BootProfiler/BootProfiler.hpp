@@ -0,0 +1,42 @@
+#ifndef BOOT_PROFILER_HPP
+#define BOOT_PROFILER_HPP
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Maximum number of milestones recorded during one boot, later milestones are dropped
+#define BOOT_PROFILER_MAX_MILESTONES 32
+
+/// @brief Records named milestones with microsecond timestamps from reset until the home page is shown. The timeline is
+/// @brief published once over MQTT when boot has completed and can be fetched from the web interface at /boot_timeline.
+class BootProfiler {
+public:
+  /// @brief Record a milestone. Only the first time a milestone is reached is recorded and nothing is recorded after boot has completed.
+  /// @param name Name of the milestone, must be a string literal as only the pointer is kept
+  static void mark(const char *name);
+  /// @brief Record the final milestone and mark boot as complete
+  /// @param name Name of the final milestone, must be a string literal
+  static void complete(const char *name);
+  /// @brief Has boot completed
+  static bool isComplete();
+  /// @brief Publish the timeline to MQTT if boot has completed and it has not yet been published. Call when connected to MQTT.
+  static void publishIfComplete();
+  /// @brief Serialize the timeline, milestones in the order they were reached with microseconds since reset
+  /// @param timeline The object to add the timeline to
+  static void toJson(JsonObject timeline);
+
+private:
+  struct Milestone {
+    const char *name;
+    int64_t timestamp_us;
+  };
+
+  static inline Milestone _milestones[BOOT_PROFILER_MAX_MILESTONES];
+  static inline uint8_t _numberOfMilestones = 0;
+  static inline bool _complete = false;
+  static inline bool _published = false;
+  /// @brief Milestones are recorded from several tasks
+  static inline portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <MqttManager.hpp>
 #include <NSPMConfig.h>
 #include <PageManager.hpp>
+#include <RoomManager.hpp>
 
 void ButtonManager::init() {
   // TODO: Read button state via interupts instead of polling
@@ -85,20 +86,8 @@ void ButtonManager::_processButtonStateChange(uint8_t button, bool new_state) {
       }
     } else if (NSPMConfig::instance->button1_mode == BUTTON_MODE::FOLLOW) {
       ButtonManager::setRelayState(1, new_state);
-    } else if (NSPMConfig::instance->button1_mode == BUTTON_MODE::DETACHED && ButtonManager::button1_detached_mode_light != nullptr && new_state) {
-      LOG_DEBUG("Button 1 pressed, detached light: ", ButtonManager::button1_detached_mode_light->getName().c_str());
-      std::list<Light *> lightsToChange;
-      lightsToChange.push_back(ButtonManager::button1_detached_mode_light);
-      if (ButtonManager::button1_detached_mode_light->getLightLevel() == 0) {
-        int dim_to_level = PageManager::GetHomePage()->getDimmingValue();
-        if (dim_to_level == 0) {
-          LOG_INFO("Trying to turn on a light but the current average room level is 0. Defaulting to 50%");
-          dim_to_level = 50;
-        }
-        LightManager::ChangeLightsToLevel(&lightsToChange, dim_to_level);
-      } else {
-        LightManager::ChangeLightsToLevel(&lightsToChange, 0);
-      }
+    } else if (NSPMConfig::instance->button1_mode == BUTTON_MODE::DETACHED && ButtonManager::button1_detached_mode_light_id >= 0 && new_state) {
+      ButtonManager::_toggleDetachedModeLight(1, ButtonManager::button1_detached_mode_light_id);
     } else if (NSPMConfig::instance->button1_mode == BUTTON_MODE::CUSTOM_MQTT && new_state) {
       MqttManager::publish(NSPMConfig::instance->button1_mqtt_topic, NSPMConfig::instance->button1_mqtt_payload);
     }
@@ -111,26 +100,36 @@ void ButtonManager::_processButtonStateChange(uint8_t button, bool new_state) {
       }
     } else if (NSPMConfig::instance->button2_mode == BUTTON_MODE::FOLLOW) {
       ButtonManager::setRelayState(2, new_state);
-    } else if (NSPMConfig::instance->button2_mode == BUTTON_MODE::DETACHED && ButtonManager::button2_detached_mode_light != nullptr && new_state) {
-      LOG_DEBUG("Button 2 pressed, detached light: ", ButtonManager::button2_detached_mode_light->getName().c_str());
-      std::list<Light *> lightsToChange;
-      lightsToChange.push_back(ButtonManager::button2_detached_mode_light);
-      if (ButtonManager::button2_detached_mode_light->getLightLevel() == 0) {
-        int dim_to_level = PageManager::GetHomePage()->getDimmingValue();
-        if (dim_to_level == 0) {
-          LOG_INFO("Trying to turn on a light but the current average room level is 0. Defaulting to 50%");
-          dim_to_level = 50;
-        }
-        LightManager::ChangeLightsToLevel(&lightsToChange, dim_to_level);
-      } else {
-        LightManager::ChangeLightsToLevel(&lightsToChange, 0);
-      }
+    } else if (NSPMConfig::instance->button2_mode == BUTTON_MODE::DETACHED && ButtonManager::button2_detached_mode_light_id >= 0 && new_state) {
+      ButtonManager::_toggleDetachedModeLight(2, ButtonManager::button2_detached_mode_light_id);
     } else if (NSPMConfig::instance->button2_mode == BUTTON_MODE::CUSTOM_MQTT && new_state) {
       MqttManager::publish(NSPMConfig::instance->button2_mqtt_topic, NSPMConfig::instance->button2_mqtt_payload);
     }
   }
 }
 
+void ButtonManager::_toggleDetachedModeLight(uint8_t button, int32_t light_id) {
+  RoomModelSnapshot rooms;
+  Light *light = LightManager::getLightById(light_id);
+  if (light == nullptr) {
+    LOG_ERROR("Couldn't find button ", button, " detached mode light with ID: ", light_id);
+    return;
+  }
+  LOG_DEBUG("Button ", button, " pressed, detached light: ", light->getName().c_str());
+  std::list<Light *> lightsToChange;
+  lightsToChange.push_back(light);
+  if (light->getLightLevel() == 0) {
+    int dim_to_level = PageManager::GetHomePage()->getDimmingValue();
+    if (dim_to_level == 0) {
+      LOG_INFO("Trying to turn on a light but the current average room level is 0. Defaulting to 50%");
+      dim_to_level = 50;
+    }
+    LightManager::ChangeLightsToLevel(&lightsToChange, dim_to_level);
+  } else {
+    LightManager::ChangeLightsToLevel(&lightsToChange, 0);
+  }
+}
+
 void ButtonManager::_loop(void *param) {
   LOG_DEBUG("Started ButtonManager _loop.");
 
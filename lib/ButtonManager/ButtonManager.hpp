@@ -15,14 +15,18 @@ class ButtonManager {
 public:
   static void init();
   static void mqttCallback(char *topic, byte *payload, unsigned int length);
-  static inline Light *button1_detached_mode_light;
-  static inline Light *button2_detached_mode_light;
+  /// @brief ID of the light toggled by button 1 in detached mode, -1 if none. Looked up on each press as a reload may replace the light.
+  static inline int32_t button1_detached_mode_light_id = -1;
+  /// @brief ID of the light toggled by button 2 in detached mode, -1 if none
+  static inline int32_t button2_detached_mode_light_id = -1;
   static void setRelayState(uint8_t relay, bool state);
 
 private:
   static void _loop(void *param);
   static inline TaskHandle_t _loop_task_handle;
   static void _processButtonStateChange(uint8_t button, bool new_state);
+  /// @brief Turn the detached mode light off if on, otherwise on to the current dimming level
+  static void _toggleDetachedModeLight(uint8_t button, int32_t light_id);
 
   static void button1_state_change();
   static void button2_state_change();
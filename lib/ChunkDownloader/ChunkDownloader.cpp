@@ -1,136 +1,298 @@
 #include <Arduino.h>
 #include <ChunkDownloader.hpp>
 #include <HTTPClient.h>
+#include <HttpClientPool.hpp>
 #include <HttpLib.hpp>
 #include <MqttLog.hpp>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <esp_heap_caps.h>
 #include <string>
 
 ChunkDownloader::ChunkDownloader(std::string address, uint16_t chunk_size, uint8_t download_chunks) {
   this->_address = address;
   this->_chunk_size = chunk_size;
   this->_download_chunks = download_chunks;
+  this->_total_file_size = 0;
+  this->_chunks = nullptr;
+  this->_chunkMemory = nullptr;
+  this->_freeChunks = NULL;
+  this->_filledChunks = NULL;
+  this->_mutexSeek = NULL;
+  this->_taskHandlePrefetch = NULL;
+  this->_stopPrefetch = false;
   this->_current_chunk_position = 0;
+  this->_seek_position = 0;
+  this->_generation = 0;
+  this->_httpClient = nullptr;
+  this->_bytesDownloaded = 0;
+  this->_retries = 0;
+}
+
+ChunkDownloader::~ChunkDownloader() {
+  this->stop();
+  if (this->_chunkMemory != nullptr) {
+    heap_caps_free(this->_chunkMemory);
+  }
+  delete[] this->_chunks;
+  if (this->_freeChunks != NULL) {
+    vQueueDelete(this->_freeChunks);
+  }
+  if (this->_filledChunks != NULL) {
+    vQueueDelete(this->_filledChunks);
+  }
+  if (this->_mutexSeek != NULL) {
+    vSemaphoreDelete(this->_mutexSeek);
+  }
+}
+
+bool ChunkDownloader::start() {
+  if (this->_taskHandlePrefetch != NULL) {
+    return true;
+  }
+
   this->_total_file_size = HttpLib::GetFileSize(this->_address.c_str());
+  if (this->_total_file_size == 0) {
+    LOG_ERROR("Failed to get file size for ", this->_address.c_str());
+    return false;
+  }
+
+  if (this->_chunkMemory == nullptr) {
+    // Keep the pool in PSRAM if available, internal RAM is needed for WiFi buffers
+    size_t pool_size = this->_chunk_size * this->_download_chunks;
+    this->_chunkMemory = (uint8_t *)heap_caps_malloc(pool_size, psramFound() ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT);
+    if (this->_chunkMemory == nullptr) {
+      LOG_ERROR("Failed to allocate ", pool_size, " bytes for chunk pool.");
+      return false;
+    }
+    this->_chunks = new DownloadChunk[this->_download_chunks];
+    this->_freeChunks = xQueueCreate(this->_download_chunks, sizeof(DownloadChunk *));
+    this->_filledChunks = xQueueCreate(this->_download_chunks, sizeof(DownloadChunk *));
+    this->_mutexSeek = xSemaphoreCreateMutex();
+  }
+
+  xQueueReset(this->_freeChunks);
+  xQueueReset(this->_filledChunks);
+  for (int i = 0; i < this->_download_chunks; i++) {
+    DownloadChunk *chunk = &this->_chunks[i];
+    chunk->data = &this->_chunkMemory[i * this->_chunk_size];
+    chunk->size = 0;
+    chunk->location = 0;
+    chunk->generation = 0;
+    xQueueSendToBack(this->_freeChunks, &chunk, 0);
+  }
+
+  this->_current_chunk_position = 0;
+  this->_seek_position = 0;
+  this->_generation++;
+  this->_stopPrefetch = false;
+  if (xTaskCreatePinnedToCore(_taskPrefetch, "taskChunkPrefetch", 6000, this, 1, &this->_taskHandlePrefetch, CONFIG_ARDUINO_RUNNING_CORE) != pdPASS) {
+    LOG_ERROR("Failed to create chunk prefetch task.");
+    this->_taskHandlePrefetch = NULL;
+    return false;
+  }
+  return true;
+}
+
+void ChunkDownloader::stop() {
+  if (this->_taskHandlePrefetch == NULL) {
+    return;
+  }
+  this->_stopPrefetch = true;
+  xTaskNotifyGive(this->_taskHandlePrefetch);
+  while (this->_taskHandlePrefetch != NULL) {
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+  }
 }
 
-bool ChunkDownloader::_downloadChunks() {
-  HTTPClient httpClient;
-  httpClient.begin(this->_address.c_str());
+bool ChunkDownloader::_openStream(uint32_t position) {
+  this->_closeStream(false);
+  this->_httpClient = HttpClientPool::acquire(this->_address.c_str());
 
   std::string rangeHeader = "bytes=";
-  rangeHeader.append(std::to_string(this->_current_chunk_position));
+  rangeHeader.append(std::to_string(position));
   rangeHeader.append("-");
-  rangeHeader.append(std::to_string(this->_current_chunk_position + (this->_chunk_size * this->_download_chunks)));
-  httpClient.addHeader("Range", rangeHeader.c_str());
-  rangeHeader.clear();
-
-  int httpReturnCode = httpClient.GET();
-  // LOG_TRACE("Downloading TFT ", rangeHeader.c_str(), " got return code: ", httpReturnCode);
-  if (httpReturnCode != 200 && httpReturnCode != 206) {
-    httpClient.end();
-    LOG_ERROR("Failed to retrive file chunk. Got code: ", httpReturnCode);
+  this->_httpClient->addHeader("Range", rangeHeader.c_str());
+  const char *header_names[] = {"Content-Range"};
+  this->_httpClient->collectHeaders(header_names, 1);
+
+  int httpReturnCode = this->_httpClient->GET();
+  if (httpReturnCode != 206 && !(httpReturnCode == 200 && position == 0)) {
+    LOG_ERROR("Failed to open stream from ", position, ". Got code: ", httpReturnCode);
+    this->_closeStream(false);
     return false;
   }
 
-  uint8_t num_failed_reads = 0;
-  uint read_chunks = 0;
-  while (read_chunks < this->_download_chunks) {
-    if (!httpClient.getStreamPtr()->available()) { // No data avilable from WiFi, wait 1000ms and try again
-      vTaskDelay(500 / portTICK_PERIOD_MS);
-      num_failed_reads++;
+  size_t range_start, range_end, range_total;
+  if (httpReturnCode == 206 && (!HttpClientPool::parseContentRange(this->_httpClient->header("Content-Range"), &range_start, &range_end, &range_total) || range_start != position)) {
+    LOG_ERROR("Got unexpected Content-Range '", this->_httpClient->header("Content-Range").c_str(), "' when opening stream from ", position, ".");
+    this->_closeStream(false);
+    return false;
+  }
+  return true;
+}
+
+void ChunkDownloader::_closeStream(bool read_to_end) {
+  if (this->_httpClient != nullptr) {
+    HttpClientPool::release(this->_httpClient, read_to_end);
+    this->_httpClient = nullptr;
+  }
+}
 
-      if (num_failed_reads >= 10) {
+bool ChunkDownloader::_fillChunk(DownloadChunk *chunk, uint32_t position, uint32_t generation) {
+  size_t chunk_size = this->_total_file_size - position;
+  if (chunk_size > this->_chunk_size) {
+    chunk_size = this->_chunk_size;
+  }
+
+  WiFiClient *stream = this->_httpClient->getStreamPtr();
+  size_t num_read_bytes = 0;
+  unsigned long last_data_received = millis();
+  while (num_read_bytes < chunk_size) {
+    if (this->_stopPrefetch || this->_generation != generation) {
+      return false;
+    }
+    size_t available = stream->available();
+    if (available == 0) {
+      if (millis() - last_data_received >= CHUNK_DOWNLOADER_STALL_TIMEOUT_MS || !stream->connected()) {
+        LOG_ERROR("Stream stalled at position ", position + num_read_bytes, ".");
         return false;
       }
+      vTaskDelay(5 / portTICK_PERIOD_MS);
       continue;
     }
+    // Short reads are expected, always continue where the last read stopped.
+    size_t read_size = chunk_size - num_read_bytes;
+    if (read_size > available) {
+      read_size = available;
+    }
+    size_t read = stream->readBytes(&chunk->data[num_read_bytes], read_size);
+    num_read_bytes += read;
+    this->_bytesDownloaded += read;
+    last_data_received = millis();
+  }
+
+  chunk->location = position;
+  chunk->size = num_read_bytes;
+  chunk->generation = generation;
+  return true;
+}
+
+void ChunkDownloader::_taskPrefetch(void *param) {
+  ChunkDownloader *downloader = (ChunkDownloader *)param;
+  uint32_t generation = 0;
+  uint32_t position = 0;
+  bool stream_open = false;
+  DownloadChunk *chunk = nullptr;
 
-    size_t next_read_chunk_size = this->_total_file_size - this->_current_chunk_position;
-    if (next_read_chunk_size > this->_chunk_size) {
-      next_read_chunk_size = this->_chunk_size;
+  while (!downloader->_stopPrefetch) {
+    if (chunk == nullptr && xQueueReceive(downloader->_freeChunks, &chunk, 100 / portTICK_PERIOD_MS) != pdTRUE) {
+      continue;
     }
-    if (next_read_chunk_size <= 0) {
-      // We have reached the end of the remote file, break.
-      break;
+
+    xSemaphoreTake(downloader->_mutexSeek, portMAX_DELAY);
+    if (downloader->_generation != generation) {
+      generation = downloader->_generation;
+      position = downloader->_seek_position;
+      if (stream_open) {
+        // The rest of the old stream is never read, don't reuse the connection
+        downloader->_closeStream(false);
+        stream_open = false;
+      }
     }
-    DownloadChunk *chunk = new DownloadChunk();
-    chunk->data = new uint8_t[next_read_chunk_size];
-    chunk->location = this->_current_chunk_position;
-    uint16_t num_read_bytes = 0;
-    while (num_read_bytes < next_read_chunk_size) {
-      while (httpClient.getStreamPtr()->available() <= 0) {
-        vTaskDelay(500 / portTICK_PERIOD_MS);
-        num_failed_reads++;
-        if (num_failed_reads >= 10) {
-          // We have had 10 failed reads in a row for a total of 2.5 seconds, cancel this request and try again.
-          this->_clearChunk(chunk);
-          return false;
-        }
+    xSemaphoreGive(downloader->_mutexSeek);
+
+    if (position >= downloader->_total_file_size) {
+      // Everything has been downloaded, wait for a seek or stop. The stream was read to the end and the connection can be reused.
+      downloader->_closeStream(stream_open);
+      stream_open = false;
+      ulTaskNotifyTake(pdTRUE, 100 / portTICK_PERIOD_MS);
+      continue;
+    }
+
+    if (!stream_open) {
+      stream_open = downloader->_openStream(position);
+      if (!stream_open) {
+        downloader->_retries++;
+        vTaskDelay(250 / portTICK_PERIOD_MS);
+        continue;
       }
-      num_read_bytes += httpClient.getStreamPtr()->readBytes(chunk->data, next_read_chunk_size);
     }
-    chunk->size = num_read_bytes;
-    this->_current_chunk_position += chunk->size;
-    this->_chunks.push_back(chunk);
-    read_chunks++;
+
+    if (downloader->_fillChunk(chunk, position, generation)) {
+      position += chunk->size;
+      xQueueSendToBack(downloader->_filledChunks, &chunk, portMAX_DELAY);
+      chunk = nullptr;
+    } else if (downloader->_generation == generation && !downloader->_stopPrefetch) {
+      // The stream failed, not a seek. Reopen from the same position.
+      downloader->_retries++;
+      stream_open = false;
+    }
   }
-  httpClient.end();
-  return true;
+
+  if (chunk != nullptr) {
+    xQueueSendToBack(downloader->_freeChunks, &chunk, 0);
+  }
+  downloader->_closeStream(false);
+  downloader->_taskHandlePrefetch = NULL;
+  vTaskDelete(NULL);
 }
 
 void ChunkDownloader::seek(uint32_t _seek_position) {
-  this->_clearDownloadedChunks();
+  if (_seek_position == this->_current_chunk_position) {
+    // Already downloading from here, keep what has been prefetched
+    return;
+  }
+  xSemaphoreTake(this->_mutexSeek, portMAX_DELAY);
+  this->_generation++;
+  this->_seek_position = _seek_position;
   this->_current_chunk_position = _seek_position;
+  xSemaphoreGive(this->_mutexSeek);
+  if (this->_taskHandlePrefetch != NULL) {
+    xTaskNotifyGive(this->_taskHandlePrefetch);
+  }
   LOG_DEBUG("Seeking to position: ", this->_current_chunk_position);
 }
 
-uint16_t ChunkDownloader::readNextChunk(uint8_t *buffer) {
-  if (this->_chunks.size() <= 0) {
-    while (!this->_downloadChunks()) {
-      LOG_ERROR("Failed to download any chunks, will try again.");
-      vTaskDelay(500 / portTICK_PERIOD_MS);
-    }
-  }
-  if (this->_chunks.size() > 0) {
-    DownloadChunk *chunk = this->_chunks.front();
-    memcpy(buffer, chunk->data, chunk->size);
-    uint16_t return_size = this->_chunks.front()->size;
-    this->_chunks.erase(this->_chunks.begin());
-    this->_clearChunk(chunk);
-    return return_size;
-  } else {
+uint16_t ChunkDownloader::readNextChunk(uint8_t *buffer, uint32_t timeout_ms) {
+  if (this->_current_chunk_position >= this->_total_file_size) {
     return 0;
   }
-}
 
-void ChunkDownloader::_clearDownloadedChunks() {
-  for (auto it = this->_chunks.cbegin(); it != this->_chunks.cend();) {
-    DownloadChunk *chunkToRm = *it;
-    it = this->_chunks.erase(it);
-    this->_clearChunk(chunkToRm);
+  unsigned long start_wait = millis();
+  DownloadChunk *chunk;
+  while (millis() - start_wait < timeout_ms) {
+    if (xQueueReceive(this->_filledChunks, &chunk, 100 / portTICK_PERIOD_MS) != pdTRUE) {
+      continue;
+    }
+    if (chunk->generation != this->_generation || chunk->location != this->_current_chunk_position) {
+      // Downloaded before a seek, discard
+      xQueueSendToBack(this->_freeChunks, &chunk, 0);
+      continue;
+    }
+    uint16_t return_size = chunk->size;
+    memcpy(buffer, chunk->data, return_size);
+    this->_current_chunk_position += return_size;
+    xQueueSendToBack(this->_freeChunks, &chunk, 0);
+    return return_size;
   }
-}
-
-void ChunkDownloader::_clearChunk(DownloadChunk *chunk) {
-  delete chunk->data;
-  delete chunk;
+  LOG_ERROR("Timeout while waiting for chunk at position ", this->_current_chunk_position);
+  return 0;
 }
 
 uint32_t ChunkDownloader::getCurrentChunkPosition() {
-  if (this->_chunks.size() <= 0) {
-    this->_downloadChunks();
-  }
-  if (this->_chunks.size() > 0) {
-    DownloadChunk *chunk = this->_chunks.front();
-    return chunk->location;
-  } else {
-    return 0;
-  }
+  return this->_current_chunk_position;
 }
 
 size_t ChunkDownloader::getTotalFileSize() {
   return this->_total_file_size;
 }
+
+uint32_t ChunkDownloader::getBytesDownloaded() {
+  return this->_bytesDownloaded;
+}
+
+uint16_t ChunkDownloader::getRetries() {
+  return this->_retries;
+}
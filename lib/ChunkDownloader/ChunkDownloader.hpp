@@ -1,35 +1,93 @@
-#include <cstdint>
-#include <list>
 #ifndef CHUNK_DOWNLOADER_HPP
-#include <inttypes.h>
+#define CHUNK_DOWNLOADER_HPP
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <cstdint>
 #include <string>
 
+// Time without any data from the manager before the prefetch task reopens the stream
+#define CHUNK_DOWNLOADER_STALL_TIMEOUT_MS 5000
+
+/// @brief Downloads a remote file in fixed size chunks. A background task keeps a fixed pool of chunk buffers
+/// @brief (in PSRAM when available) filled ahead of the consumer from one ranged HTTP stream.
 class ChunkDownloader {
 public:
   struct DownloadChunk {
+    /// @brief Position in the file of the first byte in data
     uint32_t location;
+    /// @brief Number of valid bytes in data
     uint16_t size;
+    /// @brief The chunk buffer, chunk_size bytes
     uint8_t *data;
+    /// @brief The seek generation the chunk was downloaded for, chunks from an older generation are discarded
+    uint32_t generation;
   };
 
+  /// @brief Create a new downloader, no memory is allocated and nothing is downloaded until start() is called
+  /// @param address The address of the file to download
+  /// @param chunk_size Size of each chunk returned by readNextChunk
+  /// @param download_chunks Number of chunk buffers in the pool, ie. how far ahead of the consumer to download
   ChunkDownloader(std::string address, uint16_t chunk_size, uint8_t download_chunks);
   ~ChunkDownloader();
+  /// @brief Get the file size, allocate the chunk pool and start downloading from position 0
+  /// @return True if successful
+  bool start();
+  /// @brief Stop downloading and wait for the prefetch task to exit
+  void stop();
+  /// @brief The position in the file of the next chunk returned by readNextChunk
   uint32_t getCurrentChunkPosition();
   size_t getTotalFileSize();
+  /// @brief Continue downloading from another position. Chunks already downloaded are discarded unless the position is where the next chunk starts.
+  /// @param chunk_location The position in the file to continue from
   void seek(uint32_t chunk_location);
-  uint16_t readNextChunk(uint8_t *buffer);
+  /// @brief Copy the next chunk into buffer
+  /// @param buffer Buffer of at least chunk_size bytes
+  /// @param timeout_ms Maximum time to wait for the chunk to be downloaded
+  /// @return Number of bytes copied, 0 at the end of the file or on timeout
+  uint16_t readNextChunk(uint8_t *buffer, uint32_t timeout_ms = 30000);
+  /// @brief Total number of bytes received from the manager, including data discarded because of seeks
+  uint32_t getBytesDownloaded();
+  /// @brief Number of times the stream had to be reopened because of an error or a stall
+  uint16_t getRetries();
 
 private:
+  static void _taskPrefetch(void *param);
+  /// @brief Open a ranged stream from the given position
+  /// @return True if the manager returned data
+  bool _openStream(uint32_t position);
+  /// @brief Return the stream client to the HTTP client pool
+  /// @param read_to_end True if the whole response has been read and the connection can be reused
+  void _closeStream(bool read_to_end);
+  /// @brief Fill a chunk from the open stream
+  /// @return True if the chunk was filled, false if the stream failed or a seek happened while filling
+  bool _fillChunk(DownloadChunk *chunk, uint32_t position, uint32_t generation);
+
   uint16_t _chunk_size;
   uint8_t _download_chunks;
-  uint32_t _current_chunk_position;
   size_t _total_file_size;
   std::string _address;
-  std::list<DownloadChunk *> _chunks;
+  DownloadChunk *_chunks;
+  uint8_t *_chunkMemory;
+  /// @brief Chunks that can be filled by the prefetch task
+  QueueHandle_t _freeChunks;
+  /// @brief Chunks filled with data, waiting to be read
+  QueueHandle_t _filledChunks;
+  /// @brief Protects _generation and _seek_position
+  SemaphoreHandle_t _mutexSeek;
+  TaskHandle_t _taskHandlePrefetch;
+  bool _stopPrefetch;
+
+  /// @brief The position of the next chunk returned to the consumer
+  uint32_t _current_chunk_position;
+  /// @brief Where the prefetch task should continue from, only valid for _generation
+  uint32_t _seek_position;
+  /// @brief Incremented for each seek so that chunks downloaded before the seek can be discarded
+  uint32_t _generation;
 
-  bool _downloadChunks();
-  void _clearDownloadedChunks();
-  void _clearChunk(DownloadChunk *chunk);
+  HTTPClient *_httpClient;
+  uint32_t _bytesDownloaded;
+  uint16_t _retries;
 };
 
 #endif // !CHUNK_DOWNLOADER_HPP
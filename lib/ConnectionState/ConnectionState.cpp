@@ -0,0 +1,59 @@
+#include <ConnectionState.hpp>
+
+void ConnectionState::init() {
+  if (ConnectionState::_eventGroup == NULL) {
+    ConnectionState::_eventGroup = xEventGroupCreate();
+  }
+}
+
+void ConnectionState::set(EventBits_t bits) {
+  xEventGroupSetBits(ConnectionState::_eventGroup, bits);
+}
+
+void ConnectionState::clear(EventBits_t bits) {
+  xEventGroupClearBits(ConnectionState::_eventGroup, bits);
+}
+
+bool ConnectionState::isSet(EventBits_t bits) {
+  return (xEventGroupGetBits(ConnectionState::_eventGroup) & bits) == bits;
+}
+
+bool ConnectionState::waitFor(EventBits_t bits, TickType_t timeout) {
+  return (xEventGroupWaitBits(ConnectionState::_eventGroup, bits, pdFALSE, pdTRUE, timeout) & bits) == bits;
+}
+
+ConnectionStage ConnectionState::getStage() {
+  EventBits_t bits = xEventGroupGetBits(ConnectionState::_eventGroup);
+  if (!(bits & CONNECTION_STATE_WIFI_CONNECTED)) {
+    return ConnectionStage::CONNECTING_WIFI;
+  } else if (!(bits & CONNECTION_STATE_MQTT_CONNECTED)) {
+    return ConnectionStage::CONNECTING_MQTT;
+  } else if (!(bits & CONNECTION_STATE_REGISTERED)) {
+    return ConnectionStage::REGISTERING;
+  } else if (!(bits & CONNECTION_STATE_CONFIG_LOADED)) {
+    return ConnectionStage::LOADING_CONFIG;
+  }
+  return ConnectionStage::READY;
+}
+
+ConnectionStage ConnectionState::waitForNextStage(TickType_t timeout) {
+  ConnectionStage stage = ConnectionState::getStage();
+  switch (stage) {
+  case ConnectionStage::CONNECTING_WIFI:
+    ConnectionState::waitFor(CONNECTION_STATE_WIFI_CONNECTED, timeout);
+    break;
+  case ConnectionStage::CONNECTING_MQTT:
+    ConnectionState::waitFor(CONNECTION_STATE_MQTT_CONNECTED, timeout);
+    break;
+  case ConnectionStage::REGISTERING:
+    ConnectionState::waitFor(CONNECTION_STATE_REGISTERED, timeout);
+    break;
+  case ConnectionStage::LOADING_CONFIG:
+    ConnectionState::waitFor(CONNECTION_STATE_CONFIG_LOADED, timeout);
+    break;
+  default:
+    vTaskDelay(timeout);
+    break;
+  }
+  return ConnectionState::getStage();
+}
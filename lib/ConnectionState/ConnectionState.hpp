@@ -0,0 +1,52 @@
+#ifndef CONNECTION_STATE_HPP
+#define CONNECTION_STATE_HPP
+
+#include <Arduino.h>
+#include <freertos/event_groups.h>
+
+// Each stage of getting the panel online, in the order they are reached
+#define CONNECTION_STATE_WIFI_CONNECTED BIT0
+#define CONNECTION_STATE_MQTT_CONNECTED BIT1
+#define CONNECTION_STATE_REGISTERED BIT2
+#define CONNECTION_STATE_CONFIG_LOADED BIT3
+#define CONNECTION_STATE_ALL_STAGES (CONNECTION_STATE_WIFI_CONNECTED | CONNECTION_STATE_MQTT_CONNECTED | CONNECTION_STATE_REGISTERED | CONNECTION_STATE_CONFIG_LOADED)
+// The display has been initialised and the interface started, done in parallel with the stages above
+#define CONNECTION_STATE_PANEL_INITIALISED BIT4
+// The manager address is known, saved from the last boot, discovered with mDNS or from register accept
+#define CONNECTION_STATE_MANAGER_KNOWN BIT5
+
+enum ConnectionStage {
+  CONNECTING_WIFI,
+  CONNECTING_MQTT,
+  REGISTERING,
+  LOADING_CONFIG,
+  READY
+};
+
+/// @brief Connectivity and boot state shared between tasks, kept in a FreeRTOS event group. Each stage is set by the event that
+/// @brief completes it (WiFi got IP, MQTT connected, register accept, config loaded) and tasks waiting for that stage are woken
+/// @brief immediately instead of polling. Registered and config loaded are kept when WiFi or MQTT drops and reconnects.
+class ConnectionState {
+public:
+  /// @brief Create the event group, call before any task uses ConnectionState
+  static void init();
+  /// @brief Mark one or more stages as reached
+  static void set(EventBits_t bits);
+  /// @brief Mark one or more stages as lost
+  static void clear(EventBits_t bits);
+  /// @brief Are all the given stages reached
+  static bool isSet(EventBits_t bits);
+  /// @brief Wait until all the given stages are reached
+  /// @return True if reached, false on timeout
+  static bool waitFor(EventBits_t bits, TickType_t timeout);
+  /// @brief The first stage not yet reached
+  static ConnectionStage getStage();
+  /// @brief Wait until the current stage is completed
+  /// @return The stage after waiting
+  static ConnectionStage waitForNextStage(TickType_t timeout);
+
+private:
+  static inline EventGroupHandle_t _eventGroup = NULL;
+};
+
+#endif
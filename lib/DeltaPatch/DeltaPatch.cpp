@@ -0,0 +1,191 @@
+#include <DeltaPatch.hpp>
+#include <cstring>
+
+#define DELTA_PATCH_OP_END 0x00
+#define DELTA_PATCH_OP_COPY 0x01
+#define DELTA_PATCH_OP_INSERT 0x02
+
+DeltaPatch::DeltaPatch(bool (*read_source)(void *context, uint32_t offset, uint8_t *buffer, size_t size), void *context) {
+  this->_readSource = read_source;
+  this->_context = context;
+  this->_state = HEADER;
+  this->_headerLength = 0;
+  this->_op = 0;
+  this->_argumentsLength = 0;
+  this->_argumentsNeeded = 0;
+  this->_sourceSize = 0;
+  this->_targetSize = 0;
+  this->_copyOffset = 0;
+  this->_remaining = 0;
+  this->_totalOutput = 0;
+}
+
+uint32_t DeltaPatch::_readUInt32(const uint8_t *data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+void DeltaPatch::_toHex(const uint8_t *data, char *buffer) {
+  const char *hex = "0123456789abcdef";
+  for (int i = 0; i < 16; i++) {
+    buffer[i * 2] = hex[data[i] >> 4];
+    buffer[i * 2 + 1] = hex[data[i] & 0x0F];
+  }
+  buffer[32] = '\0';
+}
+
+size_t DeltaPatch::apply(const uint8_t *input, size_t input_size, size_t *input_consumed, uint8_t *output, size_t output_size) {
+  size_t input_index = 0;
+  size_t output_written = 0;
+
+  while (this->_state != FINISHED && this->_state != ERROR) {
+    switch (this->_state) {
+    case HEADER: {
+      size_t copy_size = DELTA_PATCH_HEADER_SIZE - this->_headerLength;
+      if (copy_size > input_size - input_index) {
+        copy_size = input_size - input_index;
+      }
+      memcpy(&this->_header[this->_headerLength], &input[input_index], copy_size);
+      this->_headerLength += copy_size;
+      input_index += copy_size;
+      if (this->_headerLength < DELTA_PATCH_HEADER_SIZE) {
+        *input_consumed = input_index;
+        return output_written;
+      }
+      if (memcmp(this->_header, DELTA_PATCH_MAGIC, 4) != 0 || this->_header[4] != DELTA_PATCH_VERSION) {
+        this->_state = ERROR;
+        break;
+      }
+      this->_sourceSize = DeltaPatch::_readUInt32(&this->_header[8]);
+      this->_targetSize = DeltaPatch::_readUInt32(&this->_header[12]);
+      this->_state = OP;
+      // Return so that the caller can verify the header before any output is produced
+      *input_consumed = input_index;
+      return output_written;
+    }
+    case OP:
+      if (input_index >= input_size) {
+        *input_consumed = input_index;
+        return output_written;
+      }
+      this->_op = input[input_index++];
+      this->_argumentsLength = 0;
+      if (this->_op == DELTA_PATCH_OP_END) {
+        this->_state = this->_totalOutput == this->_targetSize ? FINISHED : ERROR;
+      } else if (this->_op == DELTA_PATCH_OP_COPY) {
+        this->_argumentsNeeded = 8;
+        this->_state = OP_ARGUMENTS;
+      } else if (this->_op == DELTA_PATCH_OP_INSERT) {
+        this->_argumentsNeeded = 4;
+        this->_state = OP_ARGUMENTS;
+      } else {
+        this->_state = ERROR;
+      }
+      break;
+    case OP_ARGUMENTS:
+      while (this->_argumentsLength < this->_argumentsNeeded && input_index < input_size) {
+        this->_arguments[this->_argumentsLength++] = input[input_index++];
+      }
+      if (this->_argumentsLength < this->_argumentsNeeded) {
+        *input_consumed = input_index;
+        return output_written;
+      }
+      if (this->_op == DELTA_PATCH_OP_COPY) {
+        this->_copyOffset = DeltaPatch::_readUInt32(&this->_arguments[0]);
+        this->_remaining = DeltaPatch::_readUInt32(&this->_arguments[4]);
+        if ((uint64_t)this->_copyOffset + this->_remaining > this->_sourceSize) {
+          this->_state = ERROR;
+          break;
+        }
+        this->_state = COPY;
+      } else {
+        this->_remaining = DeltaPatch::_readUInt32(&this->_arguments[0]);
+        this->_state = INSERT;
+      }
+      if ((uint64_t)this->_totalOutput + this->_remaining > this->_targetSize) {
+        this->_state = ERROR;
+      }
+      break;
+    case COPY: {
+      size_t copy_size = output_size - output_written;
+      if (copy_size > this->_remaining) {
+        copy_size = this->_remaining;
+      }
+      if (copy_size > 0 && !this->_readSource(this->_context, this->_copyOffset, &output[output_written], copy_size)) {
+        this->_state = ERROR;
+        break;
+      }
+      output_written += copy_size;
+      this->_copyOffset += copy_size;
+      this->_remaining -= copy_size;
+      this->_totalOutput += copy_size;
+      if (this->_remaining == 0) {
+        this->_state = OP;
+      } else {
+        // Output buffer is full
+        *input_consumed = input_index;
+        return output_written;
+      }
+      break;
+    }
+    case INSERT: {
+      size_t copy_size = output_size - output_written;
+      if (copy_size > this->_remaining) {
+        copy_size = this->_remaining;
+      }
+      if (copy_size > input_size - input_index) {
+        copy_size = input_size - input_index;
+      }
+      memcpy(&output[output_written], &input[input_index], copy_size);
+      input_index += copy_size;
+      output_written += copy_size;
+      this->_remaining -= copy_size;
+      this->_totalOutput += copy_size;
+      if (this->_remaining == 0) {
+        this->_state = OP;
+      } else {
+        // Either output is full or input is consumed
+        *input_consumed = input_index;
+        return output_written;
+      }
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  *input_consumed = input_index;
+  return output_written;
+}
+
+bool DeltaPatch::isHeaderReady() {
+  return this->_state != HEADER && this->_headerLength == DELTA_PATCH_HEADER_SIZE;
+}
+
+bool DeltaPatch::isFinished() {
+  return this->_state == FINISHED;
+}
+
+bool DeltaPatch::hasError() {
+  return this->_state == ERROR;
+}
+
+uint32_t DeltaPatch::getSourceSize() {
+  return this->_sourceSize;
+}
+
+uint32_t DeltaPatch::getTargetSize() {
+  return this->_targetSize;
+}
+
+void DeltaPatch::getSourceMD5(char *buffer) {
+  DeltaPatch::_toHex(&this->_header[16], buffer);
+}
+
+void DeltaPatch::getTargetMD5(char *buffer) {
+  DeltaPatch::_toHex(&this->_header[32], buffer);
+}
+
+uint32_t DeltaPatch::getTotalOutput() {
+  return this->_totalOutput;
+}
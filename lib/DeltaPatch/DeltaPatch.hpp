@@ -0,0 +1,77 @@
+#ifndef DELTA_PATCH_HPP
+#define DELTA_PATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#define DELTA_PATCH_MAGIC "NSPD"
+#define DELTA_PATCH_VERSION 1
+// magic (4) + version (1) + reserved (3) + source size (4) + target size (4) + source MD5 (16) + target MD5 (16)
+#define DELTA_PATCH_HEADER_SIZE 48
+
+/// @brief Streaming decoder for NSPD binary delta patches. All integers are little endian.
+/// @brief After the header the patch is a list of operations, each starting with one op byte:
+/// @brief 0x00 END, 0x01 COPY <u32 source offset> <u32 length>, 0x02 INSERT <u32 length> <data>.
+/// @brief The decoder only depends on plain C++ so that it can be built and verified on the host.
+class DeltaPatch {
+public:
+  /// @brief Create a new decoder
+  /// @param read_source Function to read data from the source (old) image, return false on error
+  /// @param context Passed to read_source
+  DeltaPatch(bool (*read_source)(void *context, uint32_t offset, uint8_t *buffer, size_t size), void *context);
+  /// @brief Decode patch data. Stops when all input is consumed, the output buffer is full or the header has just been read.
+  /// @param input Patch data
+  /// @param input_size Number of bytes in input
+  /// @param input_consumed Will be set to the number of bytes used from input
+  /// @param output Buffer to write the target (new) image to
+  /// @param output_size Size of the output buffer
+  /// @return Number of bytes written to output
+  size_t apply(const uint8_t *input, size_t input_size, size_t *input_consumed, uint8_t *output, size_t output_size);
+  /// @brief True once the header has been read and the sizes and checksums are available
+  bool isHeaderReady();
+  /// @brief True when the END operation has been read
+  bool isFinished();
+  /// @brief True if the patch is malformed or the source could not be read
+  bool hasError();
+  uint32_t getSourceSize();
+  uint32_t getTargetSize();
+  /// @brief Get the MD5 of the source image the patch was made against
+  /// @param buffer Buffer of at least 33 bytes to put the hex string in to
+  void getSourceMD5(char *buffer);
+  /// @brief Get the MD5 of the target image the patch produces
+  /// @param buffer Buffer of at least 33 bytes to put the hex string in to
+  void getTargetMD5(char *buffer);
+  /// @brief Number of target bytes produced so far
+  uint32_t getTotalOutput();
+
+private:
+  enum State {
+    HEADER,
+    OP,
+    OP_ARGUMENTS,
+    COPY,
+    INSERT,
+    FINISHED,
+    ERROR,
+  };
+
+  static uint32_t _readUInt32(const uint8_t *data);
+  static void _toHex(const uint8_t *data, char *buffer);
+
+  bool (*_readSource)(void *context, uint32_t offset, uint8_t *buffer, size_t size);
+  void *_context;
+  State _state;
+  uint8_t _header[DELTA_PATCH_HEADER_SIZE];
+  size_t _headerLength;
+  uint8_t _op;
+  uint8_t _arguments[8];
+  size_t _argumentsLength;
+  size_t _argumentsNeeded;
+  uint32_t _sourceSize;
+  uint32_t _targetSize;
+  uint32_t _copyOffset;
+  uint32_t _remaining;
+  uint32_t _totalOutput;
+};
+
+#endif
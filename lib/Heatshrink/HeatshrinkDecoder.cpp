@@ -0,0 +1,132 @@
+#include <HeatshrinkDecoder.hpp>
+#include <cstring>
+#include <new>
+
+HeatshrinkDecoder::HeatshrinkDecoder(uint8_t window_bits, uint8_t lookahead_bits) {
+  this->_windowBits = window_bits;
+  this->_lookaheadBits = lookahead_bits;
+  this->_window = nullptr;
+  if (window_bits >= HEATSHRINK_MIN_WINDOW_BITS && window_bits <= HEATSHRINK_MAX_WINDOW_BITS && lookahead_bits >= 3 && lookahead_bits < window_bits) {
+    this->_window = new (std::nothrow) uint8_t[1 << window_bits];
+  }
+  this->_windowMask = (1 << window_bits) - 1;
+  this->reset();
+}
+
+HeatshrinkDecoder::~HeatshrinkDecoder() {
+  delete[] this->_window;
+}
+
+bool HeatshrinkDecoder::isValid() {
+  return this->_window != nullptr;
+}
+
+void HeatshrinkDecoder::reset() {
+  if (this->_window != nullptr) {
+    // The compressor treats everything before the start of the stream as zeros
+    memset(this->_window, 0, 1 << this->_windowBits);
+  }
+  this->_head = 0;
+  this->_state = TAG_BIT;
+  this->_input = nullptr;
+  this->_inputSize = 0;
+  this->_inputIndex = 0;
+  this->_currentByte = 0;
+  this->_bitMask = 0;
+  this->_bitAccumulator = 0;
+  this->_bitsAccumulated = 0;
+  this->_backrefIndex = 0;
+  this->_backrefCount = 0;
+  this->_totalOutput = 0;
+}
+
+size_t HeatshrinkDecoder::getTotalOutput() {
+  return this->_totalOutput;
+}
+
+bool HeatshrinkDecoder::_getBits(uint8_t count, uint16_t *value) {
+  while (this->_bitsAccumulated < count) {
+    if (this->_bitMask == 0) {
+      if (this->_inputIndex >= this->_inputSize) {
+        return false;
+      }
+      this->_currentByte = this->_input[this->_inputIndex++];
+      this->_bitMask = 0x80;
+    }
+    this->_bitAccumulator = (this->_bitAccumulator << 1) | ((this->_currentByte & this->_bitMask) ? 1 : 0);
+    this->_bitMask >>= 1;
+    this->_bitsAccumulated++;
+  }
+  *value = this->_bitAccumulator;
+  this->_bitAccumulator = 0;
+  this->_bitsAccumulated = 0;
+  return true;
+}
+
+void HeatshrinkDecoder::_pushByte(uint8_t byte, uint8_t *output, size_t *output_written) {
+  output[(*output_written)++] = byte;
+  this->_window[this->_head & this->_windowMask] = byte;
+  this->_head++;
+  this->_totalOutput++;
+}
+
+size_t HeatshrinkDecoder::decompress(const uint8_t *input, size_t input_size, size_t *input_consumed, uint8_t *output, size_t output_size) {
+  this->_input = input;
+  this->_inputSize = input_size;
+  this->_inputIndex = 0;
+  size_t output_written = 0;
+  if (this->_window == nullptr) {
+    *input_consumed = 0;
+    return 0;
+  }
+
+  uint16_t value;
+  bool done = false;
+  while (!done && output_written < output_size) {
+    switch (this->_state) {
+    case TAG_BIT:
+      if (!this->_getBits(1, &value)) {
+        done = true;
+      } else {
+        this->_state = value ? LITERAL : BACKREF_INDEX;
+      }
+      break;
+    case LITERAL:
+      if (!this->_getBits(8, &value)) {
+        done = true;
+      } else {
+        this->_pushByte(value, output, &output_written);
+        this->_state = TAG_BIT;
+      }
+      break;
+    case BACKREF_INDEX:
+      if (!this->_getBits(this->_windowBits, &value)) {
+        done = true;
+      } else {
+        this->_backrefIndex = value + 1;
+        this->_state = BACKREF_COUNT;
+      }
+      break;
+    case BACKREF_COUNT:
+      if (!this->_getBits(this->_lookaheadBits, &value)) {
+        done = true;
+      } else {
+        this->_backrefCount = value + 1;
+        this->_state = YIELD_BACKREF;
+      }
+      break;
+    case YIELD_BACKREF:
+      while (this->_backrefCount > 0 && output_written < output_size) {
+        this->_pushByte(this->_window[(this->_head - this->_backrefIndex) & this->_windowMask], output, &output_written);
+        this->_backrefCount--;
+      }
+      if (this->_backrefCount == 0) {
+        this->_state = TAG_BIT;
+      }
+      break;
+    }
+  }
+
+  *input_consumed = this->_inputIndex;
+  return output_written;
+}
@@ -0,0 +1,74 @@
+#ifndef HEATSHRINK_DECODER_HPP
+#define HEATSHRINK_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#define HEATSHRINK_DEFAULT_WINDOW_BITS 10
+#define HEATSHRINK_DEFAULT_LOOKAHEAD_BITS 5
+#define HEATSHRINK_MIN_WINDOW_BITS 4
+#define HEATSHRINK_MAX_WINDOW_BITS 15
+
+/// @brief Streaming decoder for data compressed with heatshrink (LZSS). The decoder only depends on plain C++
+/// @brief so that it can be built and verified on the host against uncompressed reference files.
+class HeatshrinkDecoder {
+public:
+  /// @brief Create a decoder with the given parameters, they must match what the data was compressed with
+  /// @param window_bits Base-2 log of the window size (-w when compressing)
+  /// @param lookahead_bits Number of bits used for back-reference counts (-l when compressing)
+  HeatshrinkDecoder(uint8_t window_bits = HEATSHRINK_DEFAULT_WINDOW_BITS, uint8_t lookahead_bits = HEATSHRINK_DEFAULT_LOOKAHEAD_BITS);
+  ~HeatshrinkDecoder();
+  /// @brief Check that the window buffer could be allocated and the parameters are valid
+  /// @return True if the decoder can be used
+  bool isValid();
+  /// @brief Reset the decoder to start decompressing a new stream
+  void reset();
+  /// @brief Decompress data. Stops when either all input has been consumed or the output buffer is full.
+  /// @param input Compressed data
+  /// @param input_size Number of bytes in input
+  /// @param input_consumed Will be set to the number of bytes used from input
+  /// @param output Buffer to write decompressed data to
+  /// @param output_size Size of the output buffer
+  /// @return Number of decompressed bytes written to output
+  size_t decompress(const uint8_t *input, size_t input_size, size_t *input_consumed, uint8_t *output, size_t output_size);
+  /// @brief Total number of decompressed bytes produced since last reset
+  size_t getTotalOutput();
+
+private:
+  enum State {
+    TAG_BIT,
+    LITERAL,
+    BACKREF_INDEX,
+    BACKREF_COUNT,
+    YIELD_BACKREF,
+  };
+
+  /// @brief Read bits from the current input, keeps partially read values between calls
+  /// @param count Number of bits to read, max 16
+  /// @param value Where to put the read value
+  /// @return True if all bits were read, false if input ran out
+  bool _getBits(uint8_t count, uint16_t *value);
+  /// @brief Write a byte to output and to the window
+  void _pushByte(uint8_t byte, uint8_t *output, size_t *output_written);
+
+  uint8_t _windowBits;
+  uint8_t _lookaheadBits;
+  uint16_t _windowMask;
+  uint8_t *_window;
+  uint16_t _head;
+  State _state;
+
+  const uint8_t *_input;
+  size_t _inputSize;
+  size_t _inputIndex;
+  uint8_t _currentByte;
+  uint8_t _bitMask;
+  uint16_t _bitAccumulator;
+  uint8_t _bitsAccumulated;
+
+  uint16_t _backrefIndex;
+  uint16_t _backrefCount;
+  size_t _totalOutput;
+};
+
+#endif
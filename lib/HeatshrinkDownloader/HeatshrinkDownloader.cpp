@@ -0,0 +1,148 @@
+#include <HeatshrinkDownloader.hpp>
+#include <HttpClientPool.hpp>
+#include <MqttLog.hpp>
+
+HeatshrinkDownloader::HeatshrinkDownloader(std::string address) {
+  this->_address = address;
+  this->_httpClient = nullptr;
+  this->_stream = nullptr;
+  this->_decoder = nullptr;
+  this->_uncompressedSize = 0;
+  this->_compressedSize = 0;
+  this->_compressedBytesReceived = 0;
+  this->_inputLength = 0;
+  this->_inputOffset = 0;
+  this->_streamFailed = false;
+}
+
+HeatshrinkDownloader::~HeatshrinkDownloader() {
+  this->close();
+}
+
+bool HeatshrinkDownloader::open() {
+  this->close();
+  this->_httpClient = HttpClientPool::acquire(this->_address.c_str());
+  const char *header_names[] = {"Content-Length", "X-Uncompressed-Length", "X-Heatshrink-Window", "X-Heatshrink-Lookahead"};
+  this->_httpClient->collectHeaders(header_names, 4);
+  int httpReturnCode = this->_httpClient->GET();
+  if (httpReturnCode != 200) {
+    LOG_ERROR("Failed to open compressed stream from '", this->_address.c_str(), "'. Got return code: ", httpReturnCode);
+    HttpClientPool::release(this->_httpClient, false);
+    this->_httpClient = nullptr;
+    return false;
+  }
+  if (!this->_httpClient->hasHeader("X-Uncompressed-Length")) {
+    LOG_INFO("Manager did not return a compressed stream from '", this->_address.c_str(), "'.");
+    HttpClientPool::release(this->_httpClient, false);
+    this->_httpClient = nullptr;
+    return false;
+  }
+
+  this->_stream = this->_httpClient->getStreamPtr();
+  this->_uncompressedSize = this->_httpClient->header("X-Uncompressed-Length").toInt();
+  this->_compressedSize = this->_httpClient->header("Content-Length").toInt();
+  uint8_t window_bits = HEATSHRINK_DEFAULT_WINDOW_BITS;
+  uint8_t lookahead_bits = HEATSHRINK_DEFAULT_LOOKAHEAD_BITS;
+  if (this->_httpClient->hasHeader("X-Heatshrink-Window")) {
+    window_bits = this->_httpClient->header("X-Heatshrink-Window").toInt();
+  }
+  if (this->_httpClient->hasHeader("X-Heatshrink-Lookahead")) {
+    lookahead_bits = this->_httpClient->header("X-Heatshrink-Lookahead").toInt();
+  }
+
+  this->_decoder = new HeatshrinkDecoder(window_bits, lookahead_bits);
+  if (!this->_decoder->isValid()) {
+    LOG_ERROR("Failed to create heatshrink decoder with window ", window_bits, " and lookahead ", lookahead_bits, ".");
+    this->close();
+    return false;
+  }
+
+  LOG_INFO("Opened compressed stream, ", this->_compressedSize, " bytes compressed, ", this->_uncompressedSize, " bytes uncompressed.");
+  return true;
+}
+
+void HeatshrinkDownloader::close() {
+  if (this->_httpClient != nullptr) {
+    // The connection can only be reused if the whole compressed stream was read
+    HttpClientPool::release(this->_httpClient, this->_compressedSize > 0 && this->_compressedBytesReceived == this->_compressedSize);
+    this->_httpClient = nullptr;
+    this->_stream = nullptr;
+  }
+  if (this->_decoder != nullptr) {
+    delete this->_decoder;
+    this->_decoder = nullptr;
+  }
+  this->_compressedBytesReceived = 0;
+  this->_inputLength = 0;
+  this->_inputOffset = 0;
+  this->_streamFailed = false;
+}
+
+size_t HeatshrinkDownloader::getUncompressedSize() {
+  return this->_uncompressedSize;
+}
+
+size_t HeatshrinkDownloader::getPosition() {
+  return this->_decoder != nullptr ? this->_decoder->getTotalOutput() : 0;
+}
+
+size_t HeatshrinkDownloader::getCompressedBytesReceived() {
+  return this->_compressedBytesReceived;
+}
+
+size_t HeatshrinkDownloader::read(uint8_t *buffer, size_t size) {
+  if (this->_stream == nullptr || this->_decoder == nullptr) {
+    return 0;
+  }
+
+  size_t read_size = 0;
+  unsigned long last_data_received = millis();
+  while (read_size < size && this->getPosition() < this->_uncompressedSize) {
+    if (this->_inputOffset >= this->_inputLength) {
+      size_t available = this->_stream->available();
+      if (available == 0) {
+        if (millis() - last_data_received > HEATSHRINK_DOWNLOADER_TIMEOUT_MS || !this->_stream->connected()) {
+          LOG_ERROR("Compressed stream stalled at uncompressed position ", this->getPosition(), ".");
+          this->_streamFailed = true;
+          break;
+        }
+        vTaskDelay(5 / portTICK_PERIOD_MS);
+        continue;
+      }
+      this->_inputLength = this->_stream->readBytes(this->_inputBuffer, available < sizeof(this->_inputBuffer) ? available : sizeof(this->_inputBuffer));
+      this->_inputOffset = 0;
+      this->_compressedBytesReceived += this->_inputLength;
+      last_data_received = millis();
+    }
+
+    size_t consumed = 0;
+    read_size += this->_decoder->decompress(&this->_inputBuffer[this->_inputOffset], this->_inputLength - this->_inputOffset, &consumed, &buffer[read_size], size - read_size);
+    this->_inputOffset += consumed;
+  }
+
+  return read_size;
+}
+
+bool HeatshrinkDownloader::seek(size_t position) {
+  if (position > this->_uncompressedSize) {
+    return false;
+  }
+  if (position < this->getPosition() || this->_stream == nullptr || this->_streamFailed) {
+    // The stream can't be decompressed backwards or resumed after it failed, start over.
+    if (!this->open()) {
+      return false;
+    }
+  }
+
+  uint8_t discard[256];
+  while (this->getPosition() < position) {
+    size_t discard_size = position - this->getPosition();
+    if (discard_size > sizeof(discard)) {
+      discard_size = sizeof(discard);
+    }
+    if (this->read(discard, discard_size) != discard_size) {
+      return false;
+    }
+  }
+  return true;
+}
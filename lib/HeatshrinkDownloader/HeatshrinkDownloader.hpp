@@ -0,0 +1,57 @@
+#ifndef HEATSHRINK_DOWNLOADER_HPP
+#define HEATSHRINK_DOWNLOADER_HPP
+
+#include <HTTPClient.h>
+#include <HeatshrinkDecoder.hpp>
+#include <string>
+
+#define HEATSHRINK_DOWNLOADER_INPUT_BUFFER_SIZE 1024
+#define HEATSHRINK_DOWNLOADER_TIMEOUT_MS 5000
+
+/// @brief Downloads a heatshrink compressed file from the manager as one sequential stream and
+/// @brief decompresses it on the fly. The manager announces the stream with the headers
+/// @brief X-Uncompressed-Length, X-Heatshrink-Window and X-Heatshrink-Lookahead.
+class HeatshrinkDownloader {
+public:
+  /// @brief Create a downloader for the given address. No connection is made until open() is called.
+  /// @param address The address to the compressed file
+  HeatshrinkDownloader(std::string address);
+  ~HeatshrinkDownloader();
+  /// @brief Start the download
+  /// @return True if the manager responded with a compressed stream that can be decoded
+  bool open();
+  /// @brief Stop the download and release the connection
+  void close();
+  /// @brief The size of the file after decompression
+  size_t getUncompressedSize();
+  /// @brief The uncompressed position of the next byte returned by read()
+  size_t getPosition();
+  /// @brief Number of compressed bytes received over the network since open()
+  size_t getCompressedBytesReceived();
+  /// @brief Read decompressed data
+  /// @param buffer The buffer to put the data in to
+  /// @param size Number of bytes to read
+  /// @return Number of bytes read, less than size if the stream ended or timed out
+  size_t read(uint8_t *buffer, size_t size);
+  /// @brief Move to an uncompressed position. Moving forward decompresses and discards data,
+  /// @brief moving backward or after a failed read restarts the download from the beginning.
+  /// @param position The uncompressed position to move to
+  /// @return True if successful
+  bool seek(size_t position);
+
+private:
+  std::string _address;
+  HTTPClient *_httpClient;
+  WiFiClient *_stream;
+  HeatshrinkDecoder *_decoder;
+  size_t _uncompressedSize;
+  size_t _compressedSize;
+  size_t _compressedBytesReceived;
+  uint8_t _inputBuffer[HEATSHRINK_DOWNLOADER_INPUT_BUFFER_SIZE];
+  size_t _inputLength;
+  size_t _inputOffset;
+  /// @brief Set when a read stalled or the connection dropped, the next seek restarts the stream
+  bool _streamFailed;
+};
+
+#endif
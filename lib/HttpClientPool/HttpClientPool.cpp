@@ -0,0 +1,126 @@
+#include <HttpClientPool.hpp>
+#include <MqttLog.hpp>
+
+HttpClientPool::Slot HttpClientPool::_slots[HTTP_CLIENT_POOL_SIZE];
+HttpClientPool::Metrics HttpClientPool::_metrics;
+
+void HttpClientPool::_init() {
+  portENTER_CRITICAL(&HttpClientPool::_initMux);
+  if (HttpClientPool::_mutexSlots == NULL) {
+    HttpClientPool::_semaphoreFreeSlots = xSemaphoreCreateCounting(HTTP_CLIENT_POOL_SIZE, HTTP_CLIENT_POOL_SIZE);
+    HttpClientPool::_mutexSlots = xSemaphoreCreateMutex();
+  }
+  portEXIT_CRITICAL(&HttpClientPool::_initMux);
+}
+
+std::string HttpClientPool::_getHost(const char *url) {
+  std::string host = url;
+  size_t scheme_end = host.find("://");
+  if (scheme_end != std::string::npos) {
+    host = host.substr(scheme_end + 3);
+  }
+  size_t path_start = host.find('/');
+  if (path_start != std::string::npos) {
+    host = host.substr(0, path_start);
+  }
+  return host;
+}
+
+HTTPClient *HttpClientPool::acquire(const char *url) {
+  if (HttpClientPool::_mutexSlots == NULL) {
+    HttpClientPool::_init();
+  }
+
+  unsigned long start_wait = millis();
+  xSemaphoreTake(HttpClientPool::_semaphoreFreeSlots, portMAX_DELAY);
+  xSemaphoreTake(HttpClientPool::_mutexSlots, portMAX_DELAY);
+
+  std::string host = HttpClientPool::_getHost(url);
+  Slot *slot = nullptr;
+  // Prefer an idle client already connected to the same host, then one that isn't connected at all
+  for (int i = 0; i < HTTP_CLIENT_POOL_SIZE; i++) {
+    if (!_slots[i].in_use && _slots[i].host.compare(host) == 0 && _slots[i].client.connected()) {
+      slot = &_slots[i];
+      HttpClientPool::_metrics.reused_connections++;
+      break;
+    }
+  }
+  for (int i = 0; i < HTTP_CLIENT_POOL_SIZE && slot == nullptr; i++) {
+    if (!_slots[i].in_use && !_slots[i].client.connected()) {
+      slot = &_slots[i];
+    }
+  }
+  for (int i = 0; i < HTTP_CLIENT_POOL_SIZE && slot == nullptr; i++) {
+    if (!_slots[i].in_use) {
+      slot = &_slots[i];
+    }
+  }
+  if (slot->host.compare(host) != 0 && slot->client.connected()) {
+    // Connected to another host, close it so begin() opens a new connection
+    slot->client.getStreamPtr()->stop();
+  }
+
+  slot->in_use = true;
+  slot->host = host;
+  slot->acquired_at = millis();
+  HttpClientPool::_metrics.requests++;
+  HttpClientPool::_metrics.total_wait_time_ms += slot->acquired_at - start_wait;
+  xSemaphoreGive(HttpClientPool::_mutexSlots);
+
+  slot->client.setReuse(true);
+  slot->client.setConnectTimeout(HTTP_CLIENT_POOL_TIMEOUT_MS);
+  slot->client.setTimeout(HTTP_CLIENT_POOL_TIMEOUT_MS);
+  slot->client.begin(url);
+  return &slot->client;
+}
+
+void HttpClientPool::release(HTTPClient *client, bool reusable) {
+  if (!reusable && client->connected()) {
+    client->getStreamPtr()->stop();
+  }
+  client->end();
+
+  xSemaphoreTake(HttpClientPool::_mutexSlots, portMAX_DELAY);
+  for (int i = 0; i < HTTP_CLIENT_POOL_SIZE; i++) {
+    if (&_slots[i].client == client) {
+      uint32_t request_time = millis() - _slots[i].acquired_at;
+      HttpClientPool::_metrics.total_request_time_ms += request_time;
+      if (request_time > HttpClientPool::_metrics.max_request_time_ms) {
+        HttpClientPool::_metrics.max_request_time_ms = request_time;
+      }
+      _slots[i].in_use = false;
+      break;
+    }
+  }
+  xSemaphoreGive(HttpClientPool::_mutexSlots);
+  xSemaphoreGive(HttpClientPool::_semaphoreFreeSlots);
+}
+
+bool HttpClientPool::prewarm(const char *url) {
+  HTTPClient *client = HttpClientPool::acquire(url);
+  int code = client->sendRequest("HEAD");
+  HttpClientPool::release(client, code > 0);
+  return code > 0;
+}
+
+bool HttpClientPool::parseContentRange(const String &header, size_t *start, size_t *end, size_t *total) {
+  unsigned long range_start, range_end;
+  char total_string[16];
+  if (sscanf(header.c_str(), "bytes %lu-%lu/%15s", &range_start, &range_end, total_string) != 3) {
+    return false;
+  }
+  *start = range_start;
+  *end = range_end;
+  *total = total_string[0] == '*' ? 0 : strtoul(total_string, nullptr, 10);
+  return true;
+}
+
+HttpClientPool::Metrics HttpClientPool::getMetrics() {
+  if (HttpClientPool::_mutexSlots == NULL) {
+    return HttpClientPool::Metrics();
+  }
+  xSemaphoreTake(HttpClientPool::_mutexSlots, portMAX_DELAY);
+  HttpClientPool::Metrics metrics = HttpClientPool::_metrics;
+  xSemaphoreGive(HttpClientPool::_mutexSlots);
+  return metrics;
+}
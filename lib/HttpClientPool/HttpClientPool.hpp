@@ -0,0 +1,76 @@
+#ifndef HTTP_CLIENT_POOL_HPP
+#define HTTP_CLIENT_POOL_HPP
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <string>
+
+// Number of HTTP clients, and so at most the number of open connections, shared by all HTTP requests
+#define HTTP_CLIENT_POOL_SIZE 3
+// Timeout for connecting and reading from the manager
+#define HTTP_CLIENT_POOL_TIMEOUT_MS 5000
+
+/// @brief A bounded pool of HTTP/1.1 clients with persistent connections. A request to a host and port that an idle client
+/// @brief is already connected to reuses that connection instead of setting up a new TCP connection.
+class HttpClientPool {
+public:
+  struct Metrics {
+    /// @brief Number of clients handed out
+    uint32_t requests = 0;
+    /// @brief Number of requests that reused an open connection
+    uint32_t reused_connections = 0;
+    /// @brief Total time clients have been in use
+    uint32_t total_request_time_ms = 0;
+    /// @brief Longest time a client has been in use
+    uint32_t max_request_time_ms = 0;
+    /// @brief Total time spent waiting for a free client
+    uint32_t total_wait_time_ms = 0;
+  };
+
+  /// @brief Get a client that has begun a request to url. Blocks until a client is free.
+  /// @param url The URL to request
+  /// @return The client, hand back with release() when done
+  static HTTPClient *acquire(const char *url);
+  /// @brief Return a client to the pool
+  /// @param client The client to return
+  /// @param reusable Set to false if the response body was not read to the end, the connection is then closed
+  /// @brief as the rest of the body would otherwise be read as the response to the next request.
+  static void release(HTTPClient *client, bool reusable = true);
+  /// @brief Open a connection to the host in url ahead of time with a HEAD request, the next request to the host reuses it
+  /// @param url The URL to request
+  /// @return True if the host answered
+  static bool prewarm(const char *url);
+  /// @brief Parse a Content-Range header, "bytes <start>-<end>/<total>"
+  /// @param header The header value
+  /// @param start Set to the first byte in the response
+  /// @param end Set to the last byte in the response
+  /// @param total Set to the size of the whole file, 0 if unknown
+  /// @return True if the header could be parsed
+  static bool parseContentRange(const String &header, size_t *start, size_t *end, size_t *total);
+  /// @brief Get a copy of the pool metrics
+  static Metrics getMetrics();
+
+private:
+  struct Slot {
+    HTTPClient client;
+    /// @brief "host:port" the client was last connected to
+    std::string host;
+    bool in_use = false;
+    unsigned long acquired_at = 0;
+  };
+
+  static void _init();
+  /// @brief Extract "host:port" from an URL
+  static std::string _getHost(const char *url);
+
+  // Defined in HttpClientPool.cpp, Slot and Metrics are incomplete until the end of the class
+  static Slot _slots[HTTP_CLIENT_POOL_SIZE];
+  /// @brief Counts free slots
+  static inline SemaphoreHandle_t _semaphoreFreeSlots = NULL;
+  /// @brief Protects the slots and metrics
+  static inline SemaphoreHandle_t _mutexSlots = NULL;
+  static inline portMUX_TYPE _initMux = portMUX_INITIALIZER_UNLOCKED;
+  static Metrics _metrics;
+};
+
+#endif
@@ -1,83 +1,220 @@
 #include <HTTPClient.h>
+#include <HttpClientPool.hpp>
 #include <HttpLib.hpp>
 #include <MqttLog.hpp>
 #include <cstdint>
 
 size_t HttpLib::GetFileSize(const char *url) {
-  HTTPClient httpClient;
-  httpClient.begin(url);
   const char *header_names[] = {"Content-Length"};
-  httpClient.collectHeaders(header_names, 1);
-  int httpReturnCode = httpClient.GET();
+  HTTPClient *httpClient = HttpClientPool::acquire(url);
+  httpClient->collectHeaders(header_names, 1);
+  // HEAD leaves the connection free for the next request, fall back to GET if the server doesn't support it
+  int httpReturnCode = httpClient->sendRequest("HEAD");
+  if (httpReturnCode == 200 && httpClient->header("Content-Length").length() > 0) {
+    size_t content_length = httpClient->header("Content-Length").toInt();
+    HttpClientPool::release(httpClient);
+    return content_length;
+  }
+  HttpClientPool::release(httpClient, false);
 
+  httpClient = HttpClientPool::acquire(url);
+  httpClient->collectHeaders(header_names, 1);
+  httpReturnCode = httpClient->GET();
   if (httpReturnCode != 200) {
     LOG_ERROR("Failed to retrive file size for URL '", url, "'. Got return code: ", httpReturnCode);
-    httpClient.end();
+    HttpClientPool::release(httpClient, false);
     return 0;
   }
 
-  try {
-    size_t content_length = httpClient.header("Content-Length").toInt();
-    httpClient.end();
-    return content_length;
-  } catch (...) {
-    LOG_ERROR("Something went wrong when checking file size for URL '", url, "'.");
-  }
-  httpClient.end();
-  return 0;
+  size_t content_length = httpClient->header("Content-Length").toInt();
+  // The body is not read, the connection can't be reused
+  HttpClientPool::release(httpClient, false);
+  return content_length;
 }
 
 size_t HttpLib::DownloadChunk(uint8_t *buffer, const char *address, size_t offset, size_t size) {
-  HTTPClient httpClient;
-  httpClient.begin(address);
-
   std::string rangeHeader = "bytes=";
   rangeHeader.append(std::to_string(offset));
   rangeHeader.append("-");
-  rangeHeader.append(std::to_string(offset + size));
-  httpClient.addHeader("Range", rangeHeader.c_str());
-  rangeHeader.clear();
+  rangeHeader.append(std::to_string(offset + size - 1));
+
+  const char *header_names[] = {"Content-Range"};
+  HTTPClient *httpClient = HttpClientPool::acquire(address);
+  httpClient->collectHeaders(header_names, 1);
+  httpClient->addHeader("Range", rangeHeader.c_str());
 
-  int httpReturnCode = httpClient.GET();
-  // LOG_TRACE("Downloading TFT ", rangeHeader.c_str(), " got return code: ", httpReturnCode);
+  int httpReturnCode = httpClient->GET();
   if (httpReturnCode != 200 && httpReturnCode != 206) {
-    httpClient.end();
     LOG_ERROR("Failed to retrive file chunk from URL '", address, "'. Got return code: ", httpReturnCode);
+    HttpClientPool::release(httpClient, false);
+    return 0;
+  }
+
+  size_t range_start, range_end, range_total;
+  if (httpReturnCode == 206) {
+    if (!HttpClientPool::parseContentRange(httpClient->header("Content-Range"), &range_start, &range_end, &range_total) || range_start != offset) {
+      LOG_ERROR("Got unexpected Content-Range '", httpClient->header("Content-Range").c_str(), "' when requesting ", rangeHeader.c_str(), " from URL '", address, "'.");
+      HttpClientPool::release(httpClient, false);
+      return 0;
+    }
+    if (range_end - range_start + 1 < size) {
+      size = range_end - range_start + 1; // Last chunk of the file
+    }
+  } else if (offset != 0) {
+    LOG_ERROR("Server ignored range request ", rangeHeader.c_str(), " for URL '", address, "'.");
+    HttpClientPool::release(httpClient, false);
     return 0;
   }
 
   size_t sizeReceived = 0;
-  uint8_t num_retries = 0;
-  sizeReceived += httpClient.getStream().readBytes(&buffer[sizeReceived], httpClient.getStreamPtr()->available() >= size - sizeReceived ? size - sizeReceived : httpClient.getStreamPtr()->available());
-  httpClient.end();
+  unsigned long last_data_received = millis();
+  WiFiClient *stream = httpClient->getStreamPtr();
+  while (sizeReceived < size && stream != nullptr && millis() - last_data_received < HTTP_CLIENT_POOL_TIMEOUT_MS) {
+    size_t available = stream->available();
+    if (available == 0) {
+      vTaskDelay(10 / portTICK_PERIOD_MS);
+      continue;
+    }
+    sizeReceived += stream->readBytes(&buffer[sizeReceived], available < size - sizeReceived ? available : size - sizeReceived);
+    last_data_received = millis();
+  }
+  // Only a 206 response read to the end leaves the connection ready for the next request
+  HttpClientPool::release(httpClient, httpReturnCode == 206 && sizeReceived == size);
 
   return sizeReceived;
 }
 
+bool HttpLib::AddRangeToMD5(const char *address, size_t offset, size_t size, MD5Builder *md5) {
+  std::string rangeHeader = "bytes=";
+  rangeHeader.append(std::to_string(offset));
+  rangeHeader.append("-");
+  rangeHeader.append(std::to_string(offset + size - 1));
+
+  HTTPClient *httpClient = HttpClientPool::acquire(address);
+  httpClient->addHeader("Range", rangeHeader.c_str());
+
+  int httpReturnCode = httpClient->GET();
+  if (httpReturnCode != 206) {
+    HttpClientPool::release(httpClient, false);
+    LOG_ERROR("Failed to retrive range ", rangeHeader.c_str(), " from URL '", address, "'. Got return code: ", httpReturnCode);
+    return false;
+  }
+
+  uint8_t buffer[1024];
+  size_t remaining = size;
+  unsigned long last_data_received = millis();
+  WiFiClient *stream = httpClient->getStreamPtr();
+  while (remaining > 0 && stream != nullptr && millis() - last_data_received < HTTP_CLIENT_POOL_TIMEOUT_MS) {
+    size_t available = stream->available();
+    if (available == 0) {
+      vTaskDelay(10 / portTICK_PERIOD_MS);
+      continue;
+    }
+    size_t read_size = available < sizeof(buffer) ? available : sizeof(buffer);
+    if (read_size > remaining) {
+      read_size = remaining;
+    }
+    size_t read = stream->readBytes(buffer, read_size);
+    md5->add(buffer, read);
+    remaining -= read;
+    last_data_received = millis();
+  }
+  HttpClientPool::release(httpClient, remaining == 0);
+
+  return remaining == 0;
+}
+
 bool HttpLib::GetMD5sum(const char *address, char *buffer) {
-  HTTPClient http;
-  http.begin(address);
-  int responseCode = http.GET();
+  HTTPClient *http = HttpClientPool::acquire(address);
+  int responseCode = http->GET();
 
   if (responseCode == 200) {
-    http.getString().toCharArray(buffer, 33);
-    http.end();
+    // getString reads the whole body so the connection can be reused
+    http->getString().toCharArray(buffer, 33);
+    HttpClientPool::release(http);
     return true;
   }
-  http.end();
+  HttpClientPool::release(http, false);
   return false;
 }
 
 bool HttpLib::DownloadJSON(const char *address, JsonDocument *document) {
-  HTTPClient http;
-  http.begin(address);
-  int responseCode = http.GET();
+  std::string etag;
+  bool modified;
+  return HttpLib::DownloadJSON(address, document, &etag, &modified);
+}
 
-  if (responseCode == 200) {
-    DeserializationError error = deserializeJson(*document, http.getStream());
-    http.end();
+/// @brief Wraps a response body so that the number of bytes the JSON parser reads can be counted
+class BodyStream : public Stream {
+public:
+  BodyStream(Stream *stream) {
+    this->_stream = stream;
+    this->bytes_read = 0;
+    this->setTimeout(HTTP_CLIENT_POOL_TIMEOUT_MS);
+  }
+  int available() override { return this->_stream->available(); }
+  int read() override {
+    int c = this->_stream->read();
+    if (c >= 0) {
+      this->bytes_read++;
+    }
+    return c;
+  }
+  int peek() override { return this->_stream->peek(); }
+  size_t write(uint8_t c) override { return 0; }
+  size_t bytes_read;
+
+private:
+  Stream *_stream;
+};
+
+bool HttpLib::DownloadJSON(const char *address, JsonDocument *document, std::string *etag, bool *modified, JsonDocument *filter) {
+  const char *header_names[] = {"ETag"};
+  HTTPClient *http = HttpClientPool::acquire(address);
+  http->collectHeaders(header_names, 1);
+  if (!etag->empty()) {
+    http->addHeader("If-None-Match", etag->c_str());
+  }
+  int responseCode = http->GET();
+
+  if (responseCode == 304) {
+    // A 304 response has no body, the connection is ready for the next request
+    *modified = false;
+    HttpClientPool::release(http);
+    return true;
+  } else if (responseCode == 200) {
+    DeserializationError error;
+    bool reusable = false;
+    int content_length = http->getSize();
+    if (content_length >= 0) {
+      // Parse straight from the connection so the body is never held in memory as a whole
+      BodyStream body(http->getStreamPtr());
+      if (filter != nullptr) {
+        error = deserializeJson(*document, body, DeserializationOption::Filter(*filter));
+      } else {
+        error = deserializeJson(*document, body);
+      }
+      // Skip anything after the JSON value, like a trailing newline, to leave the connection at the end of the response
+      char skipped;
+      while (!error && body.bytes_read < (size_t)content_length && body.readBytes(&skipped, 1) == 1) {
+      }
+      reusable = !error && body.bytes_read == (size_t)content_length;
+    } else {
+      // Chunked transfer encoding, let HTTPClient decode the body
+      if (filter != nullptr) {
+        error = deserializeJson(*document, http->getString(), DeserializationOption::Filter(*filter));
+      } else {
+        error = deserializeJson(*document, http->getString());
+      }
+      reusable = !error;
+    }
+    if (!error) {
+      *etag = http->header("ETag").c_str();
+      *modified = true;
+    }
+    HttpClientPool::release(http, reusable);
     return !error; // Return true or false depending on there was a deserialization error
   }
-  http.end();
+  HttpClientPool::release(http, false);
   return false;
 }
@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <MD5Builder.h>
+#include <string>
 
 class HttpLib {
 public:
@@ -17,9 +19,24 @@ public:
   /// @param size The size of the chunk
   /// @return The number of bytes downloaded
   static size_t DownloadChunk(uint8_t *buffer, const char *address, size_t offset, size_t size);
+  /// @brief Download a range of a remote file and add it to an MD5 digest without storing it
+  /// @param address The address to download the range from
+  /// @param offset Where the range starts
+  /// @param size The size of the range
+  /// @param md5 The digest to add the data to
+  /// @return True if the whole range was added to the digest
+  static bool AddRangeToMD5(const char *address, size_t offset, size_t size, MD5Builder *md5);
   static bool GetMD5sum(const char *address, char *buffer);
 
   static bool DownloadJSON(const char *address, JsonDocument *document);
+  /// @brief Download a JSON document unless it has not changed since it was last downloaded
+  /// @param address The address to download the document from
+  /// @param document The document to deserialize into, left untouched if the document has not changed
+  /// @param etag The ETag of the last downloaded version, sent as If-None-Match if not empty. Updated when a new version is downloaded.
+  /// @param modified Set to false if the manager responded 304 Not Modified
+  /// @param filter Optional ArduinoJson filter, only fields set in the filter are kept in document
+  /// @return True if a new document was downloaded or the document has not changed
+  static bool DownloadJSON(const char *address, JsonDocument *document, std::string *etag, bool *modified, JsonDocument *filter = nullptr);
 };
 
 #endif
@@ -12,8 +12,6 @@ enum DEFAULT_PAGE {
   ROOM_PAGE
 };
 
-class Scene;
-
 class InterfaceConfig {
 public:
   static inline uint16_t homeScreen = 0;
@@ -45,9 +43,6 @@ public:
   static inline std::string screensaver_mode;
   /// @brief Show clock in US style. AM/PM?
   static inline bool clock_us_style = false;
-  /// @brief All the global scenes.
-  static inline std::vector<Scene *> global_scenes;
-  static Scene *getSceneById(uint16_t id);
   static inline roomMode currentRoomMode;
   static inline editLightMode currentEditLightMode;
   static inline editLightMode _triggerSpecialLightMode;
@@ -1,12 +1,15 @@
 #include "NSPMConfig.h"
 #include "freertos/portmacro.h"
 #include <ArduinoJson.h>
+#include <BootProfiler.hpp>
+#include <ConnectionState.hpp>
 #include <HomePage.hpp>
 #include <InterfaceConfig.hpp>
 #include <InterfaceManager.hpp>
 #include <Light.hpp>
 #include <LightManager.hpp>
 #include <LightPage.hpp>
+#include <ManagerDiscovery.hpp>
 #include <MqttLog.hpp>
 #include <NSPanel.hpp>
 #include <PageManager.hpp>
@@ -16,7 +19,6 @@
 #include <TftDefines.h>
 #include <WebManager.hpp>
 #include <WiFi.h>
-#include <WiFiClient.h>
 #include <string>
 
 void InterfaceManager::init() {
@@ -37,18 +39,21 @@ void InterfaceManager::stop() {
       InterfaceManager::_taskHandleSpecialModeTimer = NULL;
     }
 
-    for (Room *room : RoomManager::rooms) {
-      for (auto lightPair : room->ceilingLights) {
-        delete lightPair.second;
-      }
-      room->ceilingLights.clear();
-      for (auto lightPair : room->tableLights) {
-        delete lightPair.second;
+    // The interface is going away, detach the pages from the lights without asking them to update
+    {
+      RoomModelSnapshot rooms;
+      for (Room *room : rooms.rooms()) {
+        for (auto lightPair : room->ceilingLights) {
+          lightPair.second->detachAllObservers();
+        }
+        for (auto lightPair : room->tableLights) {
+          lightPair.second->detachAllObservers();
+        }
       }
-      room->tableLights.clear();
     }
 
-    RoomManager::rooms.clear();
+    // Tasks still holding a snapshot keep using the old rooms until they let go of it
+    RoomManager::unloadAllRooms();
   } catch (const std::exception &e) {
     LOG_ERROR("Error while stopping Interface Manager: ", e.what());
   }
@@ -64,12 +69,27 @@ void InterfaceManager::_taskLoadConfigAndInit(void *param) {
   NSPanel::instance->setDimLevel(InterfaceConfig::screen_dim_level);
   InterfaceManager::subscribeToMqttTopics();
   std::string last_shown_secondary_text = "";
-  while (!WiFi.isConnected() || !MqttManager::connected() || !InterfaceManager::hasRegisteredToManager || !NSPMConfig::instance->littlefs_mount_successfull) {
-    if (NSPanel::instance->ready()) {
+  bool snapshot_checked = false;
+  bool loaded_from_snapshot = false;
+  // The config is downloaded as soon as WiFi is up and the manager is known, registration is confirmed in the background
+  if (!NSPMConfig::instance->manager_address.empty()) {
+    LOG_INFO("Will load config from saved manager ", NSPMConfig::instance->manager_address.c_str(), " while registering.");
+    ManagerDiscovery::setManager(NSPMConfig::instance->manager_address, NSPMConfig::instance->manager_port, ManagerSource::SAVED);
+  }
+  while (!ConnectionState::isSet(CONNECTION_STATE_WIFI_CONNECTED | CONNECTION_STATE_MANAGER_KNOWN) || !NSPMConfig::instance->littlefs_mount_successfull) {
+    if (NSPanel::instance->ready() && !snapshot_checked) {
+      // Build the interface from the last loaded config while waiting for the network, it is revalidated once the manager can be reached
+      snapshot_checked = true;
+      loaded_from_snapshot = RoomManager::loadAllRoomsFromSnapshot(InterfaceManager::_showHomeRoom);
+      if (loaded_from_snapshot) {
+        BootProfiler::mark("snapshot_loaded");
+      }
+    }
+    if (NSPanel::instance->ready() && !InterfaceManager::_homeRoomShown) {
       std::string secondary_text = "";
       if (!NSPMConfig::instance->littlefs_mount_successfull) {
         PageManager::GetNSPanelManagerPage()->setText("LittleFS mount failed!");
-      } else if (!WiFi.isConnected()) {
+      } else if (ConnectionState::getStage() == ConnectionStage::CONNECTING_WIFI) {
         if (WiFi.getMode() == WIFI_MODE_AP) {
           PageManager::GetNSPanelManagerPage()->setText("Connect to AP NSPMPanel");
           secondary_text = "Connect to IP 192.168.1.1";
@@ -77,10 +97,10 @@ void InterfaceManager::_taskLoadConfigAndInit(void *param) {
           PageManager::GetNSPanelManagerPage()->setText("Connecting to WiFi...");
           secondary_text = "";
         }
-      } else if (!InterfaceManager::hasRegisteredToManager) {
-        PageManager::GetNSPanelManagerPage()->setText("Registering to manager...");
-      } else if (!MqttManager::connected()) {
+      } else if (ConnectionState::getStage() == ConnectionStage::CONNECTING_MQTT) {
         PageManager::GetNSPanelManagerPage()->setText("Connecting to MQTT...");
+      } else if (ConnectionState::getStage() == ConnectionStage::REGISTERING) {
+        PageManager::GetNSPanelManagerPage()->setText("Registering to manager...");
       }
 
       if (WiFi.isConnected()) {
@@ -93,29 +113,37 @@ void InterfaceManager::_taskLoadConfigAndInit(void *param) {
         PageManager::GetNSPanelManagerPage()->setSecondaryText(secondary_text);
       }
     }
-    vTaskDelay(250 / portTICK_PERIOD_MS);
+    // Continue as soon as the manager can be reached, the timeout only refreshes the status text
+    ConnectionState::waitFor(CONNECTION_STATE_WIFI_CONNECTED | CONNECTION_STATE_MANAGER_KNOWN, 250 / portTICK_PERIOD_MS);
   }
 
   // Start task for MQTT processing
   xTaskCreatePinnedToCore(_taskProcessMqttMessages, "taskProcessMqttMessages", 5000, NULL, 1, &InterfaceManager::_taskHandleProcessMqttMessages, CONFIG_ARDUINO_RUNNING_CORE);
 
   if (NSPanel::instance->ready()) {
-    PageManager::GetNSPanelManagerPage()->setText("Loading config...");
-    RoomManager::loadAllRooms(false);
-
-    // Update Home page cache
-    PageManager::GetHomePage()->updateDimmerValueCache();
-    PageManager::GetHomePage()->updateColorTempValueCache();
+    if (!InterfaceManager::_homeRoomShown) {
+      PageManager::GetNSPanelManagerPage()->setText("Loading config...");
+    }
+    BootProfiler::mark("config_load_started");
+    // If loaded from snapshot, only download and apply what has changed since the snapshot was saved
+    RoomManager::loadAllRooms(loaded_from_snapshot, InterfaceManager::_showHomeRoom);
+    ConnectionState::set(CONNECTION_STATE_CONFIG_LOADED);
 
     // As there may be may be MANY topics to subscribe to, do it in checks of 5 with delays
     // between them to allow for processing all the incoming data.
-    PageManager::GetNSPanelManagerPage()->setText("Subscribing...");
+    if (!InterfaceManager::_homeRoomShown) {
+      PageManager::GetNSPanelManagerPage()->setText("Subscribing...");
+    }
     LightManager::subscribeToMqttLightUpdates();
 
-    // Loading is done, show Home page
-    NSPanel::instance->setDimLevel(InterfaceConfig::screen_dim_level);
-    InterfaceManager::showDefaultPage();
-    PageManager::GetHomePage()->setScreensaverTimeout(InterfaceConfig::screensaver_activation_timeout);
+    if (InterfaceManager::_homeRoomShown) {
+      // Home page is already shown, update the cache now that all rooms are loaded
+      PageManager::GetHomePage()->updateDimmerValueCache();
+      PageManager::GetHomePage()->updateColorTempValueCache();
+    } else {
+      // Home room was not found, show the page now that loading is done
+      InterfaceManager::_showHomeRoom();
+    }
   }
 
   // NSPanel::attachTouchEventCallback(InterfaceManager::processTouchEvent);
@@ -130,6 +158,19 @@ void InterfaceManager::_taskLoadConfigAndInit(void *param) {
   vTaskDelete(NULL); // Delete task, we are done
 }
 
+void InterfaceManager::_showHomeRoom() {
+  // Update Home page cache
+  PageManager::GetHomePage()->updateDimmerValueCache();
+  PageManager::GetHomePage()->updateColorTempValueCache();
+
+  // Show Home page, the rest of the rooms continue loading in the background
+  NSPanel::instance->setDimLevel(InterfaceConfig::screen_dim_level);
+  InterfaceManager::showDefaultPage();
+  PageManager::GetHomePage()->setScreensaverTimeout(InterfaceConfig::screensaver_activation_timeout);
+  InterfaceManager::_homeRoomShown = true;
+  BootProfiler::complete("home_page_shown");
+}
+
 void InterfaceManager::showDefaultPage() {
   if (InterfaceConfig::default_page == DEFAULT_PAGE::MAIN_PAGE) {
     PageManager::GetHomePage()->show();
@@ -198,12 +239,17 @@ void InterfaceManager::handleNSPanelCommand(char *topic, byte *payload, unsigned
     ESP.restart();
   } else if (command.compare("firmware_update") == 0) {
     WebManager::startOTAUpdate();
+  } else if (command.compare("update_all") == 0) {
+    WebManager::startCombinedUpdate();
   } else if (command.compare("tft_update") == 0) {
     InterfaceManager::stop();
     NSPanel::instance->startOTAUpdate();
   } else if (command.compare("register_accept") == 0) {
-    NSPMConfig::instance->manager_address = json["address"].as<String>().c_str();
-    NSPMConfig::instance->manager_port = json["port"].as<uint16_t>();
+    std::string manager_address = json["address"].as<String>().c_str();
+    uint16_t manager_port = json["port"].as<uint16_t>();
+    bool manager_changed = manager_address.compare(NSPMConfig::instance->manager_address) != 0 || manager_port != NSPMConfig::instance->manager_port;
+    NSPMConfig::instance->manager_address = manager_address;
+    NSPMConfig::instance->manager_port = manager_port;
 
     Serial.print("Received register accept from manager: ");
     Serial.print(NSPMConfig::instance->manager_address.c_str());
@@ -211,6 +257,14 @@ void InterfaceManager::handleNSPanelCommand(char *topic, byte *payload, unsigned
     Serial.println(NSPMConfig::instance->manager_port);
     LOG_INFO("Received register accept from manager ", NSPMConfig::instance->manager_address.c_str(), " with port: ", NSPMConfig::instance->manager_port);
     InterfaceManager::hasRegisteredToManager = true;
+    ManagerDiscovery::setManager(manager_address, manager_port, ManagerSource::REGISTERED);
+    ConnectionState::set(CONNECTION_STATE_REGISTERED);
+    BootProfiler::mark("registered");
+    if (manager_changed) {
+      // Save the manager so that the config can be downloaded from it directly at next boot
+      LOG_INFO("Manager address changed, saving config.");
+      NSPMConfig::instance->saveToLittleFS(false);
+    }
   } else if (command.compare("reload") == 0) {
     if (InterfaceManager::hasRegisteredToManager && NSPMConfig::instance->successful_config_load) {
       RoomManager::performConfigReload();
@@ -254,7 +308,6 @@ void InterfaceManager::subscribeToMqttTopics() {
   // Subscribe to command to wake/put to sleep the display
   vTaskDelay(100 / portTICK_PERIOD_MS);
   MqttManager::subscribeToTopic(NSPMConfig::instance->mqtt_screen_cmd_topic.c_str(), &InterfaceManager::mqttCallback);
-  MqttManager::subscribeToTopic(NSPMConfig::instance->mqtt_panel_cmd_topic.c_str(), &InterfaceManager::handleNSPanelCommand);
   MqttManager::subscribeToTopic(NSPMConfig::instance->mqtt_panel_screen_brightness_topic.c_str(), &InterfaceManager::handleNSPanelScreenBrightnessCommand);
   MqttManager::subscribeToTopic(NSPMConfig::instance->mqtt_panel_screensaver_brightness.c_str(), &InterfaceManager::handleNSPanelScreensaverBrightnessCommand);
 }
@@ -271,147 +324,3 @@ void InterfaceManager::processSleepEvent() {
   // Display auto-magically goes to screensaver page. Only ajust dim-level
   PageManager::GetScreensaverPage()->show();
 }
-
-bool InterfaceManager::_getPanelConfig() {
-  WiFiClient client;
-  unsigned long contentLength = 0;
-  bool isValidContentType = false;
-  if (client.connect(NSPMConfig::instance->manager_address.c_str(), NSPMConfig::instance->manager_port)) {
-    client.print(String("GET /api/get_nspanel_config?mac=") + WiFi.macAddress() + " HTTP/1.1\r\n" +
-                 "Host: " + NSPMConfig::instance->manager_address.c_str() + "\r\n" +
-                 "Cache-Control: no-cache\r\n" +
-                 "Connection: close\r\n\r\n");
-
-    // Wait for response
-    unsigned long timeout = millis();
-    while (client.available() == 0) {
-      if (millis() - timeout > 5000) {
-        LOG_ERROR("Timeout while downloading firmware!");
-        client.stop();
-      }
-      vTaskDelay(20 / portTICK_PERIOD_MS);
-    }
-
-    while (client.available()) {
-      String line = client.readStringUntil('\n');
-      // remove space, to check if the line is end of headers
-      line.trim();
-
-      if (!line.length()) {
-        // headers ended
-        break; // and get the OTA started
-      }
-
-      // Check if the HTTP Response is 200
-      // else break and Exit Update
-      if (line.startsWith("HTTP/1.1")) {
-        if (line.indexOf("200") < 0) {
-          LOG_ERROR("Got a non 200 status code from server. Exiting OTA Update.");
-          break;
-        }
-      }
-
-      // extract headers here
-      // Start with content length
-      if (line.startsWith("Content-Length: ")) {
-        contentLength = atol((getHeaderValue(line, "Content-Length: ")).c_str());
-      }
-
-      // Next, the content type
-      if (line.startsWith("Content-Type: ")) {
-        String contentType = getHeaderValue(line, "Content-Type: ");
-        if (contentType == "application/json") {
-          isValidContentType = true;
-        } else {
-          LOG_ERROR("Received invalid content type: ", contentType.c_str());
-        }
-      }
-    }
-  } else {
-    LOG_ERROR("Failed to connect to manager!");
-  }
-
-  // check contentLength and content type
-  if (contentLength && isValidContentType) {
-    DeserializationError error = deserializeJson((*this->_roomDataJson), client);
-    if (!error) {
-      return true;
-    }
-  } else {
-    LOG_ERROR("There was no content in the OTA response!");
-    client.flush();
-  }
-  return false;
-}
-
-bool InterfaceManager::_getRoomConfig(int room_id, JsonDocument *buffer) {
-  WiFiClient client;
-  unsigned long contentLength = 0;
-  bool isValidContentType = false;
-  if (client.connect(NSPMConfig::instance->manager_address.c_str(), NSPMConfig::instance->manager_port)) {
-    client.print(String("GET /api/get_nspanel_config/room/") + String(room_id) + " HTTP/1.1\r\n" +
-                 "Host: " + NSPMConfig::instance->manager_address.c_str() + "\r\n" +
-                 "Cache-Control: no-cache\r\n" +
-                 "Connection: close\r\n\r\n");
-
-    // Wait for response
-    unsigned long timeout = millis();
-    while (client.available() == 0) {
-      if (millis() - timeout > 5000) {
-        LOG_ERROR("Timeout while downloading firmware!");
-        client.stop();
-      }
-      vTaskDelay(20 / portTICK_PERIOD_MS);
-    }
-
-    while (client.available()) {
-      String line = client.readStringUntil('\n');
-      // remove space, to check if the line is end of headers
-      line.trim();
-
-      if (!line.length()) {
-        // headers ended
-        break; // and get the OTA started
-      }
-
-      // Check if the HTTP Response is 200
-      // else break and Exit Update
-      if (line.startsWith("HTTP/1.1")) {
-        if (line.indexOf("200") < 0) {
-          LOG_ERROR("Got a non 200 status code from server. Exiting OTA Update.");
-          break;
-        }
-      }
-
-      // extract headers here
-      // Start with content length
-      if (line.startsWith("Content-Length: ")) {
-        contentLength = atol((getHeaderValue(line, "Content-Length: ")).c_str());
-      }
-
-      // Next, the content type
-      if (line.startsWith("Content-Type: ")) {
-        String contentType = getHeaderValue(line, "Content-Type: ");
-        if (contentType == "application/json") {
-          isValidContentType = true;
-        } else {
-          LOG_ERROR("Received invalid content type: ", contentType.c_str());
-        }
-      }
-    }
-  } else {
-    LOG_ERROR("Failed to connect to manager!");
-  }
-
-  // check contentLength and content type
-  if (contentLength && isValidContentType) {
-    DeserializationError error = deserializeJson((*buffer), client);
-    if (!error) {
-      return true;
-    }
-  } else {
-    LOG_ERROR("There was no content in the OTA response!");
-    client.flush();
-  }
-  return false;
-}
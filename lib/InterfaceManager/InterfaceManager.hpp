@@ -32,7 +32,8 @@ public:
   /// @brief The InfterfaceManager instance
   static inline InterfaceManager *instance;
 
-  static inline void handleNSPanelCommand(char *topic, byte *payload, unsigned int length);
+  /// @brief Handle a command from the manager. Subscribed from setup() so that register_accept is received before the display is initialised.
+  static void handleNSPanelCommand(char *topic, byte *payload, unsigned int length);
   static inline void handleNSPanelScreenBrightnessCommand(char *topic, byte *payload, unsigned int length);
   static inline void handleNSPanelScreensaverBrightnessCommand(char *topic, byte *payload, unsigned int length);
   static void showDefaultPage();
@@ -42,6 +43,10 @@ private:
   /// @brief makes needed adjustments to make the panel ready for use.
   /// @param param Not used
   static void _taskLoadConfigAndInit(void *param);
+  /// @brief Show the default page, called as soon as the home room has been loaded during boot
+  static void _showHomeRoom();
+  /// @brief Has the default page been shown after boot
+  static inline bool _homeRoomShown = false;
   /// @brief MQTT Messages that has been received but not yet processed
   static inline std::list<mqttMessage> _mqttMessages;
   /// @brief The task handle used to notify task to start processing MQTT messages
@@ -51,16 +56,6 @@ private:
   static void _taskProcessMqttMessages(void *param);
   /// @brief Task handle used to indicate weather or not a special mode has already ben initialized
   static inline TaskHandle_t _taskHandleSpecialModeTimer;
-  /// @brief Used temporarely to hold JSON-data from the server while initializing the panel
-  JsonDocument *_roomDataJson;
-  /// @brief Try to download the configuration from the server
-  /// @return True if sucessful, otherwise false
-  bool _getPanelConfig();
-  /// @brief Try to download the configuration for a specified room
-  /// @param room_id The ID of the room
-  /// @param buffer The buffer to put the JSON-data in to
-  /// @return True if sucessful, otherwise false
-  bool _getRoomConfig(int room_id, JsonDocument *buffer);
 
   bool _processMqttMessages;
 };
@@ -0,0 +1,22 @@
+#include <DeviceEntity.hpp>
+#include <algorithm>
+#include <utility>
+
+void DeviceEntity::callDeconstructCallbacks(std::list<DeviceEntity *> &entities) {
+  // Group the entities by observer so that every observer only updates once for the whole batch
+  std::list<std::pair<DeviceEntityObserver *, std::list<DeviceEntity *>>> observerEntities;
+  for (DeviceEntity *entity : entities) {
+    for (DeviceEntityObserver *observer : entity->detachAllObservers()) {
+      auto it = std::find_if(observerEntities.begin(), observerEntities.end(), [observer](const std::pair<DeviceEntityObserver *, std::list<DeviceEntity *>> &pair) { return pair.first == observer; });
+      if (it == observerEntities.end()) {
+        observerEntities.push_back(std::make_pair(observer, std::list<DeviceEntity *>{entity}));
+      } else {
+        it->second.push_back(entity);
+      }
+    }
+  }
+
+  for (auto &pair : observerEntities) {
+    pair.first->entitiesDeconstructCallback(pair.second);
+  }
+}
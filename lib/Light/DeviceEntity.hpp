@@ -13,6 +13,18 @@ class DeviceEntityObserver {
 public:
   virtual void entityDeconstructCallback(DeviceEntity *);
   virtual void entityUpdateCallback(DeviceEntity *);
+  /// @brief Called once for all entities removed together, the observer has already been detached from them.
+  /// @brief Defaults to calling entityDeconstructCallback for each entity.
+  virtual void entitiesDeconstructCallback(std::list<DeviceEntity *> &entities) {
+    for (DeviceEntity *entity : entities) {
+      this->entityDeconstructCallback(entity);
+    }
+  }
+  /// @brief Called when a config reload replaced an entity with a new entity for the same device, the observer has already been moved to
+  /// @brief the replacement. The replaced entity is deleted once no snapshot holds it. Defaults to calling entityUpdateCallback.
+  virtual void entityReplacedCallback(DeviceEntity *replaced, DeviceEntity *replacement) {
+    this->entityUpdateCallback(replacement);
+  }
 };
 
 class DeviceEntity {
@@ -21,6 +33,11 @@ public:
   virtual void attachDeconstructCallback(DeviceEntityObserver *callback) = 0;
   virtual void detachDeconstructCallback(DeviceEntityObserver *callback) = 0;
   virtual void callDeconstructCallbacks() = 0;
+  /// @brief Detach all update and deconstruct observers from the entity
+  /// @return The deconstruct observers that were attached
+  virtual std::list<DeviceEntityObserver *> detachAllObservers() = 0;
+  /// @brief Detach all observers from the given entities and notify each deconstruct observer once for all of its entities
+  static void callDeconstructCallbacks(std::list<DeviceEntity *> &entities);
 
   virtual void attachUpdateCallback(DeviceEntityObserver *callback) = 0;
   virtual void detachUpdateCallback(DeviceEntityObserver *callback) = 0;
@@ -1,20 +1,43 @@
 #include <Light.hpp>
 #include <LightManager.hpp>
 #include <MqttLog.hpp>
+#include <algorithm>
 #include <functional>
 #include <map>
 
-void Light::initFromMap(std::map<std::string, std::string> &data) {
-  this->_id = atoi(data["id"].c_str());
-  this->_name = data["name"];
-  this->_canDim = data["can_dim"].compare("true") == 0;
-  this->_canTemperature = data["can_temperature"].compare("true") == 0;
-  this->_canRgb = data["can_rgb"].compare("true") == 0;
-  this->_roomViewPosition = atoi(data["view_position"].c_str());
-  this->_isCeiling = data["ceiling"].compare("true") == 0;
+void Light::initFromJson(uint16_t id, JsonObjectConst data) {
+  this->_id = id;
+  this->_config = LightConfig::fromJson(data);
+  LOG_TRACE("Loaded light ", this->_config.name.c_str(), " as type: ", this->_config.ceiling ? "CEILING" : "TABLE");
+}
 
-  this->callUpdateCallbacks();
-  LOG_TRACE("Loaded light ", this->_name.c_str(), " as type: ", this->_isCeiling ? "CEILING" : "TABLE");
+bool Light::hasSameConfig(Light *other) {
+  return this->_id == other->_id && this->_config == other->_config;
+}
+
+std::list<DeviceEntityObserver *> Light::takeOver(Light *replaced) {
+  this->_level = replaced->_level;
+  this->_colorTemperature = replaced->_colorTemperature;
+  this->_colorHue = replaced->_colorHue;
+  this->_colorSaturation = replaced->_colorSaturation;
+  this->_hasLevelChanged = replaced->_hasLevelChanged;
+  this->_hasColorTemperatureChanged = replaced->_hasColorTemperatureChanged;
+  this->_hasHueChanged = replaced->_hasHueChanged;
+  this->_hasSaturationChaned = replaced->_hasSaturationChaned;
+  this->_updateObservers.swap(replaced->_updateObservers);
+  this->_deconstructObservers.swap(replaced->_deconstructObservers);
+
+  std::list<DeviceEntityObserver *> observers = this->_deconstructObservers;
+  for (DeviceEntityObserver *observer : this->_updateObservers) {
+    if (std::find(observers.begin(), observers.end(), observer) == observers.end()) {
+      observers.push_back(observer);
+    }
+  }
+  return observers;
+}
+
+bool Light::isCeiling() {
+  return this->_config.ceiling;
 }
 
 void Light::setLightLevel(uint8_t lightLevel) {
@@ -42,7 +65,7 @@ uint16_t Light::getId() {
 }
 
 std::string Light::getName() {
-  return this->_name;
+  return this->_config.name;
 }
 
 uint16_t Light::getLightLevel() {
@@ -62,7 +85,7 @@ uint16_t Light::getSaturation() {
 }
 
 uint8_t Light::getRoomViewPosition() {
-  return this->_roomViewPosition;
+  return this->_config.view_position;
 }
 
 void Light::attachDeconstructCallback(DeviceEntityObserver *observer) {
@@ -80,15 +103,16 @@ void Light::detachDeconstructCallback(DeviceEntityObserver *observer) {
 }
 
 void Light::callDeconstructCallbacks() {
-  LOG_DEBUG("Trying to call deconstruct callback, number of callbacks: ", this->_deconstructObservers.size());
-  vTaskDelay(500 / portTICK_PERIOD_MS);
-  std::list<DeviceEntityObserver *> loop_list;
-  std::copy(this->_deconstructObservers.begin(), this->_deconstructObservers.end(), std::back_inserter(loop_list));
-  for (DeviceEntityObserver *observer : loop_list) {
-    LOG_DEBUG("Calling deconstruct callback!");
-    observer->entityDeconstructCallback(this);
-    vTaskDelay(25 / portTICK_PERIOD_MS);
-  }
+  LOG_DEBUG("Calling deconstruct callbacks, number of callbacks: ", this->_deconstructObservers.size());
+  std::list<DeviceEntity *> entities = {this};
+  DeviceEntity::callDeconstructCallbacks(entities);
+}
+
+std::list<DeviceEntityObserver *> Light::detachAllObservers() {
+  std::list<DeviceEntityObserver *> observers;
+  observers.swap(this->_deconstructObservers);
+  this->_updateObservers.clear();
+  return observers;
 }
 
 void Light::attachUpdateCallback(DeviceEntityObserver *observer) {
@@ -118,15 +142,15 @@ DeviceEntityType Light::getType() {
 }
 
 bool Light::canDim() {
-  return this->_canDim;
+  return this->_config.can_dim;
 }
 
 bool Light::canTemperature() {
-  return this->_canTemperature;
+  return this->_config.can_temperature;
 }
 
 bool Light::canRgb() {
-  return this->_canRgb;
+  return this->_config.can_rgb;
 }
 
 bool Light::hasLevelChanged() {
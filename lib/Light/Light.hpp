@@ -2,14 +2,25 @@
 #define LIGHT_HPP
 
 #include <Arduino.h>
+#include <ArduinoJson.h>
 #include <DeviceEntity.hpp>
+#include <LightConfig.hpp>
 #include <list>
 #include <map>
 #include <string>
 
 class Light : public DeviceEntity {
 public:
-  void initFromMap(std::map<std::string, std::string> &json);
+  /// @brief Set up a new light from its entry in the room config. Published lights are never set up again, a light whose config changed is
+  /// @brief replaced by a new light that takes over its state.
+  /// @param id The light ID, the key of the entry
+  /// @param data The light settings
+  void initFromJson(uint16_t id, JsonObjectConst data);
+  /// @brief True if both lights were set up from the same room config entry
+  bool hasSameConfig(Light *other);
+  /// @brief Continue from the state of the light this light replaces and move its observers to this light
+  /// @return The observers that were moved
+  std::list<DeviceEntityObserver *> takeOver(Light *replaced);
 
   void setLightLevel(uint8_t lightLevel);
   void setColorTemperature(uint16_t colorTemperature);
@@ -23,6 +34,7 @@ public:
   uint16_t getHue();
   uint16_t getSaturation();
   uint8_t getRoomViewPosition();
+  bool isCeiling();
 
   bool canDim();
   bool canTemperature();
@@ -42,6 +54,7 @@ public:
   void attachDeconstructCallback(DeviceEntityObserver *callback);
   void detachDeconstructCallback(DeviceEntityObserver *callback);
   void callDeconstructCallbacks();
+  std::list<DeviceEntityObserver *> detachAllObservers();
 
   void attachUpdateCallback(DeviceEntityObserver *callback);
   void detachUpdateCallback(DeviceEntityObserver *callback);
@@ -53,12 +66,7 @@ private:
   uint16_t _colorTemperature = 0;
   uint16_t _colorHue = 0;
   uint16_t _colorSaturation = 0;
-  uint8_t _roomViewPosition = 0;
-  uint8_t _isCeiling = 0;
-  bool _canDim = false;
-  bool _canTemperature = false;
-  bool _canRgb = false;
-  std::string _name;
+  LightConfig _config;
 
   bool _hasLevelChanged = false;
   bool _hasColorTemperatureChanged = false;
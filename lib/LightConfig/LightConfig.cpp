@@ -0,0 +1,28 @@
+#include <LightConfig.hpp>
+#include <stdlib.h>
+#include <strings.h>
+
+/// @brief The manager sends flags either as JSON booleans or as the strings "true"/"True"
+static bool isTrue(JsonVariantConst value) {
+  if (value.is<bool>()) {
+    return value.as<bool>();
+  }
+  const char *string_value = value.as<const char *>();
+  return string_value != nullptr && strcasecmp(string_value, "true") == 0;
+}
+
+LightConfig LightConfig::fromJson(JsonObjectConst data) {
+  LightConfig config;
+  config.name = data["name"] | "";
+  config.can_dim = isTrue(data["can_dim"]);
+  config.can_temperature = isTrue(data["can_temperature"]);
+  config.can_rgb = isTrue(data["can_rgb"]);
+  config.view_position = data["view_position"].is<const char *>() ? atoi(data["view_position"].as<const char *>()) : data["view_position"].as<uint8_t>();
+  config.ceiling = isTrue(data["ceiling"]);
+  return config;
+}
+
+bool LightConfig::operator==(const LightConfig &other) const {
+  return this->name == other.name && this->can_dim == other.can_dim && this->can_temperature == other.can_temperature && this->can_rgb == other.can_rgb &&
+         this->view_position == other.view_position && this->ceiling == other.ceiling;
+}
@@ -0,0 +1,22 @@
+#ifndef LIGHT_CONFIG_HPP
+#define LIGHT_CONFIG_HPP
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <string>
+
+/// @brief The settings of a light read from its entry in the room config
+struct LightConfig {
+  std::string name;
+  bool can_dim = false;
+  bool can_temperature = false;
+  bool can_rgb = false;
+  uint8_t view_position = 0;
+  bool ceiling = false;
+
+  /// @brief Read the settings from a light entry in the room config
+  static LightConfig fromJson(JsonObjectConst data);
+  bool operator==(const LightConfig &other) const;
+};
+
+#endif
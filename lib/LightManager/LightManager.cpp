@@ -120,7 +120,8 @@ void LightManager::ChangeLightsToColorHue(std::list<Light *> *lights, uint16_t h
 
 std::list<Light *> LightManager::getCeilingLightsThatAreOn() {
   std::list<Light *> lightsThatAreOn;
-  for (auto room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (auto room : rooms.rooms()) {
     for (auto ceilingLight : room->ceilingLights) {
       if (ceilingLight.second->getLightLevel() > 0) {
         lightsThatAreOn.push_back(ceilingLight.second);
@@ -132,7 +133,8 @@ std::list<Light *> LightManager::getCeilingLightsThatAreOn() {
 
 std::list<Light *> LightManager::getTableLightsThatAreOn() {
   std::list<Light *> lightsThatAreOn;
-  for (auto room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (auto room : rooms.rooms()) {
     for (auto tableLight : room->tableLights) {
       if (tableLight.second->getLightLevel() > 0) {
         lightsThatAreOn.push_back(tableLight.second);
@@ -144,7 +146,8 @@ std::list<Light *> LightManager::getTableLightsThatAreOn() {
 
 std::list<Light *> LightManager::getAllLightsThatAreOn() {
   std::list<Light *> return_lights;
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     for (std::pair<uint16_t, Light *> pair : room->ceilingLights) {
       if (pair.second->getLightLevel() > 0) {
         return_lights.push_back(pair.second);
@@ -161,7 +164,8 @@ std::list<Light *> LightManager::getAllLightsThatAreOn() {
 
 std::list<Light *> LightManager::getAllCeilingLightsThatAreOn() {
   std::list<Light *> return_lights;
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     for (std::pair<uint16_t, Light *> pair : room->ceilingLights) {
       if (pair.second->getLightLevel() > 0) {
         return_lights.push_back(pair.second);
@@ -173,7 +177,8 @@ std::list<Light *> LightManager::getAllCeilingLightsThatAreOn() {
 
 std::list<Light *> LightManager::getAllTableLightsThatAreOn() {
   std::list<Light *> return_lights;
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     for (std::pair<uint16_t, Light *> pair : room->tableLights) {
       if (pair.second->getLightLevel() > 0) {
         return_lights.push_back(pair.second);
@@ -185,7 +190,8 @@ std::list<Light *> LightManager::getAllTableLightsThatAreOn() {
 
 std::list<Light *> LightManager::getAllCeilingLights() {
   std::list<Light *> return_lights;
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     for (std::pair<uint16_t, Light *> pair : room->ceilingLights) {
       return_lights.push_back(pair.second);
     }
@@ -195,7 +201,8 @@ std::list<Light *> LightManager::getAllCeilingLights() {
 
 std::list<Light *> LightManager::getAllTableLights() {
   std::list<Light *> return_lights;
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     for (std::pair<uint16_t, Light *> pair : room->tableLights) {
       return_lights.push_back(pair.second);
     }
@@ -205,7 +212,8 @@ std::list<Light *> LightManager::getAllTableLights() {
 
 std::list<Light *> LightManager::getAllLights() {
   std::list<Light *> return_lights;
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     for (std::pair<uint16_t, Light *> pair : room->ceilingLights) {
       return_lights.push_back(pair.second);
     }
@@ -217,7 +225,8 @@ std::list<Light *> LightManager::getAllLights() {
 }
 
 Light *LightManager::getLightById(uint16_t id) {
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     std::unordered_map<uint16_t, Light *>::iterator light = room->ceilingLights.find(id);
     if (light != room->ceilingLights.end()) {
       return light->second;
@@ -232,7 +241,8 @@ Light *LightManager::getLightById(uint16_t id) {
 }
 
 bool LightManager::anyCeilingLightsOn() {
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     for (auto lightPair : room->ceilingLights) {
       if (lightPair.second->getLightLevel() > 0) {
         return true;
@@ -243,7 +253,8 @@ bool LightManager::anyCeilingLightsOn() {
 }
 
 bool LightManager::anyTableLightsOn() {
-  for (Room *room : RoomManager::rooms) {
+  RoomModelSnapshot rooms;
+  for (Room *room : rooms.rooms()) {
     for (auto lightPair : room->tableLights) {
       if (lightPair.second->getLightLevel() > 0) {
         return true;
@@ -265,6 +276,7 @@ void LightManager::subscribeToMqttLightUpdates() {
     }
   }
 
+  RoomModelSnapshot rooms;
   for (Light *light : LightManager::getAllLights()) {
     MqttManager::subscribeToTopic(light->getLevelStateTopic().c_str(), &LightManager::mqttCallback);
 
@@ -315,6 +327,8 @@ void LightManager::_taskProcessMqttMessages(void *param) {
         continue;
       }
       if (msg->topic.find("nspanel/entities/") == 0) { // If topic begins with nspanel/entities/
+        // Keeps the light looked up below alive until the message is processed
+        RoomModelSnapshot rooms;
         std::string domain = msg->topic;
         domain = domain.erase(0, strlen("nspanel/entities/"));
         domain = domain.substr(0, domain.find('/'));
@@ -12,6 +12,8 @@ public:
   static void ChangeLightToColorTemperature(std::list<Light *> *lights, uint16_t kelvin);
   static void ChangeLightsToColorSaturation(std::list<Light *> *lights, uint16_t saturation);
   static void ChangeLightsToColorHue(std::list<Light *> *lights, uint16_t saturation);
+  // The returned lights belong to the published room model and are only valid while the caller holds a RoomModelSnapshot taken before the
+  // call. The snapshot held inside these helpers is released when they return.
   static std::list<Light *> getCeilingLightsThatAreOn();
   static std::list<Light *> getTableLightsThatAreOn();
   static std::list<Light *> getAllCeilingLightsThatAreOn();
@@ -20,6 +22,7 @@ public:
   static std::list<Light *> getAllCeilingLights();
   static std::list<Light *> getAllTableLights();
   static std::list<Light *> getAllLights();
+  // Only valid while the caller holds a RoomModelSnapshot taken before the call
   static Light *getLightById(uint16_t id);
   static bool anyCeilingLightsOn();
   static bool anyTableLightsOn();
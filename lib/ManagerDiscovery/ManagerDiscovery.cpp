@@ -0,0 +1,119 @@
+#include <ConnectionState.hpp>
+#include <ESPmDNS.h>
+#include <HttpClientPool.hpp>
+#include <ManagerDiscovery.hpp>
+#include <MqttLog.hpp>
+#include <NSPMConfig.h>
+
+void ManagerDiscovery::start() {
+  xTaskCreatePinnedToCore(ManagerDiscovery::_taskDiscoverManager, "taskDiscoverManager", 5000, NULL, 1, NULL, CONFIG_ARDUINO_RUNNING_CORE);
+}
+
+void ManagerDiscovery::_init() {
+  portENTER_CRITICAL(&ManagerDiscovery::_initMux);
+  if (ManagerDiscovery::_mutexManager == NULL) {
+    ManagerDiscovery::_mutexManager = xSemaphoreCreateMutex();
+  }
+  portEXIT_CRITICAL(&ManagerDiscovery::_initMux);
+}
+
+bool ManagerDiscovery::discover(std::string *address, uint16_t *port) {
+  int number_of_services = MDNS.queryService(MANAGER_DISCOVERY_SERVICE, MANAGER_DISCOVERY_PROTOCOL);
+  if (number_of_services <= 0) {
+    return false;
+  }
+  *address = MDNS.IP(0).toString().c_str();
+  *port = MDNS.port(0);
+  return true;
+}
+
+bool ManagerDiscovery::setManager(const std::string &address, uint16_t port, ManagerSource source) {
+  if (ManagerDiscovery::_mutexManager == NULL) {
+    ManagerDiscovery::_init();
+  }
+
+  xSemaphoreTake(ManagerDiscovery::_mutexManager, portMAX_DELAY);
+  // Checked and set under the same lock, a register accept can never be replaced by a discovery that finishes after it
+  bool replace = source >= ManagerDiscovery::_managerSource;
+  if (replace) {
+    ManagerDiscovery::_managerAddress = address;
+    ManagerDiscovery::_managerPort = port;
+    ManagerDiscovery::_managerSource = source;
+  }
+  xSemaphoreGive(ManagerDiscovery::_mutexManager);
+
+  if (replace) {
+    ConnectionState::set(CONNECTION_STATE_MANAGER_KNOWN);
+  }
+  return replace;
+}
+
+bool ManagerDiscovery::getManager(std::string *address, uint16_t *port) {
+  if (ManagerDiscovery::_mutexManager == NULL) {
+    ManagerDiscovery::_init();
+  }
+
+  xSemaphoreTake(ManagerDiscovery::_mutexManager, portMAX_DELAY);
+  bool known = ManagerDiscovery::_managerSource != ManagerSource::NONE;
+  if (known) {
+    *address = ManagerDiscovery::_managerAddress;
+    *port = ManagerDiscovery::_managerPort;
+  }
+  xSemaphoreGive(ManagerDiscovery::_mutexManager);
+  return known;
+}
+
+std::string ManagerDiscovery::getManagerUrl() {
+  std::string address;
+  uint16_t port;
+  if (!ManagerDiscovery::getManager(&address, &port)) {
+    return "";
+  }
+  std::string url = "http://";
+  url.append(address);
+  url.append(":");
+  url.append(std::to_string(port));
+  return url;
+}
+
+ManagerSource ManagerDiscovery::getManagerSource() {
+  if (ManagerDiscovery::_mutexManager == NULL) {
+    ManagerDiscovery::_init();
+  }
+
+  xSemaphoreTake(ManagerDiscovery::_mutexManager, portMAX_DELAY);
+  ManagerSource source = ManagerDiscovery::_managerSource;
+  xSemaphoreGive(ManagerDiscovery::_mutexManager);
+  return source;
+}
+
+void ManagerDiscovery::_taskDiscoverManager(void *param) {
+  ConnectionState::waitFor(CONNECTION_STATE_WIFI_CONNECTED, portMAX_DELAY);
+  if (!MDNS.begin(NSPMConfig::instance->wifi_hostname.c_str())) {
+    LOG_ERROR("Failed to start mDNS, will not look for manager.");
+    vTaskDelete(NULL);
+  }
+
+  std::string address;
+  uint16_t port;
+  bool found = false;
+  for (uint8_t attempt = 0; attempt < MANAGER_DISCOVERY_ATTEMPTS && !found && ManagerDiscovery::getManagerSource() != ManagerSource::REGISTERED; attempt++) {
+    found = ManagerDiscovery::discover(&address, &port);
+  }
+
+  if (!found) {
+    LOG_INFO("No manager found with mDNS, waiting for registration.");
+  } else if (ManagerDiscovery::setManager(address, port, ManagerSource::DISCOVERED)) {
+    LOG_INFO("Discovered manager at ", address.c_str(), ":", port);
+    // Open the connection the config is downloaded over while the boot task gets going
+    std::string url = ManagerDiscovery::getManagerUrl();
+    url.append("/");
+    if (!HttpClientPool::prewarm(url.c_str())) {
+      LOG_WARNING("Discovered manager did not answer.");
+    }
+  } else {
+    // The address from register accept is always used over a discovered one
+    LOG_INFO("Discovered manager at ", address.c_str(), ":", port, " but already registered.");
+  }
+  vTaskDelete(NULL);
+}
@@ -0,0 +1,66 @@
+#ifndef MANAGER_DISCOVERY_HPP
+#define MANAGER_DISCOVERY_HPP
+
+#include <Arduino.h>
+#include <string>
+
+// The DNS-SD service advertised by the manager, _nspanelmanager._tcp
+#define MANAGER_DISCOVERY_SERVICE "nspanelmanager"
+#define MANAGER_DISCOVERY_PROTOCOL "tcp"
+// Number of mDNS queries made before giving up and relying on registration over MQTT
+#define MANAGER_DISCOVERY_ATTEMPTS 3
+
+/// @brief Where the manager used to download config from was learnt, in order of how much it is trusted
+enum class ManagerSource {
+  NONE,
+  /// @brief Saved in NSPMConfig from the last register accept
+  SAVED,
+  /// @brief Found with mDNS during this boot
+  DISCOVERED,
+  /// @brief From register accept during this boot
+  REGISTERED,
+};
+
+/// @brief Finds the manager through its mDNS service record as soon as WiFi is up, so that the config can be downloaded
+/// @brief in parallel with connecting to MQTT and registering instead of after register accept.
+/// @brief Also keeps the manager to download config from. It is read and written from several tasks, so it is kept
+/// @brief apart from NSPMConfig::manager_address which only register accept writes.
+class ManagerDiscovery {
+public:
+  /// @brief Start the discovery task, it waits for WiFi and stops once the manager is known
+  static void start();
+  /// @brief Browse for the manager service
+  /// @param address Set to the IP address of the first manager found
+  /// @param port Set to the port of the first manager found
+  /// @return True if a manager was found
+  static bool discover(std::string *address, uint16_t *port);
+  /// @brief Set the manager to download config from and mark it as known, unless a manager from a more trusted source is already set
+  /// @param address The address (hostname or IP) to the manager
+  /// @param port The port to access the manager at
+  /// @param source Where the manager was learnt
+  /// @return True if the manager was set
+  static bool setManager(const std::string &address, uint16_t port, ManagerSource source);
+  /// @brief Get the manager to download config from
+  /// @param address Set to the address of the manager
+  /// @param port Set to the port of the manager
+  /// @return True if a manager is known
+  static bool getManager(std::string *address, uint16_t *port);
+  /// @brief Get the base URL, "http://<address>:<port>", of the manager to download config from
+  /// @return The URL, empty if no manager is known
+  static std::string getManagerUrl();
+  /// @brief Where the current manager was learnt
+  static ManagerSource getManagerSource();
+
+private:
+  static void _taskDiscoverManager(void *param);
+  static void _init();
+
+  static inline std::string _managerAddress;
+  static inline uint16_t _managerPort = 0;
+  static inline ManagerSource _managerSource = ManagerSource::NONE;
+  /// @brief Protects the manager address, port and source
+  static inline SemaphoreHandle_t _mutexManager = NULL;
+  static inline portMUX_TYPE _initMux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <BootProfiler.hpp>
+#include <ConnectionState.hpp>
 #include <MqttLog.hpp>
 #include <MqttManager.hpp>
 #include <NSPMConfig.h>
@@ -184,8 +186,12 @@ void MqttManager::_taskMqttRunTask(void *param) {
       MqttManager::_mqttClient->loop();
       vTaskDelay(25 / portTICK_PERIOD_MS); // Wait 25ms between each tick of MQTT client
     } else {
+      ConnectionState::clear(CONNECTION_STATE_MQTT_CONNECTED);
+      // Connect as soon as WiFi is up
+      ConnectionState::waitFor(CONNECTION_STATE_WIFI_CONNECTED, portMAX_DELAY);
       if (MqttManager::_connect()) {
         MqttManager::_subscribeToAllRegisteredTopics();
+        ConnectionState::set(CONNECTION_STATE_MQTT_CONNECTED);
       } else {
         vTaskDelay(1000 / portTICK_PERIOD_MS);
       }
@@ -231,8 +237,8 @@ bool MqttManager::_connect() {
   Serial.println(NSPMConfig::instance->mqtt_server.c_str());
   MqttManager::_mqttClient->setServer(NSPMConfig::instance->mqtt_server.c_str(), NSPMConfig::instance->mqtt_port);
   LOG_DEBUG("Will try to connect to MQTT Server '", NSPMConfig::instance->mqtt_server.c_str(), "' as user '", NSPMConfig::instance->mqtt_username.c_str(), "' with password '", NSPMConfig::instance->mqtt_password.c_str(), "'.");
+  // connect() returns once the broker has accepted or refused the connection
   MqttManager::_mqttClient->connect(mqtt_device_name.c_str(), NSPMConfig::instance->mqtt_username.c_str(), NSPMConfig::instance->mqtt_password.c_str(), NSPMConfig::instance->mqtt_availability_topic.c_str(), 1, true, offline_message_buffer);
-  vTaskDelay(1000 / portTICK_PERIOD_MS);
   if (MqttManager::connected()) {
     while (!MqttManager::_mqttClient->publish(NSPMConfig::instance->mqtt_availability_topic.c_str(), online_message_buffer, true)) {
       LOG_ERROR("Failed to send online/offline message");
@@ -241,6 +247,7 @@ bool MqttManager::_connect() {
     Serial.print("Connected to MQTT server ");
     Serial.println(NSPMConfig::instance->mqtt_server.c_str());
     LOG_INFO("Connected to MQTT server ", NSPMConfig::instance->mqtt_server.c_str());
+    BootProfiler::mark("mqtt_connected");
     return true;
   } else {
     LOG_ERROR("Failed to connect to MQTT. Will try again in 1 seconds");
@@ -4,6 +4,9 @@
 #include <MqttLog.hpp>
 #include <NSPMConfig.h>
 #include <WiFi.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+#include <string.h>
 
 // NSPMConfig
 // Give somewhere in memory for instance to exist
@@ -28,26 +31,47 @@ bool NSPMConfig::init() {
 
 bool NSPMConfig::loadFromLittleFS() {
   Serial.println("Loading config from LittleFS");
-  File configFile = LittleFS.open("/config.json");
-  if (!configFile) {
-    Serial.println("Failed to open config.json!");
-    return false;
+  NSPMConfigRecord record;
+  File configFile = LittleFS.open(NSPM_CONFIG_PATH);
+  bool record_valid = false;
+  if (configFile) {
+    record_valid = configFile.read((uint8_t *)&record, sizeof(record)) == sizeof(record) && NSPMConfig::_isRecordValid(record);
+    configFile.close();
   }
 
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, configFile);
-  configFile.close();
-  if (error) {
-    Serial.println("Failed to deserialize config.json");
+  if (record_valid) {
+    this->_fromRecord(record);
+  } else if (LittleFS.exists(NSPM_CONFIG_LEGACY_JSON_PATH)) {
+    // Migrate from the JSON config used by earlier firmware versions
+    Serial.println("No valid binary config, migrating config.json");
+    File jsonFile = LittleFS.open(NSPM_CONFIG_LEGACY_JSON_PATH);
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, jsonFile);
+    jsonFile.close();
+    if (error) {
+      Serial.println("Failed to deserialize config.json");
+      return false;
+    }
+    this->fromJson(doc);
+    if (!this->saveToLittleFS(false)) {
+      return false;
+    }
+  } else {
+    Serial.println("No valid config found!");
     return false;
   }
 
-  // Load config data
+  this->_updateTopics();
+  Serial.println("Config data loaded.");
+  return true;
+}
+
+void NSPMConfig::fromJson(JsonDocument &doc) {
   this->wifi_hostname = doc["wifi_hostname"] | "NSPMPanel";
   this->wifi_ssid = doc["wifi_ssid"] | "";
   this->wifi_psk = doc["wifi_psk"] | "";
-  this->manager_address = "";                                                              // Manager address is set from a register accept from manager. This value is not used.
-  this->manager_port = 8000;                                                               // Manager address is set from a register accept from manager. This value is not used.
+  this->manager_address = doc["manager_address"] | "";                                     // Last manager that accepted a register request, used at boot until registered again.
+  this->manager_port = doc.containsKey("manager_port") ? doc["manager_port"].as<uint16_t>() : 8000;
   this->logging_level = doc.containsKey("log_level") ? doc["log_level"].as<uint8_t>() : 3; // Set logging to info if no level was read from file.
 
   this->mqtt_server = doc["mqtt_server"] | "";
@@ -56,12 +80,39 @@ bool NSPMConfig::loadFromLittleFS() {
   this->mqtt_password = doc["mqtt_password"] | "";
 
   this->tft_upload_baud = doc.containsKey("upload_baud") ? doc["upload_baud"].as<uint32_t>() : 115200;
+  this->tft_auto_upload_baud = doc.containsKey("auto_upload_baud") ? doc["auto_upload_baud"].as<uint32_t>() : 0;
   this->use_new_upload_protocol = doc.containsKey("use_new_upload_protocol") ? doc["use_new_upload_protocol"].as<String>() == "true" : true;
 
   this->relay1_default_mode = doc.containsKey("relay1_default_mode") ? doc["relay1_default_mode"].as<String>() == "True" : false;
   this->relay2_default_mode = doc.containsKey("relay2_default_mode") ? doc["relay2_default_mode"].as<String>() == "True" : false;
 
-  // Load calculated values
+  this->md5_firmware = doc["md5_firmware"] | "";
+  this->md5_data_file = doc["md5_data_file"] | "";
+  this->md5_tft_file = doc["md5_tft_file"] | "";
+}
+
+void NSPMConfig::toJson(JsonDocument &doc) {
+  doc["wifi_hostname"] = this->wifi_hostname.c_str();
+  doc["wifi_ssid"] = this->wifi_ssid.c_str();
+  doc["wifi_psk"] = this->wifi_psk.c_str();
+  doc["mqtt_server"] = this->mqtt_server.c_str();
+  doc["mqtt_port"] = this->mqtt_port;
+  doc["mqtt_username"] = this->mqtt_username.c_str();
+  doc["mqtt_password"] = this->mqtt_password.c_str();
+  doc["manager_address"] = this->manager_address.c_str();
+  doc["manager_port"] = this->manager_port;
+  doc["log_level"] = this->logging_level;
+  doc["md5_firmware"] = this->md5_firmware.c_str();
+  doc["md5_data_file"] = this->md5_data_file.c_str();
+  doc["md5_tft_file"] = this->md5_tft_file.c_str();
+  doc["upload_baud"] = this->tft_upload_baud;
+  doc["auto_upload_baud"] = this->tft_auto_upload_baud;
+  doc["use_new_upload_protocol"] = this->use_new_upload_protocol ? "true" : "false";
+  doc["relay1_default_mode"] = this->relay1_default_mode ? "True" : "False";
+  doc["relay2_default_mode"] = this->relay2_default_mode ? "True" : "False";
+}
+
+void NSPMConfig::_updateTopics() {
   this->mqtt_availability_topic = "nspanel/";
   this->mqtt_availability_topic.append(NSPMConfig::instance->wifi_hostname);
   this->mqtt_availability_topic.append("/status");
@@ -86,6 +137,10 @@ bool NSPMConfig::loadFromLittleFS() {
   this->mqtt_panel_status_topic.append(NSPMConfig::instance->wifi_hostname);
   this->mqtt_panel_status_topic.append("/status_report");
 
+  this->mqtt_panel_boot_timeline_topic = "nspanel/";
+  this->mqtt_panel_boot_timeline_topic.append(NSPMConfig::instance->wifi_hostname);
+  this->mqtt_panel_boot_timeline_topic.append("/boot_timeline");
+
   this->mqtt_panel_temperature_topic = "nspanel/";
   this->mqtt_panel_temperature_topic.append(NSPMConfig::instance->wifi_hostname);
   this->mqtt_panel_temperature_topic.append("/temperature_state");
@@ -117,15 +172,82 @@ bool NSPMConfig::loadFromLittleFS() {
   this->mqtt_relay2_state_topic = "nspanel/";
   this->mqtt_relay2_state_topic.append(NSPMConfig::instance->wifi_hostname);
   this->mqtt_relay2_state_topic.append("/r2_state");
+}
 
-  this->md5_firmware = doc["md5_firmware"] | "";
-  this->md5_data_file = doc["md5_data_file"] | "";
-  this->md5_tft_file = doc["md5_tft_file"] | "";
-
-  Serial.println("Config data loaded.");
+bool NSPMConfig::_isRecordValid(NSPMConfigRecord &record) {
+  if (record.magic != NSPM_CONFIG_RECORD_MAGIC || record.version != NSPM_CONFIG_RECORD_VERSION || record.size != sizeof(NSPMConfigRecord)) {
+    Serial.println("Config record has unknown format.");
+    return false;
+  }
+  if (record.crc != NSPMConfig::_getRecordCrc(record)) {
+    Serial.println("Config record CRC mismatch!");
+    return false;
+  }
   return true;
 }
 
+uint32_t NSPMConfig::_getRecordCrc(NSPMConfigRecord &record) {
+  return esp_rom_crc32_le(0, (const uint8_t *)&record, offsetof(NSPMConfigRecord, crc));
+}
+
+/// @brief Copy a string into a fixed size record field, warns if truncated
+static void copyToRecordField(char *field, size_t field_size, std::string &value, const char *name) {
+  if (value.length() >= field_size) {
+    Serial.printf("Config value %s is too long and was truncated to %u characters.\n", name, (unsigned)(field_size - 1));
+  }
+  strlcpy(field, value.c_str(), field_size);
+}
+
+#define TO_RECORD_STRING(member) copyToRecordField(record->member, sizeof(record->member), this->member, #member)
+#define FROM_RECORD_STRING(member) this->member.assign(record.member, strnlen(record.member, sizeof(record.member)))
+
+void NSPMConfig::_toRecord(NSPMConfigRecord *record) {
+  memset(record, 0, sizeof(NSPMConfigRecord));
+  record->magic = NSPM_CONFIG_RECORD_MAGIC;
+  record->version = NSPM_CONFIG_RECORD_VERSION;
+  record->size = sizeof(NSPMConfigRecord);
+  TO_RECORD_STRING(wifi_hostname);
+  TO_RECORD_STRING(wifi_ssid);
+  TO_RECORD_STRING(wifi_psk);
+  TO_RECORD_STRING(mqtt_server);
+  TO_RECORD_STRING(mqtt_username);
+  TO_RECORD_STRING(mqtt_password);
+  TO_RECORD_STRING(manager_address);
+  TO_RECORD_STRING(md5_firmware);
+  TO_RECORD_STRING(md5_data_file);
+  TO_RECORD_STRING(md5_tft_file);
+  record->mqtt_port = this->mqtt_port;
+  record->manager_port = this->manager_port;
+  record->tft_upload_baud = this->tft_upload_baud;
+  record->tft_auto_upload_baud = this->tft_auto_upload_baud;
+  record->logging_level = this->logging_level;
+  record->use_new_upload_protocol = this->use_new_upload_protocol;
+  record->relay1_default_mode = this->relay1_default_mode;
+  record->relay2_default_mode = this->relay2_default_mode;
+  record->crc = NSPMConfig::_getRecordCrc(*record);
+}
+
+void NSPMConfig::_fromRecord(NSPMConfigRecord &record) {
+  FROM_RECORD_STRING(wifi_hostname);
+  FROM_RECORD_STRING(wifi_ssid);
+  FROM_RECORD_STRING(wifi_psk);
+  FROM_RECORD_STRING(mqtt_server);
+  FROM_RECORD_STRING(mqtt_username);
+  FROM_RECORD_STRING(mqtt_password);
+  FROM_RECORD_STRING(manager_address);
+  FROM_RECORD_STRING(md5_firmware);
+  FROM_RECORD_STRING(md5_data_file);
+  FROM_RECORD_STRING(md5_tft_file);
+  this->mqtt_port = record.mqtt_port;
+  this->manager_port = record.manager_port;
+  this->tft_upload_baud = record.tft_upload_baud;
+  this->tft_auto_upload_baud = record.tft_auto_upload_baud;
+  this->logging_level = record.logging_level;
+  this->use_new_upload_protocol = record.use_new_upload_protocol;
+  this->relay1_default_mode = record.relay1_default_mode;
+  this->relay2_default_mode = record.relay2_default_mode;
+}
+
 bool NSPMConfig::saveToLittleFS(bool remountLittleFs) {
   if (remountLittleFs) {
     LOG_INFO("Unmounting LittleFS.");
@@ -141,43 +263,34 @@ bool NSPMConfig::saveToLittleFS(bool remountLittleFs) {
     }
   }
 
-  JsonDocument config_json;
-
-  config_json["wifi_hostname"] = this->wifi_hostname.c_str();
-  config_json["wifi_ssid"] = this->wifi_ssid.c_str();
-  config_json["wifi_psk"] = this->wifi_psk.c_str();
-  config_json["mqtt_server"] = this->mqtt_server.c_str();
-  config_json["mqtt_port"] = this->mqtt_port;
-  config_json["mqtt_username"] = this->mqtt_username.c_str();
-  config_json["mqtt_password"] = this->mqtt_password.c_str();
-  config_json["log_level"] = this->logging_level;
-  config_json["md5_firmware"] = this->md5_firmware.c_str();
-  config_json["md5_data_file"] = this->md5_data_file.c_str();
-  config_json["md5_tft_file"] = this->md5_tft_file.c_str();
-  config_json["upload_baud"] = this->tft_upload_baud;
-  config_json["use_new_upload_protocol"] = this->use_new_upload_protocol ? "true" : "false";
-  config_json["relay1_default_mode"] = this->relay1_default_mode ? "True" : "False";
-  config_json["relay2_default_mode"] = this->relay2_default_mode ? "True" : "False";
-
-  Serial.println("Serializing JSON");
-  String config_string;
-  size_t error = serializeJson(config_json, config_string);
-  if (error == 0) {
-    Serial.println("Failed to serialize JSON!");
-    LOG_ERROR("Failed to serialize JSON!");
-  }
+  NSPMConfigRecord record;
+  this->_toRecord(&record);
 
-  File config_file = LittleFS.open("/config.json", FILE_WRITE);
+  // Write the new record next to the old one and replace it in one rename, a power cut while writing leaves the old config intact
+  File config_file = LittleFS.open(NSPM_CONFIG_TMP_PATH, FILE_WRITE);
   if (!config_file) {
-    Serial.println("Failed to open 'config.json' for writing.");
-    LOG_ERROR("Failed to open 'config.json' for writing.");
+    Serial.println("Failed to open config file for writing.");
+    LOG_ERROR("Failed to open config file for writing.");
     return false;
   }
-
-  Serial.println("Writing the following the config:");
-  Serial.println(config_string);
-  config_file.print(config_string);
+  size_t written = config_file.write((uint8_t *)&record, sizeof(record));
   config_file.close();
+  if (written != sizeof(record)) {
+    Serial.println("Failed to write config file.");
+    LOG_ERROR("Failed to write config file.");
+    LittleFS.remove(NSPM_CONFIG_TMP_PATH);
+    return false;
+  }
+  if (!LittleFS.rename(NSPM_CONFIG_TMP_PATH, NSPM_CONFIG_PATH)) {
+    Serial.println("Failed to replace config file.");
+    LOG_ERROR("Failed to replace config file.");
+    return false;
+  }
+
+  if (!this->_saveLegacyJson()) {
+    // The binary record is what this firmware loads, only a rollback to an earlier firmware needs config.json
+    LOG_WARNING("Failed to write config.json, settings will be lost if an earlier firmware is installed.");
+  }
 
   Serial.println("Config saved.");
   LOG_INFO("Config saved.");
@@ -185,6 +298,23 @@ bool NSPMConfig::saveToLittleFS(bool remountLittleFs) {
   return true;
 }
 
+bool NSPMConfig::_saveLegacyJson() {
+  JsonDocument doc;
+  this->toJson(doc);
+  File json_file = LittleFS.open(NSPM_CONFIG_LEGACY_JSON_TMP_PATH, FILE_WRITE);
+  if (!json_file) {
+    return false;
+  }
+  size_t length = measureJson(doc);
+  size_t written = serializeJson(doc, json_file);
+  json_file.close();
+  if (written != length) {
+    LittleFS.remove(NSPM_CONFIG_LEGACY_JSON_TMP_PATH);
+    return false;
+  }
+  return LittleFS.rename(NSPM_CONFIG_LEGACY_JSON_TMP_PATH, NSPM_CONFIG_LEGACY_JSON_PATH);
+}
+
 bool NSPMConfig::factoryReset() {
   Serial.println("Performing a factory reset.");
   this->wifi_hostname = "NSPMPanel";
@@ -196,5 +326,7 @@ bool NSPMConfig::factoryReset() {
   this->mqtt_port = 1883;
   this->mqtt_username = "";
   this->mqtt_password = "";
+  this->manager_address = "";
+  this->manager_port = 8000;
   return this->saveToLittleFS(false);
 }
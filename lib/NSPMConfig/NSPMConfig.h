@@ -1,8 +1,50 @@
 #ifndef NSPMConfig_H
 #define NSPMConfig_H
 
+#include <ArduinoJson.h>
+#include <stdint.h>
 #include <string>
 
+// The config is stored as a fixed size binary record, replaced atomically through NSPM_CONFIG_TMP_PATH
+#define NSPM_CONFIG_PATH "/config.bin"
+#define NSPM_CONFIG_TMP_PATH "/config.bin.tmp"
+// Config file used by earlier firmware versions, migrated to NSPM_CONFIG_PATH at boot. It is kept and
+// written on every save so that rolling back to an earlier firmware keeps the settings. Remove once
+// a release has shipped with the binary record.
+#define NSPM_CONFIG_LEGACY_JSON_PATH "/config.json"
+#define NSPM_CONFIG_LEGACY_JSON_TMP_PATH "/config.json.tmp"
+#define NSPM_CONFIG_RECORD_MAGIC 0x4E53504D // "NSPM"
+// Increase when the layout of NSPMConfigRecord changes
+#define NSPM_CONFIG_RECORD_VERSION 1
+
+/// @brief The persisted part of NSPMConfig as stored on LittleFS
+struct NSPMConfigRecord {
+  uint32_t magic;
+  uint16_t version;
+  /// @brief sizeof(NSPMConfigRecord) when written
+  uint16_t size;
+  char wifi_hostname[64];
+  char wifi_ssid[33];
+  char wifi_psk[65];
+  char mqtt_server[128];
+  char mqtt_username[64];
+  char mqtt_password[64];
+  char manager_address[128];
+  char md5_firmware[33];
+  char md5_data_file[33];
+  char md5_tft_file[33];
+  uint16_t mqtt_port;
+  uint16_t manager_port;
+  uint32_t tft_upload_baud;
+  uint32_t tft_auto_upload_baud;
+  uint8_t logging_level;
+  bool use_new_upload_protocol;
+  bool relay1_default_mode;
+  bool relay2_default_mode;
+  /// @brief CRC32 of all fields above
+  uint32_t crc;
+};
+
 enum BUTTON_MODE {
   DIRECT,
   DETACHED,
@@ -15,8 +57,8 @@ public:
   /// @brief Will try to initialize and load LittleFS
   /// @return True if successful
   bool init();
-  /// @brief Load config file from LittleFS
-  /// @return True if successful
+  /// @brief Load config file from LittleFS, migrating config.json from earlier firmware versions if needed
+  /// @return True if a valid config was loaded
   bool loadFromLittleFS();
   /// @brief Save current config file to LittleFS
   /// @param remountLittleFs: boolean on wether or not to remount littlefs before trying to save the config
@@ -25,13 +67,17 @@ public:
   /// @brief Reset all values to default
   /// @return True if successfuly saved to LittleFS
   bool factoryReset();
+  /// @brief Set the persisted values from a JSON document, as written by toJson
+  void fromJson(JsonDocument &doc);
+  /// @brief Export the persisted values as JSON
+  void toJson(JsonDocument &doc);
   /// @brief The instance of the config manager
   static NSPMConfig *instance;
 
   /// @brief Indicates that a config has successfully been loaded from the manager.
   bool successful_config_load = false;
 
-  /// @brief The address (hostname or IP) to the manager server
+  /// @brief The address (hostname or IP) to the manager server. Saved from the last register accept, empty if never registered.
   std::string manager_address = "";
   /// @brief The port to access to manager at
   uint16_t manager_port = 8000;
@@ -58,6 +104,8 @@ public:
   std::string mqtt_availability_topic = "";
   /// @brief MQTT panel status topic
   std::string mqtt_panel_status_topic = "";
+  /// @brief MQTT topic the boot timeline is published to once boot completes
+  std::string mqtt_panel_boot_timeline_topic = "";
   /// @brief MQTT panel command topic
   std::string mqtt_panel_cmd_topic = "";
   /// @brief MQTT screen brightness topic
@@ -83,8 +131,10 @@ public:
   /// @brief The MQTT topic to send on/off state updates for relay 2
   std::string mqtt_relay2_state_topic = "";
 
-  /// @brief The upload baud rate for the serial connection when uploading a new TFT file
+  /// @brief The upload baud rate for the serial connection when uploading a new TFT file. 0 = Auto, probe for the fastest supported baud rate.
   uint32_t tft_upload_baud = 115200;
+  /// @brief The fastest baud rate found to work with this panel when tft_upload_baud is set to auto. 0 = Not yet probed.
+  uint32_t tft_auto_upload_baud = 0;
   /// @brief Wether or not to use the "v1.2" protcol or the v1.0
   bool use_new_upload_protocol = true;
 
@@ -137,6 +187,18 @@ public:
 
   /// @brief Indicates what TFT and checksums to check.
   bool is_us_panel = false;
+
+private:
+  void _toRecord(NSPMConfigRecord *record);
+  void _fromRecord(NSPMConfigRecord &record);
+  /// @brief Check magic, version, size and CRC of a record read from LittleFS
+  static bool _isRecordValid(NSPMConfigRecord &record);
+  static uint32_t _getRecordCrc(NSPMConfigRecord &record);
+  /// @brief Build the MQTT topics from the hostname
+  void _updateTopics();
+  /// @brief Write the config as config.json for earlier firmware versions, see NSPM_CONFIG_LEGACY_JSON_PATH
+  /// @return True if successful
+  bool _saveLegacyJson();
 };
 
 #endif
@@ -1,8 +1,12 @@
 #include "freertos/portmacro.h"
 #include <Arduino.h>
+#include <BootProfiler.hpp>
 #include <ChunkDownloader.hpp>
 #include <HTTPClient.h>
+#include <HeatshrinkDownloader.hpp>
 #include <HttpLib.hpp>
+#include <MD5Builder.h>
+#include <ManagerDiscovery.hpp>
 #include <MqttLog.hpp>
 #include <MqttManager.hpp>
 #include <NSPMConfig.h>
@@ -170,11 +174,13 @@ bool NSPanel::init() {
   vTaskDelay(1000 / portTICK_PERIOD_MS);
   digitalWrite(4, LOW); // Turn on power to the display
   vTaskDelay(1000 / portTICK_PERIOD_MS);
+  BootProfiler::mark("nspanel_power_cycled");
 
   std::string result = "";
   this->_readDataToString(&result, 2500, false);
   if (result.compare("NSPM") == 0) {
     this->_has_received_nspm = true;
+    BootProfiler::mark("nspanel_nspm_received");
   }
 
   LOG_DEBUG("Got text from panel: ", result.c_str());
@@ -559,9 +565,7 @@ uint16_t NSPanel::_readDataToString(std::string *data, uint32_t timeout, bool fi
   return data->length();
 }
 
-void NSPanel::_taskUpdateTFTConfigOTA(void *param) {
-  LOG_INFO("Starting TFT update...");
-
+void NSPanel::_lockSerialForTFTUpdate() {
   while (true) {
     if (xSemaphoreTake(NSPanel::instance->_mutexReadSerialData, 1000 / portTICK_PERIOD_MS)) {
       break;
@@ -579,18 +583,196 @@ void NSPanel::_taskUpdateTFTConfigOTA(void *param) {
       vTaskDelay(3000 / portTICK_PERIOD_MS);
     }
   }
+}
 
-  for (;;) {
-    bool updateResult = NSPanel::_updateTFTOTA();
-    if (updateResult) {
-      LOG_INFO("Update of TFT successful, will reboot.");
-      ESP.restart();
+uint32_t NSPanel::_readTFTUploadOffset(std::string *return_string) {
+  while (return_string->length() < 5) {
+    LOG_TRACE("Waiting for offset data byte ", return_string->length() - 1);
+    while (Serial2.available() <= 0) {
+      vTaskDelay(20 / portTICK_PERIOD_MS);
+    }
+    return_string->push_back(Serial2.read());
+  }
+  uint32_t offset = (uint8_t)(*return_string)[1];
+  offset |= (uint8_t)(*return_string)[2] << 8;
+  offset |= (uint8_t)(*return_string)[3] << 16;
+  offset |= (uint32_t)(uint8_t)(*return_string)[4] << 24;
+  return offset;
+}
+
+void NSPanel::_taskUpdateTFTConfigOTA(void *param) {
+  NSPanel::instance->updateTFT();
+  NSPMConfig::instance->saveToLittleFS(false);
+  LOG_INFO("Update of TFT successful, will reboot in 5 seconds.");
+  vTaskDelay(5000 / portTICK_PERIOD_MS);
+  ESP.restart();
+
+  vTaskDelete(NULL);
+}
+
+void NSPanel::updateTFT() {
+  LOG_INFO("Starting TFT update...");
+  NSPanel::_lockSerialForTFTUpdate();
+
+  NSPanel::_tftUploadBaudRate = NSPanel::_getInitialTFTUploadBaudRate();
+  NSPanel::_tftUploadStats = NSPanelTFTUploadStats();
+  while (!NSPanel::_updateTFTOTA()) {
+    LOG_ERROR("Failed to update TFT. Will try again in 5 seconds.");
+    vTaskDelay(5000 / portTICK_PERIOD_MS);
+  }
+  NSPanel::_updateAutoTFTUploadBaudRate();
+  LOG_INFO("Update of TFT successful.");
+}
+
+bool NSPanel::startTFTUploadFromStream(size_t size) {
+  if (this->_isUpdating || NSPanel::_tftUploadStream != NULL) {
+    LOG_ERROR("A TFT update is already in progress.");
+    return false;
+  }
+  NSPanel::_tftUploadStream = xStreamBufferCreate(TFT_STREAM_UPLOAD_BUFFER_SIZE, 1);
+  if (NSPanel::_tftUploadStream == NULL) {
+    LOG_ERROR("Failed to create TFT upload stream buffer.");
+    return false;
+  }
+  NSPanel::_tftUploadStreamSize = size;
+  NSPanel::_tftUploadStreamReady = false;
+  NSPanel::_tftUploadStreamFailed = false;
+  if (xTaskCreatePinnedToCore(_taskUpdateTFTFromStream, "taskUpdateTFTFromStream", 10000, NULL, 1, NULL, CONFIG_ARDUINO_RUNNING_CORE) != pdPASS) {
+    LOG_ERROR("Failed to create task to update TFT from stream.");
+    vStreamBufferDelete(NSPanel::_tftUploadStream);
+    NSPanel::_tftUploadStream = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool NSPanel::isReadyForTFTUploadData() {
+  return NSPanel::_tftUploadStreamReady;
+}
+
+bool NSPanel::hasTFTUploadFailed() {
+  return NSPanel::_tftUploadStreamFailed;
+}
+
+size_t NSPanel::getTFTUploadSpaceAvailable() {
+  if (NSPanel::_tftUploadStream == NULL || NSPanel::_tftUploadStreamFailed) {
+    return 0;
+  }
+  return xStreamBufferSpacesAvailable(NSPanel::_tftUploadStream);
+}
+
+bool NSPanel::writeTFTUploadData(const uint8_t *data, size_t length) {
+  if (NSPanel::_tftUploadStream == NULL || NSPanel::_tftUploadStreamFailed) {
+    return false;
+  }
+  // Called from the web server, which must never wait for the panel
+  if (xStreamBufferSend(NSPanel::_tftUploadStream, data, length, 0) != length) {
+    LOG_ERROR("TFT upload buffer full, the uploaded data was not accepted.");
+    NSPanel::_tftUploadStreamFailed = true;
+    return false;
+  }
+  return true;
+}
+
+bool NSPanel::_readTFTUploadStream(uint8_t *buffer, size_t size) {
+  size_t received = 0;
+  while (received < size) {
+    size_t read = xStreamBufferReceive(NSPanel::_tftUploadStream, &buffer[received], size - received, TFT_STREAM_UPLOAD_READ_TIMEOUT_MS / portTICK_PERIOD_MS);
+    if (read == 0) {
+      LOG_ERROR("Timeout while waiting for TFT data from upload.");
+      return false;
+    }
+    received += read;
+  }
+  return true;
+}
+
+void NSPanel::_taskUpdateTFTFromStream(void *param) {
+  LOG_INFO("Starting TFT update from uploaded file, size: ", NSPanel::_tftUploadStreamSize);
+  NSPanel::_lockSerialForTFTUpdate();
+
+  NSPanel::_tftUploadBaudRate = NSPanel::_getInitialTFTUploadBaudRate();
+  NSPanel::_tftUploadStats = NSPanelTFTUploadStats();
+  NSPanel::_tftUploadStats.attempts = 1;
+  bool success = NSPanel::_initTFTUpdate(115200, NSPanel::_tftUploadStreamSize);
+  NSPanel::_tftUploadStats.baud_rate = NSPanel::_tftUploadBaudRate;
+  NSPanel::_tftUploadStreamReady = success;
+
+  // The uploaded data can't be read twice, so unlike the manager download the panel can only be asked to skip forward.
+  uint8_t dataBuffer[4096];
+  MD5Builder tft_md5;
+  tft_md5.begin();
+  size_t file_size = NSPanel::_tftUploadStreamSize;
+  size_t position = 0;
+  while (success && position < file_size) {
+    size_t next_write_size = file_size - position > sizeof(dataBuffer) ? sizeof(dataBuffer) : file_size - position;
+    if (!NSPanel::_readTFTUploadStream(dataBuffer, next_write_size)) {
+      success = false;
+      break;
+    }
+    tft_md5.add(dataBuffer, next_write_size);
+
+    unsigned long block_write_start = millis();
+    Serial2.write(dataBuffer, next_write_size);
+    position += next_write_size;
+    NSPanel::instance->_update_progress = ((float)position / (float)file_size) * 100;
+
+    std::string return_string;
+    NSPanel::instance->_readDataToString(&return_string, 5000, true);
+    unsigned long block_panel_time = millis() - block_write_start;
+    NSPanel::_tftUploadStats.uart_bytes += next_write_size;
+    NSPanel::_tftUploadStats.uart_time_ms += block_panel_time;
+    NSPanel::_addToTFTUploadHistogram(NSPanel::_tftUploadStats.ack_latency_histogram, block_panel_time);
+
+    if (position >= file_size) {
+      break;
+    } else if (return_string[0] == 0x05) {
+      LOG_TRACE("Got 0x05, uploading next chunk.");
+    } else if (return_string[0] == 0x08) {
+      uint32_t next_offset = NSPanel::_readTFTUploadOffset(&return_string);
+      if (next_offset > 0 && next_offset < position) {
+        LOG_ERROR("Panel asked to continue from ", next_offset, " which has already been uploaded.");
+        success = false;
+        break;
+      }
+      if (next_offset > 0) {
+        NSPanel::_tftUploadStats.offset_jumps++;
+        LOG_INFO("Got 0x08 with offset, skipping to: ", next_offset);
+        while (position < next_offset) {
+          size_t skip_size = next_offset - position > sizeof(dataBuffer) ? sizeof(dataBuffer) : next_offset - position;
+          if (!NSPanel::_readTFTUploadStream(dataBuffer, skip_size)) {
+            success = false;
+            break;
+          }
+          tft_md5.add(dataBuffer, skip_size);
+          position += skip_size;
+        }
+        if (!success) {
+          break;
+        }
+      }
     } else {
-      LOG_ERROR("Failed to update TFT. Will try again in 5 seconds.");
-      vTaskDelay(5000 / portTICK_PERIOD_MS);
+      NSPanel::_tftUploadStats.unexpected_responses++;
+      LOG_DEBUG("Got unexpected return data from panel.");
     }
   }
+  NSPanel::_logTFTUploadStats();
+
+  if (success) {
+    tft_md5.calculate();
+    LOG_INFO("TFT upload complete, MD5: ", tft_md5.toString().c_str());
+    NSPanel::instance->_update_progress = 100;
+    NSPMConfig::instance->md5_tft_file = tft_md5.toString().c_str();
+    NSPanel::_updateAutoTFTUploadBaudRate();
+    NSPMConfig::instance->saveToLittleFS(false);
+  } else {
+    NSPanel::_tftUploadStreamFailed = true;
+    LOG_ERROR("TFT upload from stream failed.");
+  }
 
+  LOG_INFO("Will restart in 5 seconds.");
+  vTaskDelay(5000 / portTICK_PERIOD_MS);
+  ESP.restart();
   vTaskDelete(NULL);
 }
 
@@ -602,6 +784,58 @@ uint8_t NSPanel::getUpdateProgress() {
   return this->_update_progress;
 }
 
+void NSPanel::getTFTUploadStats(JsonObject object) {
+  NSPanelTFTUploadStats *stats = &NSPanel::_tftUploadStats;
+  object["attempts"] = stats->attempts;
+  object["baud"] = stats->baud_rate;
+  object["compressed"] = stats->compressed;
+  object["net_bytes"] = stats->network_bytes;
+  object["net_bps"] = stats->network_time_ms > 0 ? ((uint64_t)stats->network_bytes * 1000) / stats->network_time_ms : 0;
+  object["uart_bytes"] = stats->uart_bytes;
+  object["uart_bps"] = stats->uart_time_ms > 0 ? ((uint64_t)stats->uart_bytes * 1000) / stats->uart_time_ms : 0;
+  object["retries"] = stats->download_retries;
+  object["unexpected"] = stats->unexpected_responses;
+  object["jumps"] = stats->offset_jumps;
+  JsonArray download_latency = object["dl_ms_hist"].to<JsonArray>();
+  JsonArray ack_latency = object["ack_ms_hist"].to<JsonArray>();
+  for (int i = 0; i < TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS; i++) {
+    download_latency.add(stats->download_latency_histogram[i]);
+    ack_latency.add(stats->ack_latency_histogram[i]);
+  }
+}
+
+void NSPanel::_addToTFTUploadHistogram(uint16_t *histogram, unsigned long latency_ms) {
+  for (int i = 0; i < TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS; i++) {
+    if (latency_ms <= NSPanelTFTUploadStats::histogram_bucket_limits[i] || i == TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS - 1) {
+      histogram[i]++;
+      return;
+    }
+  }
+}
+
+void NSPanel::_logTFTUploadStats() {
+  NSPanelTFTUploadStats *stats = &NSPanel::_tftUploadStats;
+  LOG_INFO("TFT upload stats: attempts ", stats->attempts, ", baud ", stats->baud_rate, ", compressed ", stats->compressed ? "yes" : "no",
+           ", retries ", stats->download_retries, ", unexpected responses ", stats->unexpected_responses, ", offset jumps ", stats->offset_jumps);
+  LOG_INFO("TFT upload stats: network ", stats->network_bytes, " bytes in ", stats->network_time_ms, " ms (",
+           stats->network_time_ms > 0 ? ((uint64_t)stats->network_bytes * 1000) / stats->network_time_ms : 0, " B/s), UART ",
+           stats->uart_bytes, " bytes in ", stats->uart_time_ms, " ms (",
+           stats->uart_time_ms > 0 ? ((uint64_t)stats->uart_bytes * 1000) / stats->uart_time_ms : 0, " B/s)");
+  std::string download_histogram;
+  std::string ack_histogram;
+  for (int i = 0; i < TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS; i++) {
+    std::string bucket = i == TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS - 1 ? " >" + std::to_string(NSPanelTFTUploadStats::histogram_bucket_limits[i - 1]) : " <=" + std::to_string(NSPanelTFTUploadStats::histogram_bucket_limits[i]);
+    download_histogram.append(bucket);
+    download_histogram.append(":");
+    download_histogram.append(std::to_string(stats->download_latency_histogram[i]));
+    ack_histogram.append(bucket);
+    ack_histogram.append(":");
+    ack_histogram.append(std::to_string(stats->ack_latency_histogram[i]));
+  }
+  LOG_INFO("TFT upload stats: download latency (ms)", download_histogram.c_str());
+  LOG_INFO("TFT upload stats: panel ack latency (ms)", ack_histogram.c_str());
+}
+
 std::string NSPanel::getWarnings() {
   std::string return_string = "";
   if (!NSPanel::instance->_has_received_nspm) {
@@ -614,10 +848,46 @@ bool NSPanel::ready() {
   return this->_has_received_nspm;
 }
 
-bool NSPanel::_initTFTUpdate(int communication_baud_rate) {
-  LOG_INFO("Trying to initialize TFT update at baud ", communication_baud_rate);
-  Serial2.updateBaudRate(communication_baud_rate);
+uint32_t NSPanel::_getInitialTFTUploadBaudRate() {
+  if (NSPMConfig::instance->tft_upload_baud != 0) {
+    return NSPMConfig::instance->tft_upload_baud;
+  }
+
+  if (NSPMConfig::instance->tft_auto_upload_baud != 0) {
+    LOG_INFO("Auto baud: Starting with last known working baud rate ", NSPMConfig::instance->tft_auto_upload_baud);
+    return NSPMConfig::instance->tft_auto_upload_baud;
+  }
+
+  LOG_INFO("Auto baud: No known working baud rate, starting at ", NSPanel::_tftAutoUploadBaudRates[0]);
+  return NSPanel::_tftAutoUploadBaudRates[0];
+}
 
+bool NSPanel::_stepDownTFTUploadBaudRate() {
+  for (uint32_t baud_rate : NSPanel::_tftAutoUploadBaudRates) {
+    if (baud_rate < NSPanel::_tftUploadBaudRate) {
+      LOG_WARNING("Auto baud: Stepping down TFT upload baud rate from ", NSPanel::_tftUploadBaudRate, " to ", baud_rate);
+      NSPanel::_tftUploadBaudRate = baud_rate;
+      return true;
+    }
+  }
+  LOG_ERROR("Auto baud: Already at slowest baud rate ", NSPanel::_tftUploadBaudRate, ", can not step down further.");
+  return false;
+}
+
+void NSPanel::_updateAutoTFTUploadBaudRate() {
+  if (NSPMConfig::instance->tft_upload_baud != 0) {
+    return;
+  }
+
+  // Start the next update at the rate that just worked. Faster rates are only probed again once the
+  // upload baud rate is set back to auto in the web interface.
+  if (NSPMConfig::instance->tft_auto_upload_baud != NSPanel::_tftUploadBaudRate) {
+    LOG_INFO("Auto baud: Upload at baud ", NSPanel::_tftUploadBaudRate, " succeeded, will start there next time.");
+    NSPMConfig::instance->tft_auto_upload_baud = NSPanel::_tftUploadBaudRate;
+  }
+}
+
+bool NSPanel::_initTFTUpdate(int communication_baud_rate, size_t file_size) {
   NSPanel::instance->_writeCommandsToSerial = false;
   NSPanel::instance->_update_progress = 0;
   NSPanel::instance->_isUpdating = true;
@@ -629,6 +899,28 @@ bool NSPanel::_initTFTUpdate(int communication_baud_rate) {
   }
   NSPanel::instance->_stopListeningToPanel();
 
+  for (uint8_t attempt = 1; attempt <= TFT_INIT_MAX_ATTEMPTS; attempt++) {
+    bool got_comok = false;
+    if (NSPanel::_tryInitTFTUpdate(communication_baud_rate, file_size, &got_comok)) {
+      return true;
+    }
+    if (!got_comok) {
+      // We didn't receive a comok string back. Try again at the upload baud rate in case the panel was left at it (default 115200)
+      communication_baud_rate = communication_baud_rate == 115200 ? NSPanel::_tftUploadBaudRate : 115200;
+    } else if (NSPMConfig::instance->tft_upload_baud == 0) {
+      // The panel did not answer in a way we could read at the selected upload baud rate, try a slower one.
+      NSPanel::_stepDownTFTUploadBaudRate();
+    }
+    LOG_ERROR("Will retry TFT upload init, attempt ", attempt, " of ", TFT_INIT_MAX_ATTEMPTS, " failed.");
+  }
+  LOG_ERROR("Failed to initialize TFT update after ", TFT_INIT_MAX_ATTEMPTS, " attempts.");
+  return false;
+}
+
+bool NSPanel::_tryInitTFTUpdate(int communication_baud_rate, size_t file_size, bool *got_comok) {
+  LOG_INFO("Trying to initialize TFT update at baud ", communication_baud_rate);
+  Serial2.updateBaudRate(communication_baud_rate);
+
   // Clear current read buffer
   Serial2.flush();
 
@@ -657,31 +949,10 @@ bool NSPanel::_initTFTUpdate(int communication_baud_rate) {
     comok_string.erase(comok_string.length() - 3);
     LOG_DEBUG("Got comok: ", comok_string.c_str());
   } else {
-    // We didn't receive a comok string back. Try again at baud 9600 (default 115200)
-    LOG_ERROR("Didn't receive expected comok, got: '", comok_string.c_str(), "'. Will retry.");
-    return NSPanel::_initTFTUpdate(communication_baud_rate == 115200 ? NSPMConfig::instance->tft_upload_baud : 115200);
-  }
-
-  // URL to download TFT file from
-  std::string downloadUrl = "http://";
-  downloadUrl.append(NSPMConfig::instance->manager_address);
-  downloadUrl.append(":");
-  downloadUrl.append(std::to_string(NSPMConfig::instance->manager_port));
-  if (!NSPMConfig::instance->is_us_panel) {
-    downloadUrl.append("/download_tft_eu");
-  } else {
-    downloadUrl.append("/download_tft_us");
-  }
-
-  LOG_INFO("Will download TFT file from: ", downloadUrl.c_str());
-  unsigned long file_size = 0;
-  while (file_size == 0) {
-    file_size = HttpLib::GetFileSize(downloadUrl.c_str());
-    if (file_size == 0) {
-      LOG_ERROR("Failed to get file size for TFT flashing. Will try again.");
-      vTaskDelay(500 / portTICK_PERIOD_MS);
-    }
+    LOG_ERROR("Didn't receive expected comok, got: '", comok_string.c_str(), "'.");
+    return false;
   }
+  *got_comok = true;
 
   LOG_DEBUG("Will start TFT upload, TFT file size: ", file_size);
   // TODO: Detect if new protocol is not supported, in that case set flag in flash and restart and then continue flash with legacy mode.
@@ -692,14 +963,14 @@ bool NSPanel::_initTFTUpdate(int communication_baud_rate) {
     commandString = "whmi-wris ";
     commandString.append(std::to_string(file_size));
     commandString.append(",");
-    commandString.append(std::to_string(NSPMConfig::instance->tft_upload_baud));
+    commandString.append(std::to_string(NSPanel::_tftUploadBaudRate));
     commandString.append(",1");
   } else {
     LOG_INFO("Starting upload using v1.0 protocol.");
     commandString = "whmi-wri ";
     commandString.append(std::to_string(file_size));
     commandString.append(",");
-    commandString.append(std::to_string(NSPMConfig::instance->tft_upload_baud));
+    commandString.append(std::to_string(NSPanel::_tftUploadBaudRate));
     commandString.append(",1");
   }
   NSPanel::_clearSerialBuffer();
@@ -711,13 +982,13 @@ bool NSPanel::_initTFTUpdate(int communication_baud_rate) {
 
   // Switch to desiered upload buad rate.
   vTaskDelay(50 / portTICK_PERIOD_MS);
-  int32_t baud_diff = NSPMConfig::instance->tft_upload_baud - Serial2.baudRate();
+  int32_t baud_diff = NSPanel::_tftUploadBaudRate - Serial2.baudRate();
   if (baud_diff < 0) {
     baud_diff = baud_diff / -1;
   }
   if (baud_diff >= 10) {
-    LOG_INFO("Switching flash baud rate on Serial2 from ", Serial2.baudRate(), " to ", NSPMConfig::instance->tft_upload_baud);
-    Serial2.updateBaudRate(NSPMConfig::instance->tft_upload_baud);
+    LOG_INFO("Switching flash baud rate on Serial2 from ", Serial2.baudRate(), " to ", NSPanel::_tftUploadBaudRate);
+    Serial2.updateBaudRate(NSPanel::_tftUploadBaudRate);
   }
 
   // Wait until Nextion returns okay to transmit tft
@@ -736,8 +1007,7 @@ bool NSPanel::_initTFTUpdate(int communication_baud_rate) {
       LOG_INFO(String(Serial2.read(), HEX).c_str());
       vTaskDelay(5 / portTICK_PERIOD_MS);
     }
-    LOG_ERROR("Will retry TFT upload init.");
-    return NSPanel::_initTFTUpdate(communication_baud_rate);
+    return false;
   }
 
   return true;
@@ -745,13 +1015,10 @@ bool NSPanel::_initTFTUpdate(int communication_baud_rate) {
 
 bool NSPanel::_updateTFTOTA() {
   LOG_INFO("_updateTFTOTA Started.");
-  NSPanel::_initTFTUpdate(115200);
+  NSPanel::_tftUploadStats.attempts++;
 
   // URL to download TFT file from
-  std::string downloadUrl = "http://";
-  downloadUrl.append(NSPMConfig::instance->manager_address);
-  downloadUrl.append(":");
-  downloadUrl.append(std::to_string(NSPMConfig::instance->manager_port));
+  std::string downloadUrl = ManagerDiscovery::getManagerUrl();
   if (!NSPMConfig::instance->is_us_panel) {
     downloadUrl.append("/download_tft_eu");
   } else {
@@ -768,6 +1035,39 @@ bool NSPanel::_updateTFTOTA() {
       LOG_INFO("Will flash TFT, size: ", file_size);
     }
   }
+  // Get the checksum so that the data sent to the panel can be verified as it streams through. This is done before the panel is put in
+  // upload mode, where it would otherwise sit waiting for data while the manager is unreachable.
+  LOG_INFO("Getting TFT MD5 checksum to verify upload against.");
+  char checksum_holder[33];
+  uint8_t checksum_attempts = 0;
+  while (true) {
+    std::string checksumUrl = ManagerDiscovery::getManagerUrl();
+    if (!NSPMConfig::instance->is_us_panel) {
+      checksumUrl.append("/checksum_tft_file_eu");
+    } else {
+      checksumUrl.append("/checksum_tft_file_us");
+    }
+    if (HttpLib::GetMD5sum(checksumUrl.c_str(), checksum_holder)) {
+      break;
+    }
+    checksum_attempts++;
+    if (checksum_attempts >= TFT_CHECKSUM_MAX_ATTEMPTS) {
+      LOG_ERROR("Failed to get TFT checksum after ", checksum_attempts, " attempts.");
+      return false;
+    }
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+  }
+
+  if (!NSPanel::_initTFTUpdate(115200, file_size)) {
+    return false;
+  }
+
+  // MD5 of the TFT file calculated from the data sent to the panel, in file order.
+  // Everything before hashed_until has been added to the digest.
+  MD5Builder tft_md5;
+  tft_md5.begin();
+  size_t hashed_until = 0;
+
   unsigned long startWaitingForOKForNextChunk = 0;
   unsigned long nextStartWriteOffset = 0;
   unsigned long lastReadByte = 0;
@@ -780,25 +1080,156 @@ bool NSPanel::_updateTFTOTA() {
 
   uint8_t dataBuffer[4096];
 
+  // Prefer a compressed stream if the manager offers one, fewer bytes over WiFi means a faster update on congested networks.
+  // The panel is still told the uncompressed size in whmi-wri/whmi-wris and is sent decompressed data.
+  std::string compressedUrl = downloadUrl;
+  compressedUrl.append("?compressed=heatshrink");
+  HeatshrinkDownloader *compressed_downloader = new HeatshrinkDownloader(compressedUrl);
+  if (compressed_downloader->open() && compressed_downloader->getUncompressedSize() == file_size) {
+    LOG_INFO("Will flash TFT from compressed stream.");
+    NSPanel::_tftUploadStats.compressed = true;
+  } else {
+    LOG_INFO("No usable compressed TFT stream, will download raw TFT file.");
+    delete compressed_downloader;
+    compressed_downloader = nullptr;
+    NSPanel::_tftUploadStats.compressed = false;
+  }
+
+  ChunkDownloader *raw_downloader = nullptr;
+  uint16_t download_retries_before = NSPanel::_tftUploadStats.download_retries;
+  if (compressed_downloader == nullptr) {
+    raw_downloader = new ChunkDownloader(downloadUrl, sizeof(dataBuffer), TFT_DOWNLOAD_PREFETCH_CHUNKS);
+    while (!raw_downloader->start()) {
+      LOG_ERROR("Failed to start TFT download. Will try again.");
+      vTaskDelay(500 / portTICK_PERIOD_MS);
+    }
+  }
+  NSPanel::_tftUploadStats.baud_rate = NSPanel::_tftUploadBaudRate;
+
+  // Variables used to probe the upload baud rate when it is set to auto
+  bool auto_baud = NSPMConfig::instance->tft_upload_baud == 0;
+  uint16_t blocks_written = 0;
+  uint16_t unexpected_responses = 0;
+  uint8_t unexpected_responses_in_row = 0;
+  size_t probe_bytes_written = 0;
+  unsigned long probe_panel_time = 0;
+
   // Loop until break when all firmware has finished uploading (data available in stream == 0)
   while (true) {
-    // Calculate next chunk size
-    int next_write_size;
-    if (file_size - lastReadByte > 4096) {
-      next_write_size = 4096;
+    // Calculate next chunk size from where the panel wants the next block, which differs from lastReadByte after a 0x08 jump
+    size_t next_write_size;
+    if (file_size - nextStartWriteOffset > sizeof(dataBuffer)) {
+      next_write_size = sizeof(dataBuffer);
     } else {
-      next_write_size = file_size - lastReadByte;
+      next_write_size = file_size - nextStartWriteOffset;
     }
     size_t bytesReceived = 0;
-    while (bytesReceived != next_write_size) {
-      bytesReceived = HttpLib::DownloadChunk(dataBuffer, downloadUrl.c_str(), nextStartWriteOffset, next_write_size);
+    unsigned long block_download_start = millis();
+    size_t compressed_bytes_before = compressed_downloader != nullptr ? compressed_downloader->getCompressedBytesReceived() : 0;
+    if (compressed_downloader != nullptr) {
+      // The compressed stream is sequential. Data the panel jumps past is decompressed and hashed
+      // but not sent, jumping backwards restarts the stream.
+      uint8_t restarts_in_row = 0;
+      while (compressed_downloader != nullptr) {
+        bool moved = true;
+        while (compressed_downloader->getPosition() < nextStartWriteOffset) {
+          size_t gap_size = nextStartWriteOffset - compressed_downloader->getPosition();
+          size_t gap_read = compressed_downloader->read(dataBuffer, gap_size < sizeof(dataBuffer) ? gap_size : sizeof(dataBuffer));
+          if (gap_read == 0) {
+            moved = false;
+            break;
+          }
+          if (compressed_downloader->getPosition() - gap_read == hashed_until) {
+            tft_md5.add(dataBuffer, gap_read);
+            hashed_until += gap_read;
+          }
+        }
+        if (moved && compressed_downloader->getPosition() != nextStartWriteOffset) {
+          moved = compressed_downloader->seek(nextStartWriteOffset);
+        }
+        if (moved) {
+          bytesReceived = compressed_downloader->read(dataBuffer, next_write_size);
+          if (bytesReceived == next_write_size) {
+            break;
+          }
+        }
+
+        // The compressed stream can't be resumed in the middle, restart it and skip what has already been sent.
+        restarts_in_row++;
+        NSPanel::_tftUploadStats.download_retries++;
+        if (restarts_in_row >= TFT_DOWNLOAD_MAX_COMPRESSED_RESTARTS) {
+          LOG_ERROR("Compressed stream failed at offset ", nextStartWriteOffset, " after ", restarts_in_row, " attempts. Will continue with raw TFT file.");
+          NSPanel::_tftUploadStats.network_bytes += compressed_downloader->getCompressedBytesReceived() - compressed_bytes_before;
+          delete compressed_downloader;
+          compressed_downloader = nullptr;
+          NSPanel::_tftUploadStats.compressed = false;
+          bytesReceived = 0;
+          break;
+        }
+        LOG_ERROR("Bytes received: ", bytesReceived, " requested ", next_write_size, ". Will restart compressed stream.");
+        bytesReceived = 0;
+        compressed_bytes_before = 0;
+        vTaskDelay(250 / portTICK_PERIOD_MS);
+        compressed_downloader->seek(0);
+      }
+    }
+
+    if (compressed_downloader == nullptr) {
+      if (raw_downloader == nullptr) {
+        raw_downloader = new ChunkDownloader(downloadUrl, sizeof(dataBuffer), TFT_DOWNLOAD_PREFETCH_CHUNKS);
+        while (!raw_downloader->start()) {
+          LOG_ERROR("Failed to start TFT download. Will try again.");
+          vTaskDelay(500 / portTICK_PERIOD_MS);
+        }
+      }
+      // The downloader keeps prefetching from where the last block ended, only an offset jump from the panel discards data.
+      raw_downloader->seek(nextStartWriteOffset);
+      uint32_t bytes_downloaded_before = raw_downloader->getBytesDownloaded();
+      uint8_t empty_reads_in_row = 0;
+      while ((bytesReceived = raw_downloader->readNextChunk(dataBuffer)) == 0) {
+        empty_reads_in_row++;
+        if (empty_reads_in_row >= TFT_DOWNLOAD_MAX_EMPTY_READS_IN_ROW) {
+          LOG_ERROR("No data received at offset ", nextStartWriteOffset, " after ", empty_reads_in_row, " attempts. Giving up.");
+          NSPanel::_logTFTUploadStats();
+          delete compressed_downloader;
+          delete raw_downloader;
+          return false;
+        }
+        LOG_ERROR("No data received at offset ", nextStartWriteOffset, ". Will retry.");
+      }
       if (bytesReceived != next_write_size) {
-        LOG_ERROR("Bytes received: ", bytesReceived, " requested ", next_write_size, ". Will retry.");
+        // A short chunk is still valid data, send it and continue from where it ended.
+        LOG_WARNING("Bytes received: ", bytesReceived, " requested ", next_write_size, ". Will continue from ", nextStartWriteOffset + bytesReceived);
+      }
+      NSPanel::_tftUploadStats.network_bytes += raw_downloader->getBytesDownloaded() - bytes_downloaded_before;
+      NSPanel::_tftUploadStats.download_retries = download_retries_before + raw_downloader->getRetries();
+    }
+
+    if (compressed_downloader != nullptr) {
+      // A restarted stream resets the counter, count everything received since then
+      NSPanel::_tftUploadStats.network_bytes += compressed_downloader->getCompressedBytesReceived() - compressed_bytes_before;
+    }
+    unsigned long block_download_time = millis() - block_download_start;
+    NSPanel::_tftUploadStats.network_time_ms += block_download_time;
+    NSPanel::_addToTFTUploadHistogram(NSPanel::_tftUploadStats.download_latency_histogram, block_download_time);
+
+    if (nextStartWriteOffset > hashed_until) {
+      // The panel jumped past data it already has. That data is never sent but is still
+      // part of the file checksum, add it to the digest straight from the manager.
+      LOG_DEBUG("Adding skipped range ", hashed_until, "-", nextStartWriteOffset, " to TFT checksum.");
+      while (!HttpLib::AddRangeToMD5(downloadUrl.c_str(), hashed_until, nextStartWriteOffset - hashed_until, &tft_md5)) {
+        LOG_ERROR("Failed to add skipped range to TFT checksum. Will retry.");
         vTaskDelay(250 / portTICK_PERIOD_MS);
       }
+      hashed_until = nextStartWriteOffset;
+    }
+    if (nextStartWriteOffset + bytesReceived > hashed_until) {
+      size_t already_hashed = hashed_until - nextStartWriteOffset;
+      tft_md5.add(&dataBuffer[already_hashed], bytesReceived - already_hashed);
+      hashed_until = nextStartWriteOffset + bytesReceived;
     }
 
-    vTaskDelay(500 / portTICK_PERIOD_MS);
+    unsigned long block_write_start = millis();
     Serial2.write(dataBuffer, bytesReceived);
     nextStartWriteOffset += bytesReceived;
     lastReadByte = nextStartWriteOffset;
@@ -806,6 +1237,41 @@ bool NSPanel::_updateTFTOTA() {
 
     std::string return_string;
     uint16_t recevied_bytes = NSPanel::instance->_readDataToString(&return_string, 5000, true);
+    blocks_written++;
+    unsigned long block_panel_time = millis() - block_write_start;
+    NSPanel::_tftUploadStats.uart_bytes += bytesReceived;
+    NSPanel::_tftUploadStats.uart_time_ms += block_panel_time;
+    NSPanel::_addToTFTUploadHistogram(NSPanel::_tftUploadStats.ack_latency_histogram, block_panel_time);
+    if (blocks_written <= TFT_AUTO_BAUD_PROBE_BLOCKS) {
+      probe_bytes_written += bytesReceived;
+      probe_panel_time += block_panel_time;
+    }
+
+    if (lastReadByte < file_size && return_string[0] != 0x05 && return_string[0] != 0x08) {
+      unexpected_responses++;
+      unexpected_responses_in_row++;
+      NSPanel::_tftUploadStats.unexpected_responses++;
+      // While probing, any unexpected response means the panel can't keep up with the baud rate.
+      // After probing, step down only if the panel keeps returning unexpected data.
+      if (auto_baud && (blocks_written <= TFT_AUTO_BAUD_PROBE_BLOCKS || unexpected_responses_in_row >= TFT_AUTO_BAUD_MAX_ERRORS_IN_ROW)) {
+        if (NSPanel::_stepDownTFTUploadBaudRate()) {
+          LOG_ERROR("Auto baud: Unexpected response from panel at block ", blocks_written, ", will restart upload at baud ", NSPanel::_tftUploadBaudRate);
+          NSPanel::_logTFTUploadStats();
+          delete compressed_downloader;
+          delete raw_downloader;
+          return false;
+        }
+      }
+    } else {
+      unexpected_responses_in_row = 0;
+    }
+
+    if (auto_baud && blocks_written == TFT_AUTO_BAUD_PROBE_BLOCKS) {
+      LOG_INFO("Auto baud: Probe at baud ", NSPanel::_tftUploadBaudRate, " passed. Effective panel throughput: ",
+               probe_panel_time > 0 ? (probe_bytes_written * 1000) / probe_panel_time : 0, " B/s, unexpected responses: ",
+               unexpected_responses, "/", blocks_written);
+    }
+
     if (lastReadByte >= file_size) {
       NSPanel::instance->_update_progress = 100;
       LOG_INFO("TFT Upload complete, processed ", lastReadByte, " bytes.");
@@ -814,19 +1280,10 @@ bool NSPanel::_updateTFTOTA() {
       // Old protocol, just upload next chunk.
       LOG_TRACE("Got 0x05, uploading next chunk.");
     } else if (return_string[0] == 0x08) {
-      while (return_string.length() < 4) {
-        LOG_TRACE("Waiting for offset data byte ", return_string.length() - 1);
-        while (Serial2.available() <= 0) {
-          vTaskDelay(20 / portTICK_PERIOD_MS);
-        }
-        return_string.push_back(Serial2.read());
-      }
-      uint32_t readNextOffset = return_string[1];
-      readNextOffset |= return_string[2] << 8;
-      readNextOffset |= return_string[3] << 16;
-      readNextOffset |= return_string[4] << 24;
+      uint32_t readNextOffset = NSPanel::_readTFTUploadOffset(&return_string);
       if (readNextOffset > 0) {
         nextStartWriteOffset = readNextOffset;
+        NSPanel::_tftUploadStats.offset_jumps++;
         LOG_INFO("Got 0x08 with offset, jumping to: ", nextStartWriteOffset, " please wait.");
       }
     } else {
@@ -839,31 +1296,20 @@ bool NSPanel::_updateTFTOTA() {
     // vTaskDelay(50 / portTICK_PERIOD_MS);
   }
 
-  LOG_INFO("Getting TFT MD5 checksum to store in flash.");
-  char checksum_holder[33];
-  while (true) {
-    std::string checksumUrl = "http://";
-    checksumUrl.append(NSPMConfig::instance->manager_address);
-    checksumUrl.append(":");
-    checksumUrl.append(std::to_string(NSPMConfig::instance->manager_port));
-    if (!NSPMConfig::instance->is_us_panel) {
-      checksumUrl.append("/checksum_tft_file_eu");
-    } else {
-      checksumUrl.append("/checksum_tft_file_us");
-    }
-    if (HttpLib::GetMD5sum(checksumUrl.c_str(), checksum_holder)) {
-      break;
-    }
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+  if (compressed_downloader != nullptr) {
+    LOG_INFO("Received ", compressed_downloader->getCompressedBytesReceived(), " compressed bytes for ", file_size, " byte TFT file.");
+    delete compressed_downloader;
   }
-  NSPMConfig::instance->md5_tft_file = checksum_holder;
-  NSPMConfig::instance->saveToLittleFS(false);
+  delete raw_downloader;
 
-  LOG_INFO("Will restart in 5 seconds.");
-  vTaskDelay(5000 / portTICK_PERIOD_MS);
-  ESP.restart();
+  NSPanel::_logTFTUploadStats();
 
-  vTaskDelay(portMAX_DELAY);
-  vTaskDelete(NULL);
-  return false;
+  tft_md5.calculate();
+  if (!tft_md5.toString().equalsIgnoreCase(checksum_holder)) {
+    LOG_ERROR("TFT checksum mismatch! Sent data has MD5 ", tft_md5.toString().c_str(), " but manager reports ", checksum_holder, ". Will not store checksum.");
+    return false;
+  }
+  LOG_INFO("TFT checksum verified: ", checksum_holder);
+  NSPMConfig::instance->md5_tft_file = checksum_holder;
+  return true;
 }
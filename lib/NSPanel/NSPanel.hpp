@@ -2,7 +2,9 @@
 #define NSPANEL_H
 
 #include <Arduino.h>
+#include <ArduinoJson.h>
 #include <HardwareSerial.h>
+#include <freertos/stream_buffer.h>
 #include <NSPMConfig.h>
 #include <list>
 #include <queue>
@@ -13,6 +15,61 @@
 // milliseconds to wait between each command sent
 #define COMMAND_SEND_WAIT_MS 2
 
+// Number of blocks written to the panel while probing a baud rate when TFT upload baud rate is set to auto
+#define TFT_AUTO_BAUD_PROBE_BLOCKS 8
+// Number of unexpected responses in a row after probing that will cause the upload to step down to a slower baud rate
+#define TFT_AUTO_BAUD_MAX_ERRORS_IN_ROW 3
+// Number of times to restart the panel and try to start a TFT upload before giving up the update attempt
+#define TFT_INIT_MAX_ATTEMPTS 6
+// Number of times to request the TFT checksum from the manager before giving up the update attempt
+#define TFT_CHECKSUM_MAX_ATTEMPTS 10
+
+// Number of 4096 byte blocks to download ahead of the panel during a TFT upload
+#define TFT_DOWNLOAD_PREFETCH_CHUNKS 4
+// Number of empty reads in a row from the TFT download (end of file or timeout) before the upload attempt is abandoned
+#define TFT_DOWNLOAD_MAX_EMPTY_READS_IN_ROW 3
+// Number of times in a row the compressed TFT stream is restarted for the same block before falling back to the raw TFT file
+#define TFT_DOWNLOAD_MAX_COMPRESSED_RESTARTS 3
+
+// Size of the buffer between the web server and the panel when a TFT file is uploaded directly to the panel
+#define TFT_STREAM_UPLOAD_BUFFER_SIZE 8192
+// Largest part of the TFT file the web interface posts at a time, a part is only accepted if it fits in the buffer
+#define TFT_STREAM_UPLOAD_CHUNK_SIZE 4096
+// Maximum time the panel upload will wait for more data from the web server
+#define TFT_STREAM_UPLOAD_READ_TIMEOUT_MS 30000
+
+// Number of buckets in the TFT upload latency histograms, see NSPanelTFTUploadStats
+#define TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS 6
+
+struct NSPanelTFTUploadStats {
+  /// @brief Upper bound (ms) of each latency histogram bucket, the last bucket catches everything slower
+  static constexpr uint16_t histogram_bucket_limits[TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS] = {10, 50, 100, 250, 1000, UINT16_MAX};
+  /// @brief Number of times the upload has been started, including retries after a failure
+  uint16_t attempts = 0;
+  /// @brief The baud rate used to transfer the TFT file to the panel
+  uint32_t baud_rate = 0;
+  /// @brief Is the TFT file downloaded as a compressed stream
+  bool compressed = false;
+  /// @brief Number of bytes downloaded over the network, compressed bytes if using a compressed stream
+  uint32_t network_bytes = 0;
+  /// @brief Time spent waiting for data from the manager
+  uint32_t network_time_ms = 0;
+  /// @brief Number of bytes written to the panel
+  uint32_t uart_bytes = 0;
+  /// @brief Time spent writing to the panel and waiting for the panel to acknowledge
+  uint32_t uart_time_ms = 0;
+  /// @brief Number of block downloads that had to be retried
+  uint16_t download_retries = 0;
+  /// @brief Number of unexpected responses from the panel
+  uint16_t unexpected_responses = 0;
+  /// @brief Number of times the panel asked to continue from another offset (0x08)
+  uint16_t offset_jumps = 0;
+  /// @brief Time to download each block, bucketed by histogram_bucket_limits
+  uint16_t download_latency_histogram[TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS] = {0};
+  /// @brief Time from writing each block until the panel acknowledged it, bucketed by histogram_bucket_limits
+  uint16_t ack_latency_histogram[TFT_UPLOAD_STATS_HISTOGRAM_BUCKETS] = {0};
+};
+
 struct NSPanelCommand {
   /// @brief The command to be sent
   std::string command;
@@ -41,6 +98,9 @@ public:
   bool ready();
   bool init();
   bool startOTAUpdate();
+  /// @brief Download and flash the TFT file from the manager, retrying until successful. Blocks until done and does not restart
+  /// @brief or save the config, the new TFT checksum is set in NSPMConfig.
+  void updateTFT();
   void goToPage(const char *page);
   void setDimLevel(uint8_t dimLevel);
   void setSleep(bool sleep);
@@ -51,8 +111,27 @@ public:
   void setComponentPic1(const char *componentId, uint8_t value);
   void setComponentForegroundColor(const char *componentId, uint value);
   void setComponentVisible(const char *componentId, bool visible);
+  /// @brief Start a TFT update where the TFT file is provided with writeTFTUploadData instead of downloaded from the manager
+  /// @param size The size of the TFT file
+  /// @return True if the update was started
+  bool startTFTUploadFromStream(size_t size);
+  /// @brief True once the panel is ready to receive data with writeTFTUploadData
+  bool isReadyForTFTUploadData();
+  /// @brief Number of bytes writeTFTUploadData can currently accept without failing the upload
+  size_t getTFTUploadSpaceAvailable();
+  /// @brief Pass TFT file data to an update started with startTFTUploadFromStream. Never blocks, the upload fails if the data does not fit
+  /// @brief in the buffer so check getTFTUploadSpaceAvailable first.
+  /// @param data The data
+  /// @param length Number of bytes in data
+  /// @return True if the data was accepted
+  bool writeTFTUploadData(const uint8_t *data, size_t length);
+  /// @brief True if an update started with startTFTUploadFromStream has failed
+  bool hasTFTUploadFailed();
   bool getUpdateState();
   uint8_t getUpdateProgress();
+  /// @brief Add metrics from the ongoing (or last) TFT upload to a JSON object
+  /// @param object The JSON object to add the metrics to
+  void getTFTUploadStats(JsonObject object);
   int getComponentIntVal(const char *componentId);
   void restart();
 
@@ -62,14 +141,51 @@ private:
   static void _taskSendCommandQueue(void *param);
   static void _onSerialData(void);
   static void _taskUpdateTFTConfigOTA(void *param);
-  /// @brief Download a chunk of data from given addres, to the buffer at the given offset
-  /// @param buffer The buffer to store data into
-  /// @param address The address to download the firmware from
-  /// @param offset Offset to request data from (bytes)
-  /// @param size Maximum download chunk size
-  /// @return The number of bytes downloaded
-  static bool _initTFTUpdate(int communication_baud_rate);
+  /// @brief Restart the panel and start a TFT upload, retrying at most TFT_INIT_MAX_ATTEMPTS times
+  /// @param communication_baud_rate The baud rate to send the upload command at
+  /// @param file_size Size of the TFT file
+  /// @return True if the panel is ready to receive the TFT file
+  static bool _initTFTUpdate(int communication_baud_rate, size_t file_size);
+  /// @brief Make one attempt at restarting the panel and starting a TFT upload
+  /// @param got_comok Set to true if the panel answered the connect command
+  /// @return True if the panel is ready to receive the TFT file
+  static bool _tryInitTFTUpdate(int communication_baud_rate, size_t file_size, bool *got_comok);
   static bool _updateTFTOTA();
+  /// @brief Take the serial read and write mutexes before starting a TFT update
+  static void _lockSerialForTFTUpdate();
+  /// @brief Read the offset following a 0x08 response from the panel during a TFT upload
+  /// @param return_string The data read from the panel so far, starting with 0x08
+  /// @return The offset the panel wants the upload to continue from
+  static uint32_t _readTFTUploadOffset(std::string *return_string);
+  /// @brief Task that uploads a TFT file provided with writeTFTUploadData to the panel
+  static void _taskUpdateTFTFromStream(void *param);
+  /// @brief Read exactly size bytes of uploaded TFT data
+  /// @return False on timeout
+  static bool _readTFTUploadStream(uint8_t *buffer, size_t size);
+  /// @brief Buffer between the web server and the panel when a TFT file is uploaded directly to the panel
+  static inline StreamBufferHandle_t _tftUploadStream = NULL;
+  static inline size_t _tftUploadStreamSize;
+  static inline bool _tftUploadStreamReady = false;
+  static inline bool _tftUploadStreamFailed = false;
+  /// @brief Baud rates to try when the TFT upload baud rate is set to auto, fastest first.
+  static constexpr uint32_t _tftAutoUploadBaudRates[] = {921600, 512000, 256000, 115200};
+  /// @brief The baud rate used to transfer the TFT file during the current update
+  static inline uint32_t _tftUploadBaudRate;
+  /// @brief Get the baud rate to start a TFT update with, either the configured or the last known working auto baud rate
+  static uint32_t _getInitialTFTUploadBaudRate();
+  /// @brief Select the next slower auto baud rate for the TFT upload
+  /// @return True if a slower baud rate was selected, false if already at the slowest
+  static bool _stepDownTFTUploadBaudRate();
+  /// @brief Remember the auto baud rate that a successful TFT update finished at to start the next update with
+  static void _updateAutoTFTUploadBaudRate();
+  /// @brief Metrics for the ongoing (or last) TFT upload
+  static inline NSPanelTFTUploadStats _tftUploadStats;
+  /// @brief Add a latency to a TFT upload stats histogram
+  /// @param histogram The histogram to add the latency to
+  /// @param latency_ms The latency
+  static void _addToTFTUploadHistogram(uint16_t *histogram, unsigned long latency_ms);
+  /// @brief Write a summary of the TFT upload stats to the log
+  static void _logTFTUploadStats();
   std::queue<std::vector<char>> _processQueue;
   TaskHandle_t _taskHandleProcessPanelOutput;
   static void _taskProcessPanelOutput(void *param);
@@ -25,6 +25,7 @@ void HomePage::show() {
 }
 
 void HomePage::updateDeviceEntitySubscriptions() {
+  RoomModelSnapshot rooms;
   for (Light *light : LightManager::getAllLights()) {
     light->attachUpdateCallback(this);
     light->attachDeconstructCallback(this);
@@ -75,7 +76,14 @@ void HomePage::entityDeconstructCallback(DeviceEntity *entity) {
   this->update();
 }
 
+void HomePage::entitiesDeconstructCallback(std::list<DeviceEntity *> &entities) {
+  LOG_DEBUG("Got deconstruct callback for ", entities.size(), " entities, updating display.");
+  this->update();
+}
+
 void HomePage::processTouchEvent(uint8_t page, uint8_t component, bool pressed) {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   LOG_DEBUG("Got event, component ", page, ".", component, " ", pressed ? "pressed" : "released");
 
   HomePage::_isFingerOnDisplay = pressed;
@@ -107,9 +115,9 @@ void HomePage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     } else if (component == HOME_LIGHT_LEVEL_SLIDER_ID) {
       // Dimmer slider changed, update cached value
       this->updateDimmerValueCache();
-      if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom() && (*RoomManager::currentRoom)->anyLightsOn()) {
+      if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr && currentRoom->anyLightsOn()) {
         this->_updateLightsThatAreOnWithNewBrightness(this->getDimmingValue());
-      } else if (InterfaceConfig::currentRoomMode == roomMode::house && RoomManager::hasValidCurrentRoom() && (*RoomManager::currentRoom)->anyLightsOn()) {
+      } else if (InterfaceConfig::currentRoomMode == roomMode::house && currentRoom != nullptr && currentRoom->anyLightsOn()) {
         this->_updateLightsThatAreOnWithNewBrightness(this->getDimmingValue());
       } else {
         this->_updateAllLightsWithNewBrightness(this->getDimmingValue());
@@ -253,21 +261,23 @@ void HomePage::setEditLightMode(editLightMode new_mode) {
 }
 
 void HomePage::_updateLightsThatAreOnWithNewBrightness(uint8_t brightness) {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   std::list<Light *> lights;
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
     if (InterfaceConfig::currentEditLightMode == editLightMode::all_lights) {
-      lights = (*RoomManager::currentRoom)->getAllLightsThatAreOn();
+      lights = currentRoom->getAllLightsThatAreOn();
     } else if (InterfaceConfig::currentEditLightMode == editLightMode::ceiling_lights) {
-      if ((*RoomManager::currentRoom)->anyCeilingLightsOn()) {
-        lights = (*RoomManager::currentRoom)->getCeilingLightsThatAreOn();
+      if (currentRoom->anyCeilingLightsOn()) {
+        lights = currentRoom->getCeilingLightsThatAreOn();
       } else {
-        lights = (*RoomManager::currentRoom)->getAllCeilingLights();
+        lights = currentRoom->getAllCeilingLights();
       }
     } else if (InterfaceConfig::currentEditLightMode == editLightMode::table_lights) {
-      if ((*RoomManager::currentRoom)->anyTableLightsOn()) {
-        lights = (*RoomManager::currentRoom)->getTableLightsThatAreOn();
+      if (currentRoom->anyTableLightsOn()) {
+        lights = currentRoom->getTableLightsThatAreOn();
       } else {
-        lights = (*RoomManager::currentRoom)->getAllTableLights();
+        lights = currentRoom->getAllTableLights();
       }
     }
   } else if (InterfaceConfig::currentRoomMode == roomMode::house) {
@@ -294,25 +304,27 @@ void HomePage::_updateLightsThatAreOnWithNewBrightness(uint8_t brightness) {
 }
 
 void HomePage::_updateAllLightsWithNewBrightness(uint8_t brightness) {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   std::list<Light *> lights;
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
     if (InterfaceConfig::currentEditLightMode == editLightMode::all_lights) {
-      if ((*RoomManager::currentRoom)->anyLightsOn()) {
-        lights = (*RoomManager::currentRoom)->getAllLightsThatAreOn();
+      if (currentRoom->anyLightsOn()) {
+        lights = currentRoom->getAllLightsThatAreOn();
       } else {
-        lights = (*RoomManager::currentRoom)->getAllLights();
+        lights = currentRoom->getAllLights();
       }
     } else if (InterfaceConfig::currentEditLightMode == editLightMode::ceiling_lights) {
-      if ((*RoomManager::currentRoom)->anyCeilingLightsOn()) {
-        lights = (*RoomManager::currentRoom)->getCeilingLightsThatAreOn();
+      if (currentRoom->anyCeilingLightsOn()) {
+        lights = currentRoom->getCeilingLightsThatAreOn();
       } else {
-        lights = (*RoomManager::currentRoom)->getAllCeilingLights();
+        lights = currentRoom->getAllCeilingLights();
       }
     } else if (InterfaceConfig::currentEditLightMode == editLightMode::table_lights) {
-      if ((*RoomManager::currentRoom)->anyTableLightsOn()) {
-        lights = (*RoomManager::currentRoom)->getTableLightsThatAreOn();
+      if (currentRoom->anyTableLightsOn()) {
+        lights = currentRoom->getTableLightsThatAreOn();
       } else {
-        lights = (*RoomManager::currentRoom)->getAllTableLights();
+        lights = currentRoom->getAllTableLights();
       }
     }
   } else if (InterfaceConfig::currentRoomMode == roomMode::house) {
@@ -405,12 +417,14 @@ void HomePage::_stopSpecialMode() {
 }
 
 void HomePage::_ceilingMasterButtonEvent() {
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
-    std::list<Light *> onLights = (*RoomManager::currentRoom)->getCeilingLightsThatAreOn();
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
+    std::list<Light *> onLights = currentRoom->getCeilingLightsThatAreOn();
     if (onLights.size() > 0) {
       LightManager::ChangeLightsToLevel(&onLights, 0);
     } else {
-      std::list<Light *> lightList = (*RoomManager::currentRoom)->getAllCeilingLights();
+      std::list<Light *> lightList = currentRoom->getAllCeilingLights();
       LightManager::ChangeLightsToLevel(&lightList, PageManager::GetHomePage()->getDimmingValue());
     }
   } else if (InterfaceConfig::currentRoomMode == roomMode::house) {
@@ -428,13 +442,15 @@ void HomePage::_ceilingMasterButtonEvent() {
 }
 
 void HomePage::_tableMasterButtonEvent() {
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
-    std::list<Light *> onLights = (*RoomManager::currentRoom)->getTableLightsThatAreOn();
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
+    std::list<Light *> onLights = currentRoom->getTableLightsThatAreOn();
 
     if (onLights.size() > 0) {
       LightManager::ChangeLightsToLevel(&onLights, 0);
     } else {
-      std::list<Light *> lightList = (*RoomManager::currentRoom)->getAllTableLights();
+      std::list<Light *> lightList = currentRoom->getAllTableLights();
       LightManager::ChangeLightsToLevel(&lightList, PageManager::GetHomePage()->getDimmingValue());
     }
   } else if (InterfaceConfig::currentRoomMode == roomMode::house) {
@@ -452,14 +468,16 @@ void HomePage::_tableMasterButtonEvent() {
 }
 
 void HomePage::_updateLightsColorTempAccordingToSlider() {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   std::list<Light *> lights;
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
     if (InterfaceConfig::currentEditLightMode == editLightMode::all_lights) {
-      lights = (*RoomManager::currentRoom)->getAllLights();
+      lights = currentRoom->getAllLights();
     } else if (InterfaceConfig::currentEditLightMode == editLightMode::ceiling_lights) {
-      lights = (*RoomManager::currentRoom)->getAllCeilingLights();
+      lights = currentRoom->getAllCeilingLights();
     } else if (InterfaceConfig::currentEditLightMode == editLightMode::table_lights) {
-      lights = (*RoomManager::currentRoom)->getAllTableLights();
+      lights = currentRoom->getAllTableLights();
     }
   } else if (InterfaceConfig::currentRoomMode == roomMode::house) {
     if (InterfaceConfig::currentEditLightMode == editLightMode::all_lights) {
@@ -491,6 +509,8 @@ void HomePage::setCurrentMode(roomMode mode) {
 }
 
 void HomePage::updateLightStatus(bool updateLightLevel, bool updateColorTemperature) {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   uint totalBrightness = 0;
   uint totalBrightnessLights = 0;
   uint totalKelvinLightsCeiling = 0;
@@ -499,19 +519,19 @@ void HomePage::updateLightStatus(bool updateLightLevel, bool updateColorTemperat
   std::list<Light *> ceilingLights;
   std::list<Light *> tableLights;
 
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
     if (InterfaceConfig::currentEditLightMode == editLightMode::all_lights) {
-      anyLightsOn = (*RoomManager::currentRoom)->anyLightsOn();
+      anyLightsOn = currentRoom->anyLightsOn();
 
     } else if (InterfaceConfig::currentEditLightMode == editLightMode::ceiling_lights) {
-      anyLightsOn = (*RoomManager::currentRoom)->anyCeilingLightsOn();
+      anyLightsOn = currentRoom->anyCeilingLightsOn();
     } else if (InterfaceConfig::currentEditLightMode == editLightMode::table_lights) {
-      anyLightsOn = (*RoomManager::currentRoom)->anyTableLightsOn();
+      anyLightsOn = currentRoom->anyTableLightsOn();
     }
-    for (auto lightPair : (*RoomManager::currentRoom)->ceilingLights) {
+    for (auto lightPair : currentRoom->ceilingLights) {
       ceilingLights.push_back(lightPair.second);
     }
-    for (auto lightPair : (*RoomManager::currentRoom)->tableLights) {
+    for (auto lightPair : currentRoom->tableLights) {
       tableLights.push_back(lightPair.second);
     }
   } else if (InterfaceConfig::currentRoomMode == roomMode::house) {
@@ -607,9 +627,11 @@ void HomePage::updateLightStatus(bool updateLightLevel, bool updateColorTemperat
 }
 
 void HomePage::updateRoomInfo() {
-  if (RoomManager::hasValidCurrentRoom()) {
-    if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
-      NSPanel::instance->setComponentText(HOME_PAGE_ROOM_LABEL_NAME, (*RoomManager::currentRoom)->name.c_str());
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
+  if (currentRoom != nullptr) {
+    if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
+      NSPanel::instance->setComponentText(HOME_PAGE_ROOM_LABEL_NAME, currentRoom->name.c_str());
     } else if (InterfaceConfig::currentRoomMode == roomMode::house) {
       NSPanel::instance->setComponentText(HOME_PAGE_ROOM_LABEL_NAME, "All");
     }
@@ -17,6 +17,7 @@ public:
   void processTouchEvent(uint8_t page, uint8_t component, bool pressed);
 
   void entityDeconstructCallback(DeviceEntity *);
+  void entitiesDeconstructCallback(std::list<DeviceEntity *> &entities);
   void entityUpdateCallback(DeviceEntity *);
   void roomChangedCallback();
 
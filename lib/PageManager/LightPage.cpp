@@ -43,6 +43,13 @@ void LightPage::entityUpdateCallback(DeviceEntity *entity) {
   this->update();
 }
 
+void LightPage::entityReplacedCallback(DeviceEntity *replaced, DeviceEntity *replacement) {
+  if (this->selectedLight == replaced) {
+    this->selectedLight = static_cast<Light *>(replacement);
+  }
+  this->update();
+}
+
 void LightPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed) {
   LOG_DEBUG("Got touch event, component ", page, ".", component, " ", pressed ? "pressed" : "released");
 
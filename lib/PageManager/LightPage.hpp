@@ -28,6 +28,7 @@ public:
 
   void entityDeconstructCallback(DeviceEntity *);
   void entityUpdateCallback(DeviceEntity *);
+  void entityReplacedCallback(DeviceEntity *replaced, DeviceEntity *replacement);
 
 private:
   LIGHT_PAGE_MODE _currentMode;
@@ -8,14 +8,16 @@
 #include <TftDefines.h>
 
 void RoomPage::show() {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   this->_selectedLight = nullptr;
   PageManager::SetCurrentPage(this);
   NSPanel::instance->goToPage(ROOM_PAGE_NAME);
   this->update();
 
-  if (RoomManager::hasValidCurrentRoom()) {
+  if (currentRoom != nullptr) {
     for (int i = 0; i < 12; i++) {
-      Light *displayLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(i + 1);
+      Light *displayLight = currentRoom->getLightAtRoomViewPosition(i + 1);
       if (displayLight != nullptr) {
         displayLight->attachUpdateCallback(this);
         displayLight->attachDeconstructCallback(this);
@@ -25,10 +27,12 @@ void RoomPage::show() {
 }
 
 void RoomPage::update() {
-  if (RoomManager::hasValidCurrentRoom()) {
-    this->setCurrentRoomLabel((*RoomManager::currentRoom)->name.c_str());
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
+  if (currentRoom != nullptr) {
+    this->setCurrentRoomLabel(currentRoom->name.c_str());
     for (int i = 0; i < 12; i++) {
-      Light *displayLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(i + 1);
+      Light *displayLight = currentRoom->getLightAtRoomViewPosition(i + 1);
 
       if (displayLight != nullptr) {
         // Add two spaces to the left of the name before sending name to panel
@@ -47,9 +51,11 @@ void RoomPage::update() {
 }
 
 void RoomPage::unshow() {
-  if (RoomManager::hasValidCurrentRoom()) {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
+  if (currentRoom != nullptr) {
     for (int i = 0; i < 12; i++) {
-      Light *displayLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(i + 1);
+      Light *displayLight = currentRoom->getLightAtRoomViewPosition(i + 1);
       if (displayLight != nullptr) {
         displayLight->detachUpdateCallback(this);
         displayLight->detachDeconstructCallback(this);
@@ -59,6 +65,8 @@ void RoomPage::unshow() {
 }
 
 void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed) {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   switch (component) {
   case ROOM_PAGE_BACK_BUTTON_ID:
     // NSPanel::instance->goToPage(HOME_PAGE_NAME);
@@ -73,8 +81,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     this->update();
     break;
   case ROOM_LIGHT1_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(1);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(1);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(1, this->_selectedLight->getLightLevel() > 0);
@@ -83,8 +91,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT2_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(2);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(2);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(2, this->_selectedLight->getLightLevel() > 0);
@@ -93,8 +101,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT3_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(3);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(3);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(3, this->_selectedLight->getLightLevel() > 0);
@@ -103,8 +111,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT4_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(4);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(4);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(4, this->_selectedLight->getLightLevel() > 0);
@@ -113,8 +121,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT5_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(5);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(5);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(4, this->_selectedLight->getLightLevel() > 0);
@@ -123,8 +131,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT6_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(6);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(6);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(6, this->_selectedLight->getLightLevel() > 0);
@@ -133,8 +141,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT7_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(7);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(7);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(7, this->_selectedLight->getLightLevel() > 0);
@@ -143,8 +151,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT8_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(8);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(8);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(8, this->_selectedLight->getLightLevel() > 0);
@@ -153,8 +161,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT9_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(9);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(9);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(9, this->_selectedLight->getLightLevel() > 0);
@@ -163,8 +171,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT10_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(10);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(10);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(10, this->_selectedLight->getLightLevel() > 0);
@@ -173,8 +181,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT11_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(11);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(11);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(11, this->_selectedLight->getLightLevel() > 0);
@@ -183,8 +191,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT12_SW_CAP_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(12);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(12);
       if (this->_selectedLight != nullptr) {
         this->_toggleSelectedLight();
         RoomPage::setLightState(12, this->_selectedLight->getLightLevel() > 0);
@@ -193,8 +201,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT1_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(1);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(1);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -204,8 +212,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT2_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(2);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(2);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -215,8 +223,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT3_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(3);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(3);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -226,8 +234,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT4_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(4);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(4);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -237,8 +245,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT5_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(5);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(5);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -248,8 +256,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT6_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(6);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(6);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -259,8 +267,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT7_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(7);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(7);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -270,8 +278,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT8_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(8);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(8);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -281,8 +289,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT9_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(9);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(9);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -292,8 +300,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT10_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(10);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(10);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -303,8 +311,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT11_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(11);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(11);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -314,8 +322,8 @@ void RoomPage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case ROOM_LIGHT12_LABEL_ID: {
-    if (RoomManager::hasValidCurrentRoom()) {
-      this->_selectedLight = (*RoomManager::currentRoom)->getLightAtRoomViewPosition(12);
+    if (currentRoom != nullptr) {
+      this->_selectedLight = currentRoom->getLightAtRoomViewPosition(12);
       if (this->_selectedLight != nullptr) {
         PageManager::GetLightPage()->selectedLight = this->_selectedLight;
         PageManager::GetLightPage()->show();
@@ -357,6 +365,10 @@ void RoomPage::entityDeconstructCallback(DeviceEntity *entity) {
   this->update();
 }
 
+void RoomPage::entitiesDeconstructCallback(std::list<DeviceEntity *> &entities) {
+  this->update();
+}
+
 void RoomPage::roomChangedCallback() {
   this->update();
 }
@@ -34,6 +34,10 @@ void ScenePage::entityDeconstructCallback(DeviceEntity *entity) {
   this->_updateDisplay();
 }
 
+void ScenePage::entitiesDeconstructCallback(std::list<DeviceEntity *> &entities) {
+  this->_updateDisplay();
+}
+
 void ScenePage::doSceneSaveProgress(void *param) {
   unsigned long countStarted = millis();
   NSPanel::instance->setComponentVisible(SCENES_PAGE_SAVE_SLIDER_NAME, true);
@@ -58,8 +62,10 @@ void ScenePage::doSceneSaveProgress(void *param) {
     }
   }
 
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
-    PageManager::GetScenePage()->_setRoomLabelText((*RoomManager::currentRoom)->name.c_str());
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
+    PageManager::GetScenePage()->_setRoomLabelText(currentRoom->name.c_str());
   } else {
     PageManager::GetScenePage()->_setRoomLabelText("Global Scenes");
   }
@@ -68,11 +74,13 @@ void ScenePage::doSceneSaveProgress(void *param) {
 }
 
 void ScenePage::processTouchEvent(uint8_t page, uint8_t component, bool pressed) {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   std::vector<Scene *> scenes;
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
-    scenes = (*RoomManager::currentRoom)->scenes;
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
+    scenes = currentRoom->scenes;
   } else {
-    scenes = InterfaceConfig::global_scenes;
+    scenes = rooms.globalScenes();
   }
 
   if (pressed) {
@@ -174,16 +182,22 @@ void ScenePage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
     break;
   }
   case SCENES_PAGE_PREVIOUS_SCENES_BUTTON_ID: {
-    if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
+    if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
       RoomManager::goToPreviousRoom();
-      ScenePage::_setRoomLabelText((*RoomManager::currentRoom)->name.c_str());
+      RoomModelSnapshot newRooms;
+      if (newRooms.currentRoom() != nullptr) {
+        ScenePage::_setRoomLabelText(newRooms.currentRoom()->name.c_str());
+      }
     }
     break;
   }
   case SCENES_PAGE_NEXT_SCENES_BUTTON_ID: {
-    if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
+    if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
       RoomManager::goToNextRoom();
-      ScenePage::_setRoomLabelText((*RoomManager::currentRoom)->name.c_str());
+      RoomModelSnapshot newRooms;
+      if (newRooms.currentRoom() != nullptr) {
+        ScenePage::_setRoomLabelText(newRooms.currentRoom()->name.c_str());
+      }
     }
     break;
   }
@@ -193,12 +207,14 @@ void ScenePage::processTouchEvent(uint8_t page, uint8_t component, bool pressed)
 }
 
 void ScenePage::_updateDisplay() {
+  RoomModelSnapshot rooms;
+  Room *currentRoom = rooms.currentRoom();
   std::vector<Scene *> scenes;
-  if (InterfaceConfig::currentRoomMode == roomMode::room && RoomManager::hasValidCurrentRoom()) {
-    scenes = (*RoomManager::currentRoom)->scenes;
-    this->_setRoomLabelText((*RoomManager::currentRoom)->name.c_str());
+  if (InterfaceConfig::currentRoomMode == roomMode::room && currentRoom != nullptr) {
+    scenes = currentRoom->scenes;
+    this->_setRoomLabelText(currentRoom->name.c_str());
   } else {
-    scenes = InterfaceConfig::global_scenes;
+    scenes = rooms.globalScenes();
     this->_setRoomLabelText("Global Scenes");
   }
 
@@ -16,6 +16,7 @@ public:
   static void doSceneSaveProgress(void *param);
 
   void entityDeconstructCallback(DeviceEntity *);
+  void entitiesDeconstructCallback(std::list<DeviceEntity *> &entities);
   void entityUpdateCallback(DeviceEntity *);
 
   void roomChangedCallback();
@@ -119,16 +119,14 @@ Light *Room::getLightAtRoomViewPosition(int room_view_position) {
 }
 
 Light *Room::getLightById(uint16_t id) {
-  for (auto lightPair : this->ceilingLights) {
-    if (lightPair.first == id) {
-      return lightPair.second;
-    }
+  auto light = this->ceilingLights.find(id);
+  if (light != this->ceilingLights.end()) {
+    return light->second;
   }
 
-  for (auto lightPair : this->tableLights) {
-    if (lightPair.first == id) {
-      return lightPair.second;
-    }
+  light = this->tableLights.find(id);
+  if (light != this->tableLights.end()) {
+    return light->second;
   }
 
   return nullptr;
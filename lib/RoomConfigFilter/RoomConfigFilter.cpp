@@ -0,0 +1,28 @@
+#include <RoomConfigFilter.hpp>
+
+void RoomConfigFilter::init() {
+  if (!RoomConfigFilter::panelConfig.isNull()) {
+    return;
+  }
+
+  const char *panel_fields[] = {"name", "home", "default_page", "color_temp_min", "color_temp_max", "reverse_color_temp", "raise_to_100_light_level",
+                                "min_button_push_time", "button_long_press_time", "special_mode_trigger_time", "special_mode_release_time",
+                                "mqtt_ignore_time", "screen_dim_level", "screensaver_dim_level", "screensaver_activation_timeout", "screensaver_mode",
+                                "clock_us_style", "lock_to_default_room", "is_us_panel", "button1_mode", "button2_mode", "use_fahrenheit",
+                                "temperature_calibration", "reverse_relays", "button1_mqtt_topic", "button1_mqtt_payload", "button2_mqtt_topic",
+                                "button2_mqtt_payload", "relay1_default_mode", "relay2_default_mode", "button1_detached_light", "button2_detached_light", "rooms"};
+  for (const char *field : panel_fields) {
+    RoomConfigFilter::panelConfig[field] = true;
+  }
+  RoomConfigFilter::panelConfig["room_versions"] = true;
+  RoomConfigFilter::panelConfig["scenes"]["*"]["name"] = true;
+  RoomConfigFilter::panelConfig["scenes"]["*"]["can_save"] = true;
+
+  RoomConfigFilter::roomConfig["name"] = true;
+  const char *light_fields[] = {"name", "can_dim", "can_temperature", "can_rgb", "view_position", "ceiling"};
+  for (const char *field : light_fields) {
+    RoomConfigFilter::roomConfig["lights"]["*"][field] = true;
+  }
+  RoomConfigFilter::roomConfig["scenes"]["*"]["name"] = true;
+  RoomConfigFilter::roomConfig["scenes"]["*"]["can_save"] = true;
+}
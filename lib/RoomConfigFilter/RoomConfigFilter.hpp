@@ -0,0 +1,17 @@
+#ifndef ROOM_CONFIG_FILTER_HPP
+#define ROOM_CONFIG_FILTER_HPP
+
+#include <ArduinoJson.h>
+
+/// @brief ArduinoJson filters applied while downloading the panel and room configs, only the fields used are kept in memory
+class RoomConfigFilter {
+public:
+  /// @brief Build the filters if not already built. Call before the first config is downloaded.
+  static void init();
+  /// @brief Keeps the fields read by RoomManager::_processPanelConfig
+  static inline JsonDocument panelConfig;
+  /// @brief Keeps the fields read by RoomManager::_processRoomConfig and LightConfig::fromJson
+  static inline JsonDocument roomConfig;
+};
+
+#endif
@@ -1,23 +1,31 @@
 #include "esp32-hal.h"
 #include <ArduinoJson.h>
+#include <BootProfiler.hpp>
 #include <ButtonManager.hpp>
+#include <ConnectionState.hpp>
 #include <HttpLib.hpp>
 #include <InterfaceConfig.hpp>
 #include <Light.hpp>
 #include <LightManager.hpp>
+#include <LittleFS.h>
+#include <ManagerDiscovery.hpp>
 #include <MqttLog.hpp>
 #include <MqttManager.hpp>
 #include <NSPMConfig.h>
 #include <Room.hpp>
+#include <RoomConfigFilter.hpp>
 #include <RoomManager.hpp>
 #include <Scene.hpp>
 #include <WiFi.h>
+#include <algorithm>
 #include <map>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 void RoomManager::init() {
-  RoomManager::currentRoom = RoomManager::rooms.end();
   RoomManager::_lastReloadCommand = millis();
+  RoomConfigFilter::init();
 }
 
 void RoomManager::performConfigReload() {
@@ -31,29 +39,33 @@ void RoomManager::performConfigReload() {
   RoomManager::_lastReloadCommand = millis();
 }
 
-void RoomManager::loadAllRooms(bool is_update) {
-  bool save_new_config_to_littlefs_at_end = false;
-  bool reboot_after_config_saved = false;
+void RoomManager::loadAllRooms(bool is_update, void (*homeRoomLoadedCallback)()) {
   JsonDocument *roomData = new JsonDocument;
   uint8_t tries = 0;
   bool successDownloadingConfig = false;
+  bool panelConfigModified = true;
+  if (!is_update) {
+    RoomManager::_panelConfigETag.clear();
+  }
   do {
     // Sometimes when running WiFi.macAddress garbage is returned.
     // Keep creation of download URL in the loop.
-    std::string roomDataJsonUrl = "http://";
-    roomDataJsonUrl.append(NSPMConfig::instance->manager_address);
-    roomDataJsonUrl.append(":");
-    roomDataJsonUrl.append(std::to_string(NSPMConfig::instance->manager_port));
+    // The saved, discovered or registered manager, whichever is the most trusted so far
+    std::string roomDataJsonUrl = ManagerDiscovery::getManagerUrl();
     roomDataJsonUrl.append("/api/get_nspanel_config?mac=");
     roomDataJsonUrl.append(WiFi.macAddress().c_str());
     LOG_INFO("Trying to download config from: ", roomDataJsonUrl.c_str());
-    successDownloadingConfig = HttpLib::DownloadJSON(roomDataJsonUrl.c_str(), roomData);
+    successDownloadingConfig = HttpLib::DownloadJSON(roomDataJsonUrl.c_str(), roomData, &RoomManager::_panelConfigETag, &panelConfigModified, &RoomConfigFilter::panelConfig);
 
-    if (roomData->size() == 0) {
+    if (panelConfigModified && roomData->size() == 0) {
       successDownloadingConfig = false; // The HTTP call succeeded but we got no data, do not count it as a success
     }
 
-    if (!successDownloadingConfig) {
+    if (!successDownloadingConfig && !ConnectionState::isSet(CONNECTION_STATE_REGISTERED)) {
+      // The saved or discovered manager did not answer, wait for a manager to accept the register request and use that instead
+      LOG_WARNING("Failed to download config from unconfirmed manager, waiting for registration.");
+      ConnectionState::waitFor(CONNECTION_STATE_REGISTERED, portMAX_DELAY);
+    } else if (!successDownloadingConfig) {
       tries++;
       LOG_ERROR("Failed to download config, will try again in 5 seconds.");
       vTaskDelay(5000 / portTICK_PERIOD_MS);
@@ -67,6 +79,58 @@ void RoomManager::loadAllRooms(bool is_update) {
       }
     }
   } while (!successDownloadingConfig);
+
+  if (!panelConfigModified && RoomManager::_panelConfigHasRoomVersions) {
+    // The room versions are part of the panel config, an unchanged panel config means that no room has changed either
+    LOG_INFO("Panel config not modified, rooms are up to date.");
+    delete roomData;
+    NSPMConfig::instance->successful_config_load = true;
+    return;
+  }
+
+  if (!panelConfigModified) {
+    // Panel config is the same as already loaded but has no room versions, only the config for the loaded rooms may have changed.
+    LOG_INFO("Panel config not modified, checking rooms.");
+    delete roomData;
+    RoomManager::_beginModelUpdate();
+    std::vector<uint16_t> roomIds;
+    for (Room *room : RoomManager::_nextModel->rooms) {
+      roomIds.push_back(room->id);
+    }
+    bool roomsModified = RoomManager::_loadRooms(roomIds, JsonObjectConst(), true, nullptr, false);
+    RoomManager::_publishModel();
+    if (roomsModified) {
+      LOG_DEBUG("Calling roomChangedCallback");
+      RoomManager::_callRoomChangeCallbacks();
+    }
+    NSPMConfig::instance->successful_config_load = true;
+    return;
+  }
+
+  RoomManager::_saveConfigSnapshot(ROOM_MANAGER_PANEL_SNAPSHOT_PATH, roomData, RoomManager::_panelConfigETag);
+  RoomManager::_processPanelConfig(roomData, is_update, homeRoomLoadedCallback, false);
+  delete roomData;
+  NSPMConfig::instance->successful_config_load = true;
+}
+
+bool RoomManager::loadAllRoomsFromSnapshot(void (*homeRoomLoadedCallback)()) {
+  JsonDocument *roomData = new JsonDocument;
+  if (!RoomManager::_readConfigSnapshot(ROOM_MANAGER_PANEL_SNAPSHOT_PATH, roomData, &RoomManager::_panelConfigETag)) {
+    delete roomData;
+    return false;
+  }
+
+  LOG_INFO("Loading config from snapshot.");
+  RoomManager::_processPanelConfig(roomData, false, homeRoomLoadedCallback, true);
+  delete roomData;
+  return true;
+}
+
+void RoomManager::_processPanelConfig(JsonDocument *roomData, bool is_update, void (*homeRoomLoadedCallback)(), bool from_snapshot) {
+  bool save_new_config_to_littlefs_at_end = false;
+  bool reboot_after_config_saved = false;
+  RoomManager::_beginModelUpdate();
+
   // Config downloaded, process the raw data
   // The config also contains other config values for the interface. Populate InterfaceConfig
   InterfaceConfig::homeScreen = (*roomData)["home"].as<uint16_t>();
@@ -132,118 +196,173 @@ void RoomManager::loadAllRooms(bool is_update) {
   }
 
   // Load global scenes
+  std::unordered_set<uint16_t> json_scene_ids;
   JsonVariant json_scenes = (*roomData)["scenes"];
   for (JsonPair scenePair : json_scenes.as<JsonObject>()) {
-    bool existing_scene;
-    Scene *newScene = InterfaceConfig::getSceneById(atoi(scenePair.key().c_str()));
-    if (newScene == nullptr) {
-      existing_scene = false;
-      newScene = new Scene();
-    } else {
-      existing_scene = true;
-    }
-    newScene->room = nullptr;
-    newScene->id = atoi(scenePair.key().c_str());
-    newScene->name = scenePair.value()["name"] | "ERR-S";
-    newScene->canSave = scenePair.value()["can_save"].as<String>().equals("true");
-    newScene->callUpdateCallbacks();
-    if (!existing_scene) {
-      InterfaceConfig::global_scenes.push_back(newScene);
-      LOG_TRACE("Loaded scene ", newScene->id, "::", newScene->name.c_str());
-    }
+    json_scene_ids.insert(atoi(scenePair.key().c_str()));
   }
 
-  for (auto it = InterfaceConfig::global_scenes.cbegin(); it != InterfaceConfig::global_scenes.cend();) {
-    // Check if this light ID exist in JSON config
-    bool scene_found = false;
-    for (JsonPair jsonLightPair : json_scenes.as<JsonObject>()) {
-      if (atoi(jsonLightPair.key().c_str()) == (*it)->getId()) {
-        scene_found = true;
-        break;
-      }
-    }
-
-    if (!scene_found) {
+  for (auto it = RoomManager::_nextModel->global_scenes.cbegin(); it != RoomManager::_nextModel->global_scenes.cend();) {
+    if (json_scene_ids.count((*it)->getId()) == 0) {
       Scene *scene_to_remove = (*it);
       LOG_DEBUG("Removing global scene: ", scene_to_remove->getName().c_str(), ". ID: ", scene_to_remove->getId());
-      it = InterfaceConfig::global_scenes.erase(it);
-      scene_to_remove->callDeconstructCallbacks();
-      delete scene_to_remove;
+      it = RoomManager::_nextModel->global_scenes.erase(it);
+      RoomManager::_retiringObjects.scenes.push_back(scene_to_remove);
     } else {
       it++;
     }
   }
+  RoomManager::_processScenes(json_scenes.as<JsonObject>(), &RoomManager::_nextModel->global_scenes);
 
   // Init rooms
+  std::vector<uint16_t> roomIds;
   for (uint16_t roomId : (*roomData)["rooms"].as<JsonArray>()) {
     if (InterfaceConfig::lock_to_default_room && roomId != InterfaceConfig::homeScreen) {
       continue;
     }
-    LOG_INFO("Getting config for room ", roomId);
-    Room *room = RoomManager::loadRoom(roomId, is_update);
-    if (RoomManager::getRoomById(roomId) == nullptr) {
-      // If a nullptr is returned, a room by that id was not found
-      RoomManager::rooms.push_back(room);
+    roomIds.push_back(roomId);
+  }
+  JsonObjectConst roomVersions = (*roomData)["room_versions"].as<JsonObjectConst>();
+  RoomManager::_panelConfigHasRoomVersions = !roomVersions.isNull();
+  RoomManager::_loadRooms(roomIds, roomVersions, is_update, homeRoomLoadedCallback, from_snapshot);
+
+  if (is_update) {
+    // Remove rooms that are no longer configured for this panel
+    std::unordered_set<uint16_t> configured_room_ids(roomIds.begin(), roomIds.end());
+    for (auto it = RoomManager::_nextModel->rooms.begin(); it != RoomManager::_nextModel->rooms.end();) {
+      if (configured_room_ids.count((*it)->id) == 0) {
+        LOG_DEBUG("Removing room: ", (*it)->name.c_str(), ". ID: ", (*it)->id);
+        RoomManager::_retireRoom(*it);
+        it = RoomManager::_nextModel->rooms.erase(it);
+      } else {
+        it++;
+      }
     }
   }
+  RoomManager::_publishModel();
 
   if (!is_update) {
-    // Set currentRoom to the default room for this panel
-    if (!RoomManager::goToRoomId(InterfaceConfig::homeScreen)) {
+    // Set the current room to the default room for this panel, if not already done when the home room was loaded
+    RoomModelSnapshot rooms;
+    if (rooms.currentRoom() == nullptr && !RoomManager::goToRoomId(InterfaceConfig::homeScreen)) {
       LOG_ERROR("Failed to go to default room.");
-      if (RoomManager::rooms.size() > 0) {
+      if (rooms.rooms().size() > 0) {
         LOG_WARNING("Navigating to first room instead of default room as that failed.");
-        RoomManager::currentRoom = RoomManager::rooms.begin();
+        RoomManager::goToRoomId(rooms.rooms().front()->id);
       } else {
         LOG_ERROR("No rooms loaded!");
       }
     }
   } else {
-    // TODO: Implement function that remove any rooms currecntly loaded but not configured (ie. removed through manager)
     LOG_DEBUG("Calling roomChangedCallback");
     RoomManager::_callRoomChangeCallbacks(); // Call room change update to force an update for other components
   }
 
-  // All rooms and lights has loaded, prep buttonmanager
+  // All rooms and lights has loaded, prep buttonmanager. Only the IDs are kept, the lights are looked up on each press.
+  RoomModelSnapshot rooms;
   if (NSPMConfig::instance->button1_mode == BUTTON_MODE::DETACHED) {
-    ButtonManager::button1_detached_mode_light = LightManager::getLightById((*roomData)["button1_detached_light"].as<uint16_t>());
-    if (ButtonManager::button1_detached_mode_light != nullptr) {
-      LOG_DEBUG("Button 1 detached mode light: ", ButtonManager::button1_detached_mode_light->getName().c_str());
+    ButtonManager::button1_detached_mode_light_id = (*roomData)["button1_detached_light"].as<uint16_t>();
+    Light *light = LightManager::getLightById(ButtonManager::button1_detached_mode_light_id);
+    if (light != nullptr) {
+      LOG_DEBUG("Button 1 detached mode light: ", light->getName().c_str());
     } else {
-      LOG_ERROR("Coudln't find Button 1 detached mode light with ID: ", (*roomData)["button1_detached_light"].as<uint16_t>());
+      LOG_ERROR("Coudln't find Button 1 detached mode light with ID: ", ButtonManager::button1_detached_mode_light_id);
     }
   } else {
-    ButtonManager::button1_detached_mode_light = nullptr;
+    ButtonManager::button1_detached_mode_light_id = -1;
   }
   if (NSPMConfig::instance->button2_mode == BUTTON_MODE::DETACHED) {
-    ButtonManager::button2_detached_mode_light = LightManager::getLightById((*roomData)["button2_detached_light"].as<uint16_t>());
-    if (ButtonManager::button2_detached_mode_light != nullptr) {
-      LOG_DEBUG("Button 2 detached mode light: ", ButtonManager::button2_detached_mode_light->getName().c_str());
+    ButtonManager::button2_detached_mode_light_id = (*roomData)["button2_detached_light"].as<uint16_t>();
+    Light *light = LightManager::getLightById(ButtonManager::button2_detached_mode_light_id);
+    if (light != nullptr) {
+      LOG_DEBUG("Button 2 detached mode light: ", light->getName().c_str());
     } else {
-      LOG_ERROR("Coudln't find Button 2 detached mode light with ID: ", (*roomData)["button2_detached_light"].as<uint16_t>());
+      LOG_ERROR("Coudln't find Button 2 detached mode light with ID: ", ButtonManager::button2_detached_mode_light_id);
     }
   } else {
-    ButtonManager::button2_detached_mode_light = nullptr;
+    ButtonManager::button2_detached_mode_light_id = -1;
   }
+}
 
-  NSPMConfig::instance->successful_config_load = true;
+bool RoomManager::_readConfigSnapshot(const char *path, JsonDocument *document, std::string *etag) {
+  if (!NSPMConfig::instance->littlefs_mount_successfull || !LittleFS.exists(path)) {
+    return false;
+  }
+  File file = LittleFS.open(path, "r");
+  if (!file) {
+    return false;
+  }
+  *etag = file.readStringUntil('\n').c_str();
+  DeserializationError error = deserializeMsgPack(*document, file);
+  file.close();
+  if (error) {
+    LOG_ERROR("Failed to read config snapshot '", path, "': ", error.c_str());
+    etag->clear();
+    return false;
+  }
+  return true;
+}
+
+void RoomManager::_saveConfigSnapshot(const char *path, JsonDocument *document, std::string &etag) {
+  if (!NSPMConfig::instance->littlefs_mount_successfull) {
+    return;
+  }
+  std::string tmp_path = path;
+  tmp_path.append(".tmp");
+  File file = LittleFS.open(tmp_path.c_str(), "w", true);
+  if (!file) {
+    LOG_ERROR("Failed to open '", tmp_path.c_str(), "' for writing.");
+    return;
+  }
+  file.print(etag.c_str());
+  file.print('\n');
+  size_t size = serializeMsgPack(*document, file);
+  file.close();
+  // Rename replaces the old snapshot in one step so a power cut never leaves a partially written snapshot
+  if (size == 0 || !LittleFS.rename(tmp_path.c_str(), path)) {
+    LOG_ERROR("Failed to save config snapshot '", path, "'.");
+    LittleFS.remove(tmp_path.c_str());
+  }
 }
 
-Room *RoomManager::loadRoom(uint16_t roomId, bool is_update) {
+Room *RoomManager::loadRoom(uint16_t roomId, bool is_update, bool *modified) {
+  // Only ask for changes if the room is loaded, otherwise there is nothing to keep
+  std::string &roomConfigETag = RoomManager::_roomConfigETags[roomId];
+  if (!is_update || RoomManager::getRoomById(roomId) == nullptr) {
+    roomConfigETag.clear();
+  }
+
   JsonDocument *roomData = new JsonDocument;
+  bool roomConfigModified;
+  RoomManager::_downloadRoomConfig(roomId, roomData, &roomConfigETag, &roomConfigModified);
+  if (modified != nullptr) {
+    *modified = roomConfigModified;
+  }
+
+  Room *room;
+  if (roomConfigModified) {
+    RoomManager::_beginModelUpdate();
+    room = RoomManager::_applyRoomConfig(roomId, roomData, is_update, nullptr);
+    RoomManager::_publishModel();
+  } else {
+    LOG_DEBUG("Config for room ", roomId, " not modified.");
+    room = RoomManager::getRoomById(roomId);
+  }
+  delete roomData;
+  return room;
+}
+
+void RoomManager::_downloadRoomConfig(uint16_t roomId, JsonDocument *roomData, std::string *etag, bool *modified) {
   uint8_t tries = 0;
   bool successDownloadingConfig = false;
 
   do {
-    std::string roomDataJsonUrl = "http://";
-    roomDataJsonUrl.append(NSPMConfig::instance->manager_address);
-    roomDataJsonUrl.append(":");
-    roomDataJsonUrl.append(std::to_string(NSPMConfig::instance->manager_port));
+    std::string roomDataJsonUrl = ManagerDiscovery::getManagerUrl();
     roomDataJsonUrl.append("/api/get_nspanel_config/room/");
     roomDataJsonUrl.append(std::to_string(roomId));
     LOG_INFO("Downloading room config from: ", roomDataJsonUrl.c_str());
 
-    successDownloadingConfig = HttpLib::DownloadJSON(roomDataJsonUrl.c_str(), roomData);
+    successDownloadingConfig = HttpLib::DownloadJSON(roomDataJsonUrl.c_str(), roomData, etag, modified, &RoomConfigFilter::roomConfig);
 
     if (!successDownloadingConfig) {
       tries++;
@@ -259,102 +378,419 @@ Room *RoomManager::loadRoom(uint16_t roomId, bool is_update) {
       }
     }
   } while (!successDownloadingConfig);
-  // Successfully downloaded config, proceed to process it
-  // Load already existing room or if a nullptr was returned, create a new room.
-  Room *newRoom = RoomManager::getRoomById(roomId);
-  if (newRoom == nullptr) {
-    newRoom = new Room();
+}
+
+bool RoomManager::_loadRooms(std::vector<uint16_t> &roomIds, JsonObjectConst roomVersions, bool is_update, void (*homeRoomLoadedCallback)(), bool from_snapshot) {
+  std::vector<uint16_t> roomIdsToLoad;
+  for (uint16_t roomId : roomIds) {
+    // Rooms not yet loaded are always downloaded in full
+    std::string &roomConfigETag = RoomManager::_roomConfigETags[roomId];
+    if (!is_update || RoomManager::_findRoom(&RoomManager::_nextModel->rooms, roomId) == nullptr) {
+      roomConfigETag.clear();
+    } else if (!roomVersions.isNull()) {
+      // Skip loaded rooms the manager says have not changed
+      JsonVariantConst version = roomVersions[std::to_string(roomId)];
+      auto loadedVersion = RoomManager::_roomConfigVersions.find(roomId);
+      if (!version.isNull() && loadedVersion != RoomManager::_roomConfigVersions.end() && loadedVersion->second == version.as<uint32_t>()) {
+        continue;
+      }
+    }
+    roomIdsToLoad.push_back(roomId);
+  }
+  LOG_DEBUG("Loading ", roomIdsToLoad.size(), " of ", roomIds.size(), " rooms.");
+
+  // Download the home room first so the panel can be used as soon as possible
+  std::stable_partition(roomIdsToLoad.begin(), roomIdsToLoad.end(), [](uint16_t roomId) { return roomId == InterfaceConfig::homeScreen; });
+  // The task gets its own copy of everything it needs, nothing it reads is changed while it runs
+  RoomConfigPrefetch *prefetch = new RoomConfigPrefetch;
+  prefetch->from_snapshot = from_snapshot;
+  for (uint16_t roomId : roomIdsToLoad) {
+    RoomConfigDownload *download = new RoomConfigDownload;
+    download->room_id = roomId;
+    download->etag = RoomManager::_roomConfigETags[roomId];
+    prefetch->downloads.push_back(download);
   }
-  newRoom->id = roomId;
-  newRoom->name = (*roomData)["name"] | "ERR";
 
-  // Load and init all lights for the room
-  JsonVariant json_lights = (*roomData)["lights"];
-  for (JsonPair lightPair : json_lights.as<JsonObject>()) {
-    bool existing_light;
-    Light *newLight = newRoom->getLightById(atoi(lightPair.key().c_str()));
-    if (newLight == nullptr) {
-      existing_light = false;
-      newLight = new Light();
+  if (!roomVersions.isNull()) {
+    for (uint16_t roomId : roomIds) {
+      JsonVariantConst version = roomVersions[std::to_string(roomId)];
+      if (!version.isNull()) {
+        RoomManager::_roomConfigVersions[roomId] = version.as<uint32_t>();
+      }
+    }
+  }
+
+  if (RoomManager::_roomConfigQueue == NULL) {
+    RoomManager::_roomConfigQueue = xQueueCreate(ROOM_CONFIG_PREFETCH_DEPTH, sizeof(RoomConfigDownload *));
+    RoomManager::_roomConfigPrefetchDone = xSemaphoreCreateBinary();
+  }
+  size_t numberOfDownloads = prefetch->downloads.size();
+  xTaskCreatePinnedToCore(_taskPrefetchRoomConfigs, "taskPrefetchRoomConfigs", 6000, prefetch, 1, NULL, CONFIG_ARDUINO_RUNNING_CORE);
+
+  // Process each room while the next ones are downloading
+  bool anyRoomModified = false;
+  for (size_t i = 0; i < numberOfDownloads; i++) {
+    RoomConfigDownload *download;
+    xQueueReceive(RoomManager::_roomConfigQueue, &download, portMAX_DELAY);
+
+    Room *room = RoomManager::_findRoom(&RoomManager::_nextModel->rooms, download->room_id);
+    if (download->modified) {
+      LOG_INFO("Loading config for room ", download->room_id);
+      RoomManager::_roomConfigETags[download->room_id] = download->etag;
+      room = RoomManager::_applyRoomConfig(download->room_id, download->document, is_update, &roomIds);
+      anyRoomModified = true;
+      if (!from_snapshot) {
+        RoomManager::_saveConfigSnapshot(RoomManager::_getRoomSnapshotPath(download->room_id).c_str(), download->document, download->etag);
+      }
+    } else if (from_snapshot) {
+      // The room is left out until the config is downloaded, make sure the full panel config is downloaded then
+      LOG_WARNING("No snapshot for room ", download->room_id, ".");
+      RoomManager::_panelConfigETag.clear();
     } else {
-      existing_light = true;
+      LOG_DEBUG("Config for room ", download->room_id, " not modified.");
     }
-    std::map<std::string, std::string> data;
-    data["id"] = lightPair.key().c_str();
-    for (JsonPair lightSettingsPair : lightPair.value().as<JsonObject>()) {
-      data[lightSettingsPair.key().c_str()] = lightSettingsPair.value().as<String>().c_str();
+    delete download->document;
+    delete download;
+
+    if (!is_update && room != nullptr && room->id == InterfaceConfig::homeScreen) {
+      BootProfiler::mark("home_room_loaded");
+      // Publish what has been loaded so far so the home room can be shown, continue with the rest of the rooms on a new copy
+      RoomManager::_publishModel();
+      RoomManager::_beginModelUpdate();
+      RoomManager::goToRoomId(InterfaceConfig::homeScreen);
+      if (homeRoomLoadedCallback != nullptr) {
+        homeRoomLoadedCallback();
+      }
     }
-    newLight->initFromMap(data);
+  }
+  // The next load reuses the queue, wait until the task is done with it
+  xSemaphoreTake(RoomManager::_roomConfigPrefetchDone, portMAX_DELAY);
+  return anyRoomModified;
+}
 
-    //  If the light is new (ie. not updated from existing) push it into the correct list.
-    if (!existing_light) {
-      if (lightPair.value()["ceiling"] == true) {
-        newRoom->ceilingLights.insert(std::make_pair(newLight->getId(), newLight));
-      } else {
-        newRoom->tableLights.insert(std::make_pair(newLight->getId(), newLight));
-      }
+void RoomManager::_taskPrefetchRoomConfigs(void *param) {
+  RoomConfigPrefetch *prefetch = (RoomConfigPrefetch *)param;
+  for (RoomConfigDownload *download : prefetch->downloads) {
+    download->document = new JsonDocument;
+    if (prefetch->from_snapshot) {
+      download->modified = RoomManager::_readConfigSnapshot(RoomManager::_getRoomSnapshotPath(download->room_id).c_str(), download->document, &download->etag);
+    } else {
+      RoomManager::_downloadRoomConfig(download->room_id, download->document, &download->etag, &download->modified);
     }
+    // Blocks while ROOM_CONFIG_PREFETCH_DEPTH rooms are waiting to be processed. The download belongs to the loading task from here on.
+    xQueueSendToBack(RoomManager::_roomConfigQueue, &download, portMAX_DELAY);
   }
+  delete prefetch;
+  xSemaphoreGive(RoomManager::_roomConfigPrefetchDone);
+  vTaskDelete(NULL);
+}
 
-  if (is_update) {
-    for (auto it = newRoom->ceilingLights.cbegin(); it != newRoom->ceilingLights.cend();) {
-      // Check if this light ID exist in JSON config
-      bool light_id_found = false;
-      for (JsonPair jsonLightPair : json_lights.as<JsonObject>()) {
-        if (atoi(jsonLightPair.key().c_str()) == (*it).first) {
-          light_id_found = true;
-          break;
-        }
-      }
+Room *RoomManager::_applyRoomConfig(uint16_t roomId, JsonDocument *roomData, bool is_update, std::vector<uint16_t> *roomOrder) {
+  Room *oldRoom = RoomManager::_findRoom(&RoomManager::_nextModel->rooms, roomId);
+  Room *newRoom = RoomManager::_processRoomConfig(oldRoom, roomId, roomData, is_update);
+  if (oldRoom != nullptr) {
+    // Only the old room container is retired, its lights and scenes are shared with the new room
+    std::replace(RoomManager::_nextModel->rooms.begin(), RoomManager::_nextModel->rooms.end(), oldRoom, newRoom);
+    RoomManager::_retiringObjects.rooms.push_back(oldRoom);
+  } else if (roomOrder != nullptr) {
+    RoomManager::_insertRoomInOrder(newRoom, *roomOrder);
+  } else {
+    RoomManager::_nextModel->rooms.push_back(newRoom);
+  }
+  return newRoom;
+}
 
-      if (!light_id_found) {
-        Light *light_to_remove = (*it).second;
-        LOG_DEBUG("Removing light: ", light_to_remove->getName().c_str(), ". ID: ", light_to_remove->getId());
-        it = newRoom->ceilingLights.erase(it);
-        light_to_remove->callDeconstructCallbacks();
-        delete light_to_remove;
-      } else {
-        it++;
+void RoomManager::_retireRoom(Room *room) {
+  for (std::unordered_map<uint16_t, Light *> *lights : {&room->ceilingLights, &room->tableLights}) {
+    for (auto lightPair : *lights) {
+      RoomManager::_retiringObjects.lights.push_back(lightPair.second);
+    }
+  }
+  for (Scene *scene : room->scenes) {
+    RoomManager::_retiringObjects.scenes.push_back(scene);
+  }
+  RoomManager::_retiringObjects.rooms.push_back(room);
+  RoomManager::_roomConfigETags.erase(room->id);
+  RoomManager::_roomConfigVersions.erase(room->id);
+  if (NSPMConfig::instance->littlefs_mount_successfull) {
+    LittleFS.remove(RoomManager::_getRoomSnapshotPath(room->id).c_str());
+  }
+}
+
+RoomModelSnapshot::RoomModelSnapshot() {
+  this->_model = RoomManager::_acquireModel();
+}
+
+RoomModelSnapshot::~RoomModelSnapshot() {
+  RoomManager::_releaseModel(this->_model);
+}
+
+const std::list<Room *> &RoomModelSnapshot::rooms() {
+  return this->_model->rooms;
+}
+
+const std::vector<Scene *> &RoomModelSnapshot::globalScenes() {
+  return this->_model->global_scenes;
+}
+
+Room *RoomModelSnapshot::currentRoom() {
+  int32_t currentRoomId = this->_model->current_room_id;
+  if (currentRoomId < 0) {
+    return nullptr;
+  }
+  return RoomManager::_findRoom(&this->_model->rooms, currentRoomId);
+}
+
+RoomModel *RoomManager::_acquireModel() {
+  portENTER_CRITICAL(&RoomManager::_modelMux);
+  RoomModel *model = RoomManager::_model;
+  model->readers++;
+  portEXIT_CRITICAL(&RoomManager::_modelMux);
+  return model;
+}
+
+void RoomManager::_releaseModel(RoomModel *model) {
+  portENTER_CRITICAL(&RoomManager::_modelMux);
+  model->readers--;
+  bool reclaim = model->retired && model->readers == 0;
+  portEXIT_CRITICAL(&RoomManager::_modelMux);
+  if (reclaim) {
+    RoomManager::_reclaimRetiredModels();
+  }
+}
+
+Room *RoomManager::_findRoom(const std::list<Room *> *rooms, uint16_t roomId) {
+  for (Room *room : *rooms) {
+    if (room->id == roomId) {
+      return room;
+    }
+  }
+  return nullptr;
+}
+
+void RoomManager::_beginModelUpdate() {
+  if (RoomManager::_nextModel == nullptr) {
+    // Only _publishModel replaces the published model, it is safe to read here without holding a snapshot
+    RoomManager::_nextModel = new RoomModel();
+    RoomManager::_nextModel->rooms = RoomManager::_model->rooms;
+    RoomManager::_nextModel->global_scenes = RoomManager::_model->global_scenes;
+  }
+}
+
+/// @brief A light or scene replaced by _publishModel and the observers that were moved to its replacement
+struct ReplacedEntity {
+  DeviceEntity *replaced;
+  DeviceEntity *replacement;
+  std::list<DeviceEntityObserver *> observers;
+};
+
+void RoomManager::_publishModel() {
+  if (RoomManager::_nextModel == nullptr) {
+    return;
+  }
+
+  RoomModel *newModel = RoomManager::_nextModel;
+  RoomManager::_nextModel = nullptr;
+  RoomModel *oldModel = RoomManager::_model;
+  oldModel->retired_objects = std::move(RoomManager::_retiringObjects);
+  RoomManager::_retiringObjects = RetiredRoomObjects();
+
+  // Observers drop their references to removed lights and scenes, replaced ones are handed over to their replacement instead
+  std::list<DeviceEntity *> removedEntities(oldModel->retired_objects.lights.begin(), oldModel->retired_objects.lights.end());
+  removedEntities.insert(removedEntities.end(), oldModel->retired_objects.scenes.begin(), oldModel->retired_objects.scenes.end());
+
+  // Replacements continue from the latest state of the lights they replace. A light level received from MQTT between here and the swap
+  // below still lands on the replaced light and is only picked up by the next state message for the light.
+  std::vector<ReplacedEntity> replacedEntities;
+  for (auto &pair : RoomManager::_replacedLights) {
+    replacedEntities.push_back({pair.first, pair.second, pair.second->takeOver(pair.first)});
+    oldModel->retired_objects.lights.push_back(pair.first);
+  }
+  for (auto &pair : RoomManager::_replacedScenes) {
+    replacedEntities.push_back({pair.first, pair.second, pair.second->takeOver(pair.first)});
+    oldModel->retired_objects.scenes.push_back(pair.first);
+  }
+  RoomManager::_replacedLights.clear();
+  RoomManager::_replacedScenes.clear();
+
+  // Readers see either the old or the new model, never a model being modified. The current room moves to the new model in the same
+  // critical section so that navigation in between is not lost.
+  portENTER_CRITICAL(&RoomManager::_modelMux);
+  // Keep the current room, fall back to the home room or the first room if it was removed
+  int32_t currentRoomId = oldModel->current_room_id;
+  if (currentRoomId >= 0) {
+    Room *currentRoom = nullptr;
+    for (uint16_t roomId : {(uint16_t)currentRoomId, (uint16_t)InterfaceConfig::homeScreen}) {
+      currentRoom = RoomManager::_findRoom(&newModel->rooms, roomId);
+      if (currentRoom != nullptr) {
+        break;
       }
     }
+    if (currentRoom == nullptr && !newModel->rooms.empty()) {
+      currentRoom = newModel->rooms.front();
+    }
+    newModel->current_room_id = currentRoom != nullptr ? currentRoom->id : -1;
+  }
+  RoomManager::_model = newModel;
+  oldModel->retired = true;
+  // Held until the observers below are done with the removed and replaced lights and scenes
+  oldModel->readers++;
+  if (RoomManager::_newestRetiredModel != nullptr) {
+    RoomManager::_newestRetiredModel->next_retired = oldModel;
+  } else {
+    RoomManager::_oldestRetiredModel = oldModel;
+  }
+  RoomManager::_newestRetiredModel = oldModel;
+  portEXIT_CRITICAL(&RoomManager::_modelMux);
+
+  // The removed and replaced objects are deleted once no snapshot holds them
+  if (removedEntities.size() > 0) {
+    LOG_DEBUG("Deconstructing ", removedEntities.size(), " removed lights and scenes.");
+    DeviceEntity::callDeconstructCallbacks(removedEntities);
+  }
+  for (ReplacedEntity &entity : replacedEntities) {
+    for (DeviceEntityObserver *observer : entity.observers) {
+      observer->entityReplacedCallback(entity.replaced, entity.replacement);
+    }
+  }
+  RoomManager::_releaseModel(oldModel);
+}
 
-    for (auto it = newRoom->tableLights.cbegin(); it != newRoom->tableLights.cend();) {
-      // Check if this light ID exist in JSON config
-      bool light_id_found = false;
-      for (JsonPair jsonLightPair : json_lights.as<JsonObject>()) {
-        if (atoi(jsonLightPair.key().c_str()) == (*it).first) {
-          light_id_found = true;
-          break;
-        }
+void RoomManager::_reclaimRetiredModels() {
+  // Objects retired with a model may still be in older models, so models are only deleted oldest first
+  portENTER_CRITICAL(&RoomManager::_modelMux);
+  RoomModel *reclaimed = RoomManager::_oldestRetiredModel;
+  while (RoomManager::_oldestRetiredModel != nullptr && RoomManager::_oldestRetiredModel->readers == 0) {
+    RoomManager::_oldestRetiredModel = RoomManager::_oldestRetiredModel->next_retired;
+  }
+  RoomModel *kept = RoomManager::_oldestRetiredModel;
+  if (kept == nullptr) {
+    RoomManager::_newestRetiredModel = nullptr;
+  }
+  portEXIT_CRITICAL(&RoomManager::_modelMux);
+
+  while (reclaimed != kept) {
+    RoomModel *next = reclaimed->next_retired;
+    for (Light *light : reclaimed->retired_objects.lights) {
+      delete light;
+    }
+    for (Scene *scene : reclaimed->retired_objects.scenes) {
+      delete scene;
+    }
+    for (Room *room : reclaimed->retired_objects.rooms) {
+      delete room;
+    }
+    delete reclaimed;
+    reclaimed = next;
+  }
+}
+
+void RoomManager::unloadAllRooms() {
+  RoomManager::_beginModelUpdate();
+  for (Room *room : RoomManager::_nextModel->rooms) {
+    for (std::unordered_map<uint16_t, Light *> *lights : {&room->ceilingLights, &room->tableLights}) {
+      for (auto lightPair : *lights) {
+        RoomManager::_retiringObjects.lights.push_back(lightPair.second);
       }
+    }
+    for (Scene *scene : room->scenes) {
+      RoomManager::_retiringObjects.scenes.push_back(scene);
+    }
+    RoomManager::_retiringObjects.rooms.push_back(room);
+  }
+  RoomManager::_nextModel->rooms.clear();
+  for (Scene *scene : RoomManager::_nextModel->global_scenes) {
+    RoomManager::_retiringObjects.scenes.push_back(scene);
+  }
+  RoomManager::_nextModel->global_scenes.clear();
+  // Nothing is loaded anymore, the next load must not skip any room or panel config. The snapshot on LittleFS is kept.
+  RoomManager::_panelConfigETag.clear();
+  RoomManager::_panelConfigHasRoomVersions = false;
+  RoomManager::_roomConfigETags.clear();
+  RoomManager::_roomConfigVersions.clear();
+  RoomManager::_publishModel();
+}
 
-      if (!light_id_found) {
-        Light *light_to_remove = (*it).second;
-        LOG_DEBUG("Removing light: ", light_to_remove->getName().c_str(), ". ID: ", light_to_remove->getId());
-        it = newRoom->tableLights.erase(it);
-        light_to_remove->callDeconstructCallbacks();
-        delete light_to_remove;
-      } else {
-        it++;
+std::string RoomManager::_getRoomSnapshotPath(uint16_t roomId) {
+  std::string path = ROOM_MANAGER_SNAPSHOT_DIRECTORY;
+  path.append("/room_");
+  path.append(std::to_string(roomId));
+  path.append(".msgpack");
+  return path;
+}
+
+void RoomManager::_insertRoomInOrder(Room *room, std::vector<uint16_t> &roomIds) {
+  size_t roomIndex = std::find(roomIds.begin(), roomIds.end(), room->id) - roomIds.begin();
+  auto it = RoomManager::_nextModel->rooms.begin();
+  for (; it != RoomManager::_nextModel->rooms.end(); it++) {
+    size_t index = std::find(roomIds.begin(), roomIds.end(), (*it)->id) - roomIds.begin();
+    if (index > roomIndex) {
+      break;
+    }
+  }
+  RoomManager::_nextModel->rooms.insert(it, room);
+}
+
+Room *RoomManager::_processRoomConfig(Room *oldRoom, uint16_t roomId, JsonDocument *roomData, bool is_update) {
+  // Changes are made to a copy of the existing room, it shares the lights and scenes whose config has not changed
+  Room *newRoom = oldRoom != nullptr ? new Room(*oldRoom) : new Room();
+  newRoom->id = roomId;
+  newRoom->name = (*roomData)["name"] | "ERR";
+
+  // Load and init all lights for the room
+  std::unordered_set<uint16_t> json_light_ids;
+  JsonVariant json_lights = (*roomData)["lights"];
+  for (JsonPair lightPair : json_lights.as<JsonObject>()) {
+    uint16_t light_id = atoi(lightPair.key().c_str());
+    json_light_ids.insert(light_id);
+    Light *newLight = new Light();
+    newLight->initFromJson(light_id, lightPair.value().as<JsonObjectConst>());
+
+    // Published lights may be read at any time, a light whose config changed is replaced instead of updated
+    Light *existingLight = newRoom->getLightById(light_id);
+    if (existingLight != nullptr) {
+      if (existingLight->hasSameConfig(newLight)) {
+        delete newLight;
+        continue;
       }
+      newRoom->ceilingLights.erase(light_id);
+      newRoom->tableLights.erase(light_id);
+      RoomManager::_replacedLights.push_back(std::make_pair(existingLight, newLight));
     }
+    if (newLight->isCeiling()) {
+      newRoom->ceilingLights.insert(std::make_pair(newLight->getId(), newLight));
+    } else {
+      newRoom->tableLights.insert(std::make_pair(newLight->getId(), newLight));
+    }
+  }
 
-    for (auto it = newRoom->scenes.cbegin(); it != newRoom->scenes.cend();) {
-      // Check if this light ID exist in JSON config
-      bool light_id_found = false;
-      for (JsonPair jsonLightPair : json_lights.as<JsonObject>()) {
-        if (atoi(jsonLightPair.key().c_str()) == (*it)->getId()) {
-          light_id_found = true;
-          break;
+  std::unordered_set<uint16_t> json_scene_ids;
+  JsonVariant json_scenes = (*roomData)["scenes"];
+  for (JsonPair scenePair : json_scenes.as<JsonObject>()) {
+    json_scene_ids.insert(atoi(scenePair.key().c_str()));
+  }
+
+  if (is_update) {
+    // Remove lights and scenes no longer in the room config
+    for (std::unordered_map<uint16_t, Light *> *lights : {&newRoom->ceilingLights, &newRoom->tableLights}) {
+      for (auto it = lights->cbegin(); it != lights->cend();) {
+        if (json_light_ids.count((*it).first) == 0) {
+          Light *light_to_remove = (*it).second;
+          LOG_DEBUG("Removing light: ", light_to_remove->getName().c_str(), ". ID: ", light_to_remove->getId());
+          it = lights->erase(it);
+          RoomManager::_retiringObjects.lights.push_back(light_to_remove);
+        } else {
+          it++;
         }
       }
+    }
 
-      if (!light_id_found) {
+    for (auto it = newRoom->scenes.cbegin(); it != newRoom->scenes.cend();) {
+      if (json_scene_ids.count((*it)->getId()) == 0) {
         Scene *scene_to_remove = (*it);
         LOG_DEBUG("Removing scene: ", scene_to_remove->getName().c_str(), ". ID: ", scene_to_remove->getId());
         it = newRoom->scenes.erase(it);
-        scene_to_remove->callDeconstructCallbacks();
-        delete scene_to_remove;
+        RoomManager::_retiringObjects.scenes.push_back(scene_to_remove);
       } else {
         it++;
       }
@@ -362,72 +798,83 @@ Room *RoomManager::loadRoom(uint16_t roomId, bool is_update) {
   }
 
   // Load and init all the scenes for the room
-  JsonVariant json_scenes = (*roomData)["scenes"];
-  for (JsonPair scenePair : json_scenes.as<JsonObject>()) {
-    bool existing_scene;
-    Scene *newScene = newRoom->getSceneById(atoi(scenePair.key().c_str()));
-    if (newScene == nullptr) {
-      existing_scene = false;
-      newScene = new Scene();
-    } else {
-      existing_scene = true;
-    }
-    newScene->room = newRoom;
+  RoomManager::_processScenes(json_scenes.as<JsonObject>(), &newRoom->scenes);
+  return newRoom;
+}
+
+void RoomManager::_processScenes(JsonObject json_scenes, std::vector<Scene *> *scenes) {
+  for (JsonPair scenePair : json_scenes) {
+    Scene *newScene = new Scene();
     newScene->id = atoi(scenePair.key().c_str());
     newScene->name = scenePair.value()["name"] | "ERR-S";
     newScene->canSave = scenePair.value()["can_save"].as<String>().equals("true");
-    newScene->callUpdateCallbacks();
-    if (!existing_scene) {
-      newRoom->scenes.push_back(newScene);
+
+    // Published scenes may be read at any time, a scene whose config changed is replaced instead of updated
+    auto existingScene = std::find_if(scenes->begin(), scenes->end(), [newScene](Scene *scene) { return scene->id == newScene->id; });
+    if (existingScene == scenes->end()) {
+      scenes->push_back(newScene);
       LOG_TRACE("Loaded scene ", newScene->id, "::", newScene->name.c_str());
+    } else if ((*existingScene)->hasSameConfig(newScene)) {
+      delete newScene;
+    } else {
+      RoomManager::_replacedScenes.push_back(std::make_pair(*existingScene, newScene));
+      *existingScene = newScene;
     }
   }
-
-  delete roomData;
-  return newRoom;
 }
 
 void RoomManager::goToNextRoom() {
-  RoomManager::currentRoom++;
-  if (RoomManager::currentRoom == RoomManager::rooms.end()) {
-    RoomManager::currentRoom = RoomManager::rooms.begin();
+  portENTER_CRITICAL(&RoomManager::_modelMux);
+  RoomModel *model = RoomManager::_model;
+  int32_t currentRoomId = model->current_room_id;
+  auto it = std::find_if(model->rooms.begin(), model->rooms.end(), [currentRoomId](Room *room) { return room->id == currentRoomId; });
+  if (it != model->rooms.end()) {
+    it++;
+  }
+  if (it == model->rooms.end()) {
+    it = model->rooms.begin();
   }
+  model->current_room_id = it != model->rooms.end() ? (*it)->id : -1;
+  portEXIT_CRITICAL(&RoomManager::_modelMux);
   RoomManager::_callRoomChangeCallbacks();
 }
 
 void RoomManager::goToPreviousRoom() {
-  if (RoomManager::currentRoom == RoomManager::rooms.begin()) {
-    RoomManager::currentRoom = RoomManager::rooms.end();
-    RoomManager::currentRoom--;
-  } else {
-    RoomManager::currentRoom--;
+  portENTER_CRITICAL(&RoomManager::_modelMux);
+  RoomModel *model = RoomManager::_model;
+  int32_t currentRoomId = model->current_room_id;
+  auto it = std::find_if(model->rooms.begin(), model->rooms.end(), [currentRoomId](Room *room) { return room->id == currentRoomId; });
+  if (it == model->rooms.begin()) {
+    it = model->rooms.end();
+  }
+  if (it != model->rooms.begin()) {
+    it--;
   }
+  model->current_room_id = it != model->rooms.end() ? (*it)->id : -1;
+  portEXIT_CRITICAL(&RoomManager::_modelMux);
   RoomManager::_callRoomChangeCallbacks();
 }
 
 bool RoomManager::goToRoomId(uint16_t roomId) {
-  bool foundRoom = false;
-  for (std::list<Room *>::iterator it = RoomManager::rooms.begin(); it != RoomManager::rooms.end(); it++) {
-    if ((*it)->id == roomId) {
-      RoomManager::currentRoom = it;
-      RoomManager::_callRoomChangeCallbacks();
-      return true;
-    }
+  portENTER_CRITICAL(&RoomManager::_modelMux);
+  RoomModel *model = RoomManager::_model;
+  bool foundRoom = RoomManager::_findRoom(&model->rooms, roomId) != nullptr;
+  if (foundRoom) {
+    model->current_room_id = roomId;
   }
+  portEXIT_CRITICAL(&RoomManager::_modelMux);
 
-  LOG_ERROR("Did not find requested room. Will cancel operation.");
-  return false;
+  if (!foundRoom) {
+    LOG_ERROR("Did not find requested room. Will cancel operation.");
+    return false;
+  }
+  RoomManager::_callRoomChangeCallbacks();
+  return true;
 }
 
 Room *RoomManager::getRoomById(uint16_t roomId) {
-  bool foundRoom = false;
-  for (std::list<Room *>::iterator it = RoomManager::rooms.begin(); it != RoomManager::rooms.end(); it++) {
-    if ((*it)->id == roomId) {
-      return (*it);
-    }
-  }
-
-  return nullptr;
+  RoomModelSnapshot rooms;
+  return RoomManager::_findRoom(&rooms.rooms(), roomId);
 }
 
 void RoomManager::attachRoomChangeCallback(RoomManagerObserver *observer) {
@@ -439,17 +886,10 @@ void RoomManager::detachRoomChangeCallback(RoomManagerObserver *observer) {
 }
 
 void RoomManager::_callRoomChangeCallbacks() {
-  if (RoomManager::currentRoom != RoomManager::rooms.end()) {
+  RoomModelSnapshot rooms;
+  if (rooms.currentRoom() != nullptr) {
     for (RoomManagerObserver *observer : RoomManager::_roomChangeObservers) {
       observer->roomChangedCallback();
     }
   }
 }
-
-bool RoomManager::hasValidCurrentRoom() {
-  if (RoomManager::currentRoom == RoomManager::rooms.end()) {
-    LOG_ERROR("Current room is invalid iterator!");
-    return false;
-  }
-  return true;
-}
\ No newline at end of file
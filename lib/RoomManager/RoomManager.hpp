@@ -2,30 +2,191 @@
 #define ROOMMANAGER_HPP
 
 #include <Arduino.h>
+#include <ArduinoJson.h>
 #include <RoomManagerObserver.hpp>
+class Light;
 class Room;
+class Scene;
+#include <atomic>
 #include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Number of downloaded room configs that may wait to be processed while loading rooms
+#define ROOM_CONFIG_PREFETCH_DEPTH 2
+
+// Where the last loaded panel and room configs are kept to build the interface at boot before the manager can be reached
+#define ROOM_MANAGER_SNAPSHOT_DIRECTORY "/snapshot"
+#define ROOM_MANAGER_PANEL_SNAPSHOT_PATH ROOM_MANAGER_SNAPSHOT_DIRECTORY "/panel.msgpack"
+
+struct RoomConfigDownload {
+  uint16_t room_id;
+  /// @brief The ETag of the loaded room config when queued, the ETag of the downloaded config when received
+  std::string etag;
+  /// @brief The downloaded room config, empty if not modified
+  JsonDocument *document = nullptr;
+  /// @brief False if the manager responded that the room config has not changed, or if there was no snapshot for the room
+  bool modified = false;
+};
+
+/// @brief The room configs for _taskPrefetchRoomConfigs to download, owned by the task
+struct RoomConfigPrefetch {
+  /// @brief The rooms to download, in the order they are downloaded. Each is handed over to the loading task through the queue.
+  std::vector<RoomConfigDownload *> downloads;
+  /// @brief Read the room configs from the snapshot instead of downloading them
+  bool from_snapshot;
+};
+
+/// @brief Rooms, lights and scenes removed from the config, deleted together with the last model that contains them
+struct RetiredRoomObjects {
+  std::vector<Room *> rooms;
+  std::vector<Light *> lights;
+  std::vector<Scene *> scenes;
+};
+
+/// @brief A published set of rooms and global scenes. Neither the model nor the rooms, lights and scenes in it are modified once published,
+/// @brief except for the live light state and the current room. A reload builds new rooms, lights and scenes for everything whose config
+/// @brief changed. Readers hold it through a RoomModelSnapshot. A replaced model is deleted once neither it nor any model published before
+/// @brief it has readers left.
+struct RoomModel {
+  std::list<Room *> rooms;
+  std::vector<Scene *> global_scenes;
+  /// @brief ID of the room shown on the panel, -1 if none. Resolve it against rooms of the same model.
+  std::atomic<int32_t> current_room_id{-1};
+  /// @brief Number of snapshots holding this model, guarded by RoomManager::_modelMux
+  uint32_t readers = 0;
+  /// @brief True once replaced by a newer model, guarded by RoomManager::_modelMux
+  bool retired = false;
+  /// @brief Removed by the reload that replaced this model
+  RetiredRoomObjects retired_objects;
+  /// @brief The next newer model waiting to be deleted, guarded by RoomManager::_modelMux
+  RoomModel *next_retired = nullptr;
+};
+
+/// @brief A reference to the published room model. The model and all rooms, lights and scenes in it stay valid while the snapshot exists,
+/// @brief keep it for as long as any of them are used.
+class RoomModelSnapshot {
+public:
+  RoomModelSnapshot();
+  ~RoomModelSnapshot();
+  RoomModelSnapshot(const RoomModelSnapshot &) = delete;
+  RoomModelSnapshot &operator=(const RoomModelSnapshot &) = delete;
+  const std::list<Room *> &rooms();
+  const std::vector<Scene *> &globalScenes();
+  /// @brief The room shown on the panel as of this snapshot, nullptr if none
+  Room *currentRoom();
+
+private:
+  RoomModel *_model;
+};
 
 class RoomManager {
 public:
   static void init();
   static void performConfigReload();
-  static inline std::list<Room *> rooms;
-  static inline std::list<Room *>::iterator currentRoom;
-  static void loadAllRooms(bool is_update);
-  static Room *loadRoom(uint16_t roomId, bool is_update);
+  /// @brief Load or update the panel config and all rooms from the manager
+  /// @param is_update True if reloading an already loaded config
+  /// @param homeRoomLoadedCallback Called as soon as the home room is loaded when not updating, before the rest of the rooms are loaded
+  static void loadAllRooms(bool is_update, void (*homeRoomLoadedCallback)() = nullptr);
+  /// @brief Load the panel config and all rooms from the snapshot saved the last time the config was downloaded. Call loadAllRooms(true) once
+  /// @brief the manager can be reached to apply any changes made since.
+  /// @param homeRoomLoadedCallback Called as soon as the home room is loaded, before the rest of the rooms are loaded
+  /// @return True if a snapshot was found and loaded
+  static bool loadAllRoomsFromSnapshot(void (*homeRoomLoadedCallback)() = nullptr);
+  /// @brief Load or update a room from the manager
+  /// @param roomId The room to load
+  /// @param is_update Only download the room config if it has changed since it was last loaded
+  /// @param modified Set to false if the room config had not changed and the room was left as is
+  static Room *loadRoom(uint16_t roomId, bool is_update, bool *modified = nullptr);
+  /// @brief Publish an empty model, the loaded rooms are deleted once no snapshot holds them
+  static void unloadAllRooms();
   static void goToNextRoom();
   static void goToPreviousRoom();
   static bool goToRoomId(uint16_t id);
-  static bool hasValidCurrentRoom();
   static void attachRoomChangeCallback(RoomManagerObserver *observer);
   static void detachRoomChangeCallback(RoomManagerObserver *observer);
+  /// @brief Find a room in the published model. Hold a RoomModelSnapshot while using the returned room.
   static Room *getRoomById(uint16_t room_id);
 
 private:
+  friend class RoomModelSnapshot;
   static inline std::list<RoomManagerObserver *> _roomChangeObservers;
   static inline unsigned long _lastReloadCommand;
+  /// @brief ETag of the last loaded panel config
+  static inline std::string _panelConfigETag;
+  /// @brief True if the last loaded panel config listed room_versions, loaded rooms are then only checked when the panel config changes
+  static inline bool _panelConfigHasRoomVersions = false;
+  /// @brief ETag of the last loaded config for each room, by room ID
+  static inline std::map<uint16_t, std::string> _roomConfigETags;
+  /// @brief Version of the last loaded config for each room, by room ID, as given in room_versions in the panel config
+  static inline std::unordered_map<uint16_t, uint32_t> _roomConfigVersions;
   static void _callRoomChangeCallbacks();
+  /// @brief Download a room config, retrying until successful
+  static void _downloadRoomConfig(uint16_t roomId, JsonDocument *roomData, std::string *etag, bool *modified);
+  /// @brief Create a room from a downloaded room config
+  /// @param oldRoom The loaded room to copy and update or nullptr to create a new room. Lights and scenes with an unchanged config are shared
+  /// @param oldRoom with the old room, changed ones are replaced and removed ones are retired.
+  static Room *_processRoomConfig(Room *oldRoom, uint16_t roomId, JsonDocument *roomData, bool is_update);
+  /// @brief Add or replace the scenes in a scene config, keeping the scenes whose config has not changed
+  /// @param scenes The scenes of the room or the global scenes being built, removed scenes must already be retired
+  static void _processScenes(JsonObject json_scenes, std::vector<Scene *> *scenes);
+  /// @brief Process a room config and replace or insert the room in _nextModel
+  /// @param roomOrder Room IDs in the order of the panel config, new rooms are appended if nullptr
+  static Room *_applyRoomConfig(uint16_t roomId, JsonDocument *roomData, bool is_update, std::vector<uint16_t> *roomOrder);
+  /// @brief Load the given rooms, the next rooms are downloaded while the previous is processed. The home room is loaded first.
+  /// @return True if any room config had changed
+  /// @param roomVersions The room_versions object from the panel config, loaded rooms with the same version as last loaded are skipped
+  static bool _loadRooms(std::vector<uint16_t> &roomIds, JsonObjectConst roomVersions, bool is_update, void (*homeRoomLoadedCallback)(), bool from_snapshot);
+  /// @brief Retire a room and all its lights and scenes. The room must already be removed from _nextModel.
+  static void _retireRoom(Room *room);
+  /// @brief Apply a panel config and load all the rooms in it
+  static void _processPanelConfig(JsonDocument *roomData, bool is_update, void (*homeRoomLoadedCallback)(), bool from_snapshot);
+  /// @brief Read a config snapshot saved with _saveConfigSnapshot
+  /// @param path The snapshot file
+  /// @param document The document to deserialize into
+  /// @param etag Set to the ETag of the config in the snapshot
+  /// @return True if the snapshot was read
+  static bool _readConfigSnapshot(const char *path, JsonDocument *document, std::string *etag);
+  /// @brief Save a downloaded config as MessagePack, prefixed with the ETag on its own line
+  static void _saveConfigSnapshot(const char *path, JsonDocument *document, std::string &etag);
+  static std::string _getRoomSnapshotPath(uint16_t roomId);
+  /// @brief Task that downloads the room configs to _roomConfigQueue
+  /// @param param A RoomConfigPrefetch, deleted by the task
+  static void _taskPrefetchRoomConfigs(void *param);
+  /// @brief Insert a new room in _nextModel in the same order as in the panel config
+  static void _insertRoomInOrder(Room *room, std::vector<uint16_t> &roomIds);
+  /// @brief Downloaded room configs waiting to be processed
+  static inline QueueHandle_t _roomConfigQueue = NULL;
+  /// @brief Given by _taskPrefetchRoomConfigs when it is done with _roomConfigQueue
+  static inline SemaphoreHandle_t _roomConfigPrefetchDone = NULL;
+  /// @brief The published model, only replaced by _publishModel. Guarded by _modelMux.
+  static inline RoomModel *_model = new RoomModel();
+  /// @brief Guards the published model pointer, the reader counts and the retired models
+  static inline portMUX_TYPE _modelMux = portMUX_INITIALIZER_UNLOCKED;
+  /// @brief The model being built by a reload, not yet visible to readers. nullptr when no reload is in progress.
+  static inline RoomModel *_nextModel = nullptr;
+  /// @brief Rooms, lights and scenes removed by the reload in progress
+  static inline RetiredRoomObjects _retiringObjects;
+  /// @brief Lights replaced by the reload in progress because their config changed, as (replaced, replacement)
+  static inline std::vector<std::pair<Light *, Light *>> _replacedLights;
+  /// @brief Scenes replaced by the reload in progress because their config changed, as (replaced, replacement)
+  static inline std::vector<std::pair<Scene *, Scene *>> _replacedScenes;
+  /// @brief Replaced models waiting for their readers to finish, oldest first
+  static inline RoomModel *_oldestRetiredModel = nullptr;
+  static inline RoomModel *_newestRetiredModel = nullptr;
+  static RoomModel *_acquireModel();
+  static void _releaseModel(RoomModel *model);
+  static Room *_findRoom(const std::list<Room *> *rooms, uint16_t roomId);
+  /// @brief Start building a new model from a copy of the published one, if not already started
+  static void _beginModelUpdate();
+  /// @brief Swap in the model built since _beginModelUpdate and retire the old model. Replacement lights and scenes take over the state and
+  /// @brief observers of the ones they replace.
+  static void _publishModel();
+  /// @brief Delete the oldest retired models that have no readers left
+  static void _reclaimRetiredModels();
 };
 
 #endif
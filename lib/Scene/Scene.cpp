@@ -2,6 +2,7 @@
 #include <MqttLog.hpp>
 #include <Room.hpp>
 #include <Scene.hpp>
+#include <algorithm>
 
 uint16_t Scene::getId() {
   return this->id;
@@ -11,6 +12,23 @@ std::string Scene::getName() {
   return this->name;
 }
 
+bool Scene::hasSameConfig(Scene *other) {
+  return this->id == other->id && this->name == other->name && this->canSave == other->canSave;
+}
+
+std::list<DeviceEntityObserver *> Scene::takeOver(Scene *replaced) {
+  this->_updateObservers.swap(replaced->_updateObservers);
+  this->_deconstructObservers.swap(replaced->_deconstructObservers);
+
+  std::list<DeviceEntityObserver *> observers = this->_deconstructObservers;
+  for (DeviceEntityObserver *observer : this->_updateObservers) {
+    if (std::find(observers.begin(), observers.end(), observer) == observers.end()) {
+      observers.push_back(observer);
+    }
+  }
+  return observers;
+}
+
 void Scene::activate() {
   LOG_INFO("Activating scene: ", this->id, "::", this->name.c_str());
   JsonDocument doc;
@@ -54,9 +72,15 @@ void Scene::detachDeconstructCallback(DeviceEntityObserver *observer) {
 }
 
 void Scene::callDeconstructCallbacks() {
-  for (DeviceEntityObserver *observer : this->_deconstructObservers) {
-    observer->entityDeconstructCallback(this);
-  }
+  std::list<DeviceEntity *> entities = {this};
+  DeviceEntity::callDeconstructCallbacks(entities);
+}
+
+std::list<DeviceEntityObserver *> Scene::detachAllObservers() {
+  std::list<DeviceEntityObserver *> observers;
+  observers.swap(this->_deconstructObservers);
+  this->_updateObservers.clear();
+  return observers;
 }
 
 void Scene::attachUpdateCallback(DeviceEntityObserver *observer) {
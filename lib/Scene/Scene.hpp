@@ -2,25 +2,30 @@
 #define SCENE_HPP
 
 #include <Arduino.h>
-class Room; // Defined in Room.hpp
 #include <DeviceEntity.hpp>
 
 class Scene : public DeviceEntity {
 public:
   uint16_t id = 0;
   std::string name;
-  Room *room = nullptr;
-  bool canSave;
+  bool canSave = false;
 
   void save();
   void activate();
   uint16_t getId();
   std::string getName();
+  /// @brief True if both scenes were set up from the same config entry. Published scenes are never modified, a scene whose config changed is
+  /// @brief replaced by a new scene.
+  bool hasSameConfig(Scene *other);
+  /// @brief Move the observers of the scene this scene replaces to this scene
+  /// @return The observers that were moved
+  std::list<DeviceEntityObserver *> takeOver(Scene *replaced);
 
   DeviceEntityType getType();
   void attachDeconstructCallback(DeviceEntityObserver *callback);
   void detachDeconstructCallback(DeviceEntityObserver *callback);
   void callDeconstructCallbacks();
+  std::list<DeviceEntityObserver *> detachAllObservers();
 
   void attachUpdateCallback(DeviceEntityObserver *callback);
   void detachUpdateCallback(DeviceEntityObserver *callback);
@@ -1,17 +1,29 @@
 #include <Arduino.h>
+#include <BootProfiler.hpp>
+#include <ChunkDownloader.hpp>
+#include <DeltaPatch.hpp>
+#include <HeatshrinkDownloader.hpp>
 #include <HTTPClient.h>
+#include <HttpClientPool.hpp>
 #include <HttpLib.hpp>
 #include <InterfaceManager.hpp>
 #include <LightManager.hpp>
 #include <LittleFS.h>
+#include <ManagerDiscovery.hpp>
 #include <MqttLog.hpp>
 #include <NSPMConfig.h>
 #include <NSPanel.hpp>
 #include <PageManager.hpp>
+#include <RoomManager.hpp>
 #include <Update.h>
 #include <WebManager.hpp>
 #include <WiFi.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
 #include <list>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 // Make space for variables in memory
 WebManager *WebManager::instance;
@@ -33,6 +45,13 @@ void WebManager::init(const char *nspmFirmwareVersion) {
   this->_server.on("/factory_reset", HTTP_GET, WebManager::factoryReset);
   this->_server.on("/do_reboot", HTTP_GET, WebManager::doRebootNow);
   this->_server.on("/available_wifi_networks", HTTP_GET, WebManager::respondAvailableWiFiNetworks);
+  this->_server.on("/upload_firmware", HTTP_POST, WebManager::_handleImageUploadFinished, WebManager::_handleImageUpload);
+  this->_server.on("/upload_littlefs", HTTP_POST, WebManager::_handleImageUploadFinished, WebManager::_handleImageUpload);
+  this->_server.on("/prepare_tft_upload", HTTP_GET, WebManager::_prepareTFTUpload);
+  this->_server.on("/tft_upload_status", HTTP_GET, WebManager::_respondTFTUploadStatus);
+  this->_server.on("/upload_tft", HTTP_POST, WebManager::_handleTFTUploadFinished, NULL, WebManager::_handleTFTUpload);
+  this->_server.on("/boot_timeline", HTTP_GET, WebManager::_respondBootTimeline);
+  this->_server.on("/export_config", HTTP_GET, WebManager::_respondExportConfig);
 
   this->_server.onNotFound([](AsyncWebServerRequest *request) { request->send(404, "text/plain", "Path/File not found!"); });
 
@@ -76,6 +95,26 @@ String WebManager::processIndexTemplate(const String &templateVar) {
 void WebManager::saveConfigFromWeb(AsyncWebServerRequest *request) {
   JsonDocument config_json;
 
+  // Values that do not fit the saved config record would be truncated, reject them instead
+  struct {
+    const char *arg;
+    size_t max_length;
+  } text_fields[] = {
+      {"wifi_hostname", sizeof(NSPMConfigRecord::wifi_hostname) - 1},
+      {"wifi_ssid", sizeof(NSPMConfigRecord::wifi_ssid) - 1},
+      {"wifi_psk", sizeof(NSPMConfigRecord::wifi_psk) - 1},
+      {"mqtt_server", sizeof(NSPMConfigRecord::mqtt_server) - 1},
+      {"mqtt_username", sizeof(NSPMConfigRecord::mqtt_username) - 1},
+      {"mqtt_psk", sizeof(NSPMConfigRecord::mqtt_password) - 1},
+  };
+  for (auto &field : text_fields) {
+    if (request->arg(field.arg).length() > field.max_length) {
+      LOG_ERROR("Not saving configuration, ", field.arg, " is longer than ", field.max_length, " characters.");
+      request->send(400, "text/plain", String(field.arg) + " can be at most " + String(field.max_length) + " characters long.");
+      return;
+    }
+  }
+
   NSPMConfig::instance->wifi_hostname = request->arg("wifi_hostname").c_str();
   NSPMConfig::instance->wifi_ssid = request->arg("wifi_ssid").c_str();
   NSPMConfig::instance->wifi_psk = request->arg("wifi_psk").c_str();
@@ -87,7 +126,12 @@ void WebManager::saveConfigFromWeb(AsyncWebServerRequest *request) {
   NSPMConfig::instance->mqtt_username = request->arg("mqtt_username").c_str();
   NSPMConfig::instance->mqtt_password = request->arg("mqtt_psk").c_str();
 
-  NSPMConfig::instance->tft_upload_baud = request->arg("upload_buad_rate").toInt();
+  uint32_t tft_upload_baud = request->arg("upload_buad_rate").toInt();
+  if (tft_upload_baud == 0 && NSPMConfig::instance->tft_upload_baud != 0) {
+    // Switched back to auto, probe from the fastest baud rate again on the next TFT update
+    NSPMConfig::instance->tft_auto_upload_baud = 0;
+  }
+  NSPMConfig::instance->tft_upload_baud = tft_upload_baud;
   NSPMConfig::instance->use_new_upload_protocol = request->arg("upload_protocol") == "latest";
 
   if (!NSPMConfig::instance->saveToLittleFS(false)) {
@@ -163,6 +207,181 @@ void WebManager::respondAvailableWiFiNetworks(AsyncWebServerRequest *request) {
   json = String();
 }
 
+void WebManager::_handleImageUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) {
+  uint8_t type = request->url() == "/upload_littlefs" ? U_SPIFFS : U_FLASH;
+  if (index == 0) {
+    if (WebManager::_state != WebManagerState::ONLINE || NSPanel::instance->getUpdateState()) {
+      LOG_ERROR("Ignoring uploaded file, an update is already in progress.");
+      WebManager::_upload_rejected = true;
+      return;
+    }
+    LOG_INFO("Receiving ", type == U_FLASH ? "firmware" : "LittleFS", " upload '", filename.c_str(), "'.");
+    WebManager::_upload_rejected = false;
+    WebManager::_upload_failed = false;
+    WebManager::_update_progress = 0;
+    WebManager::_state = type == U_FLASH ? WebManagerState::UPDATING_FIRMWARE : WebManagerState::UPDATING_LITTLEFS;
+    InterfaceManager::stop();
+    LightManager::stop();
+    PageManager::GetScreensaverPage()->stop();
+    PageManager::GetNSPanelManagerPage()->setText("Updating...");
+    PageManager::GetNSPanelManagerPage()->show();
+
+    // The multipart body is larger than the file, so the exact size is passed as a parameter if known.
+    size_t size = request->hasParam("size") ? request->getParam("size")->value().toInt() : UPDATE_SIZE_UNKNOWN;
+    Update.onProgress(WebManager::_onProgress);
+    if (!Update.begin(size, type)) {
+      LOG_ERROR("Could not start update! Error #: ", Update.getError());
+      WebManager::_upload_failed = true;
+      return;
+    }
+  }
+
+  if (WebManager::_upload_rejected || WebManager::_upload_failed) {
+    return;
+  }
+  if (Update.write(data, len) != len) {
+    LOG_ERROR("Failed to write uploaded data. Error #: ", Update.getError());
+    WebManager::_upload_failed = true;
+    Update.abort();
+    return;
+  }
+  if (final) {
+    if (!Update.end(true)) {
+      LOG_ERROR("Update failed #:", Update.getError());
+      WebManager::_upload_failed = true;
+    } else {
+      LOG_INFO("Uploaded ", index + len, " bytes, OTA Successful!");
+    }
+  }
+}
+
+void WebManager::_handleImageUploadFinished(AsyncWebServerRequest *request) {
+  if (WebManager::_upload_rejected) {
+    WebManager::_upload_rejected = false;
+    request->send(409, "text/plain", "An update is already in progress.");
+    return;
+  } else if (WebManager::_upload_failed || !Update.isFinished()) {
+    request->send(500, "text/plain", "Update failed!");
+    PageManager::GetNSPanelManagerPage()->setText("Update failed!");
+  } else {
+    request->send(200, "text/plain", "OK");
+    PageManager::GetNSPanelManagerPage()->setText("Restarting...");
+  }
+  // Even a failed LittleFS upload may have overwritten the config file, so it is always written back
+  uint32_t type = request->url() == "/upload_littlefs" ? U_SPIFFS : U_FLASH;
+  xTaskCreatePinnedToCore(WebManager::_taskRestartAfterUpload, "taskRestartAfterUpload", 5000, (void *)type, 1, NULL, CONFIG_ARDUINO_RUNNING_CORE);
+}
+
+void WebManager::_taskRestartAfterUpload(void *param) {
+  vTaskDelay(2000 / portTICK_PERIOD_MS);
+  if ((uint32_t)param == U_SPIFFS) {
+    // The new LittleFS image replaced the config file, write back the running config.
+    NSPMConfig::instance->saveToLittleFS(true);
+  }
+  ESP.restart();
+  vTaskDelete(NULL);
+}
+
+void WebManager::_prepareTFTUpload(AsyncWebServerRequest *request) {
+  size_t size = request->hasParam("size") ? request->getParam("size")->value().toInt() : 0;
+  if (size == 0) {
+    request->send(400, "text/plain", "Missing size.");
+    return;
+  }
+  if (WebManager::_state != WebManagerState::ONLINE || !NSPanel::instance->startTFTUploadFromStream(size)) {
+    request->send(409, "text/plain", "An update is already in progress.");
+    return;
+  }
+  WebManager::_tft_upload_offset = 0;
+  request->send(200, "text/plain", "OK");
+}
+
+void WebManager::_respondTFTUploadStatus(AsyncWebServerRequest *request) {
+  JsonDocument status;
+  status["ready"] = NSPanel::instance->isReadyForTFTUploadData();
+  status["failed"] = NSPanel::instance->hasTFTUploadFailed();
+  status["progress"] = NSPanel::instance->getUpdateProgress();
+  status["chunk_size"] = TFT_STREAM_UPLOAD_CHUNK_SIZE;
+  String response;
+  serializeJson(status, response);
+  request->send(200, "application/json", response);
+}
+
+void WebManager::_respondBootTimeline(AsyncWebServerRequest *request) {
+  JsonDocument timeline;
+  JsonObject timelineObject = timeline.to<JsonObject>();
+  timelineObject["version"] = WebManager::instance->_nspmFirmwareVersion.c_str();
+  BootProfiler::toJson(timelineObject);
+  String response;
+  serializeJson(timeline, response);
+  request->send(200, "application/json", response);
+}
+
+void WebManager::_respondExportConfig(AsyncWebServerRequest *request) {
+  JsonDocument config;
+  NSPMConfig::instance->toJson(config);
+  String response;
+  serializeJson(config, response);
+  AsyncWebServerResponse *webResponse = request->beginResponse(200, "application/json", response);
+  webResponse->addHeader("Content-Disposition", "attachment; filename=\"nspanel_config.json\"");
+  request->send(webResponse);
+}
+
+void WebManager::_handleTFTUpload(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  if (index == 0) {
+    size_t offset = request->hasParam("offset") ? request->getParam("offset")->value().toInt() : 0;
+    if (!NSPanel::instance->isReadyForTFTUploadData() || NSPanel::instance->hasTFTUploadFailed()) {
+      WebManager::_tft_upload_part_status = 409;
+    } else if (offset + total <= WebManager::_tft_upload_offset) {
+      // Posted again because the answer was lost, the part has already been passed on
+      WebManager::_tft_upload_part_status = 208;
+    } else if (offset != WebManager::_tft_upload_offset || total > TFT_STREAM_UPLOAD_CHUNK_SIZE) {
+      WebManager::_tft_upload_part_status = 400;
+    } else if (NSPanel::instance->getTFTUploadSpaceAvailable() < total) {
+      // Only the web server writes to the buffer, so once the whole part fits every piece of it below is accepted without waiting
+      WebManager::_tft_upload_part_status = 503;
+    } else {
+      WebManager::_tft_upload_part_status = 200;
+    }
+  }
+
+  if (WebManager::_tft_upload_part_status != 200) {
+    return;
+  }
+  if (!NSPanel::instance->writeTFTUploadData(data, len)) {
+    WebManager::_tft_upload_part_status = 500;
+    return;
+  }
+  if (index + len == total) {
+    WebManager::_tft_upload_offset += total;
+  }
+}
+
+void WebManager::_handleTFTUploadFinished(AsyncWebServerRequest *request) {
+  if (request->contentLength() == 0) {
+    request->send(400, "text/plain", "Missing TFT data.");
+    return;
+  }
+  switch (WebManager::_tft_upload_part_status) {
+  case 200:
+  case 208:
+    request->send(200, "text/plain", "OK");
+    break;
+  case 503:
+    request->send(503, "text/plain", "Panel busy, try again.");
+    break;
+  case 409:
+    request->send(409, "text/plain", "The panel is not ready for TFT data.");
+    break;
+  case 400:
+    request->send(400, "text/plain", "Unexpected TFT data offset or size.");
+    break;
+  default:
+    request->send(500, "text/plain", "TFT upload failed!");
+    break;
+  }
+}
+
 void WebManager::startOTAUpdate() {
   // TODO: Move function to InterfaceManager
   BaseType_t result = xTaskCreatePinnedToCore(WebManager::_taskPerformOTAUpdate, "taskPerformOTAUpdate", 10000, NULL, 1, NULL, CONFIG_ARDUINO_RUNNING_CORE);
@@ -171,32 +390,79 @@ void WebManager::startOTAUpdate() {
   }
 }
 
-void WebManager::_taskPerformOTAUpdate(void *param) {
-  PageManager::GetNSPanelManagerPage()->setText("Updating...");
-  PageManager::GetNSPanelManagerPage()->show();
+void WebManager::startCombinedUpdate() {
+  // Any non-NULL parameter makes the update task include the TFT
+  BaseType_t result = xTaskCreatePinnedToCore(WebManager::_taskPerformOTAUpdate, "taskPerformOTAUpdate", 10000, (void *)1, 1, NULL, CONFIG_ARDUINO_RUNNING_CORE);
+  if (result != pdPASS) {
+    LOG_ERROR("Failed to create task to perform combined update. Error: ", result);
+  }
+}
 
-  char checksum_holder[33];
+void WebManager::_getChecksum(const char *path, char *buffer) {
   while (true) {
-    std::string checksumUrl = "http://";
-    checksumUrl.append(NSPMConfig::instance->manager_address);
-    checksumUrl.append(":");
-    checksumUrl.append(std::to_string(NSPMConfig::instance->manager_port));
-    checksumUrl.append("/checksum_firmware");
-    if (HttpLib::GetMD5sum(checksumUrl.c_str(), checksum_holder)) {
+    std::string checksumUrl = ManagerDiscovery::getManagerUrl();
+    checksumUrl.append(path);
+    if (HttpLib::GetMD5sum(checksumUrl.c_str(), buffer)) {
       break;
     }
     vTaskDelay(1000 / portTICK_PERIOD_MS);
   }
-  LOG_DEBUG("Got firmware MD5 ", checksum_holder);
+}
+
+bool WebManager::_getUpdateManifest(char *firmware_md5, char *data_file_md5, char *tft_md5) {
+  std::string manifestUrl = ManagerDiscovery::getManagerUrl();
+  manifestUrl.append("/update_manifest");
+
+  JsonDocument manifest;
+  if (!HttpLib::DownloadJSON(manifestUrl.c_str(), &manifest)) {
+    return false;
+  }
+  const char *firmware = manifest["firmware"] | "";
+  const char *data_file = manifest["data_file"] | "";
+  if (strlen(firmware) != 32 || strlen(data_file) != 32) {
+    LOG_ERROR("Update manifest is missing checksums.");
+    return false;
+  }
+  if (tft_md5 != nullptr) {
+    const char *tft = NSPMConfig::instance->is_us_panel ? (manifest["tft_us"] | "") : (manifest["tft_eu"] | "");
+    if (strlen(tft) != 32) {
+      LOG_ERROR("Update manifest is missing the TFT checksum.");
+      return false;
+    }
+    strncpy(tft_md5, tft, 33);
+  }
+  strncpy(firmware_md5, firmware, 33);
+  strncpy(data_file_md5, data_file, 33);
+  return true;
+}
+
+void WebManager::_taskPerformOTAUpdate(void *param) {
+  bool include_tft = param != NULL;
+  PageManager::GetNSPanelManagerPage()->setText("Updating...");
+  PageManager::GetNSPanelManagerPage()->show();
+
+  // Get all checksums in one request if the manager supports it
+  char firmware_md5[33];
+  char data_file_md5[33];
+  char tft_md5[33];
+  if (!WebManager::_getUpdateManifest(firmware_md5, data_file_md5, include_tft ? tft_md5 : nullptr)) {
+    LOG_INFO("No update manifest available, will get checksums one by one.");
+    WebManager::_getChecksum("/checksum_firmware", firmware_md5);
+    WebManager::_getChecksum("/checksum_data_file", data_file_md5);
+    if (include_tft) {
+      WebManager::_getChecksum(NSPMConfig::instance->is_us_panel ? "/checksum_tft_file_us" : "/checksum_tft_file_eu", tft_md5);
+    }
+  }
+  LOG_DEBUG("Got firmware MD5 ", firmware_md5);
   LOG_DEBUG("Stored firmware MD5 ", NSPMConfig::instance->md5_firmware.c_str());
 
   bool hasAnythingUpdated = false;
   bool firmwareUpdateSuccessful = true;
   yield();
   vTaskDelay(250 / portTICK_PERIOD_MS); // Wait for other tasks.
-  if (NSPMConfig::instance->md5_firmware.compare(checksum_holder) != 0) {
+  if (NSPMConfig::instance->md5_firmware.compare(firmware_md5) != 0) {
     do {
-      firmwareUpdateSuccessful = WebManager::_update(U_FLASH, "/download_firmware");
+      firmwareUpdateSuccessful = WebManager::_update(U_FLASH, "/download_firmware", firmware_md5);
       if (!firmwareUpdateSuccessful) {
         LOG_ERROR("Failed to run OTA. Will try again in 5 seconds.");
         vTaskDelay(5000 / portTICK_PERIOD_MS);
@@ -205,7 +471,7 @@ void WebManager::_taskPerformOTAUpdate(void *param) {
     if (firmwareUpdateSuccessful) {
       LOG_INFO("Successfully updated firmware.");
       // Save new firmware checksum
-      NSPMConfig::instance->md5_firmware = checksum_holder;
+      NSPMConfig::instance->md5_firmware = firmware_md5;
       hasAnythingUpdated = true;
     } else {
       LOG_ERROR("Something went wrong during firmware upgrade.");
@@ -217,35 +483,27 @@ void WebManager::_taskPerformOTAUpdate(void *param) {
 
   if (firmwareUpdateSuccessful) {
     LOG_INFO("Firmware update done without errors, will check LittleFS.");
-    while (true) {
-      std::string checksumUrl = "http://";
-      checksumUrl.append(NSPMConfig::instance->manager_address);
-      checksumUrl.append(":");
-      checksumUrl.append(std::to_string(NSPMConfig::instance->manager_port));
-      checksumUrl.append("/checksum_data_file");
-      if (HttpLib::GetMD5sum(checksumUrl.c_str(), checksum_holder)) {
-        break;
-      }
-      vTaskDelay(1000 / portTICK_PERIOD_MS);
-    }
-    LOG_DEBUG("Got LittleFS MD5 ", checksum_holder);
+    LOG_DEBUG("Got LittleFS MD5 ", data_file_md5);
     LOG_DEBUG("Stored LittleFS MD5 ", NSPMConfig::instance->md5_data_file.c_str());
     vTaskDelay(250 / portTICK_PERIOD_MS); // Wait for other tasks.
-    if (NSPMConfig::instance->md5_data_file.compare(checksum_holder) != 0) {
+    if (NSPMConfig::instance->md5_data_file.compare(data_file_md5) != 0) {
       LOG_INFO("Will update LittleFS.");
       vTaskDelay(250 / portTICK_PERIOD_MS);
-      bool littleFSUpdateSuccessful = false;
-      do {
-        littleFSUpdateSuccessful = WebManager::_update(U_SPIFFS, "/download_data_file");
+      bool littleFSUpdateSuccessful = WebManager::_syncLittleFSFromManifest();
+      if (!littleFSUpdateSuccessful) {
+        LOG_INFO("File sync not possible, will download full LittleFS image.");
+      }
+      while (!littleFSUpdateSuccessful) {
+        littleFSUpdateSuccessful = WebManager::_update(U_SPIFFS, "/download_data_file", data_file_md5);
         if (!littleFSUpdateSuccessful) {
           LOG_ERROR("Failed to run OTA. Will try again in 5 seconds.");
           vTaskDelay(5000 / portTICK_PERIOD_MS);
         }
-      } while (!littleFSUpdateSuccessful);
+      }
       if (littleFSUpdateSuccessful) {
         LOG_INFO("Successfully updated LittleFS.");
         // Save new LittleFS checksum
-        NSPMConfig::instance->md5_data_file = checksum_holder;
+        NSPMConfig::instance->md5_data_file = data_file_md5;
         hasAnythingUpdated = true;
       } else {
         LOG_ERROR("Something went wrong during LittleFS upgrade.");
@@ -256,6 +514,19 @@ void WebManager::_taskPerformOTAUpdate(void *param) {
     }
   }
 
+  if (include_tft) {
+    LOG_DEBUG("Got TFT MD5 ", tft_md5);
+    LOG_DEBUG("Stored TFT MD5 ", NSPMConfig::instance->md5_tft_file.c_str());
+    if (NSPMConfig::instance->md5_tft_file.compare(tft_md5) != 0) {
+      LOG_INFO("Will update TFT.");
+      InterfaceManager::stop();
+      NSPanel::instance->updateTFT();
+      hasAnythingUpdated = true;
+    } else {
+      LOG_INFO("TFT is the same, will not update.");
+    }
+  }
+
   PageManager::GetNSPanelManagerPage()->setText("Restarting...");
   LOG_INFO("Will restart in 5 seconds.");
   vTaskDelay(5000 / portTICK_PERIOD_MS);
@@ -283,17 +554,18 @@ uint8_t WebManager::getUpdateProgress() {
   return WebManager::_update_progress;
 }
 
-bool WebManager::_update(uint8_t type, const char *url) {
+uint32_t WebManager::getUpdateThroughput() {
+  return WebManager::_update_throughput;
+}
+
+bool WebManager::_update(uint8_t type, const char *url, const char *md5) {
   LOG_INFO("Starting ", type == U_FLASH ? "Firmware" : "LittleFS", " OTA update...");
   vTaskDelay(250 / portTICK_PERIOD_MS);
   InterfaceManager::stop();
   LightManager::stop();
   PageManager::GetScreensaverPage()->stop();
   WebManager::_update_progress = 0;
-  std::string downloadUrl = "http://";
-  downloadUrl.append(NSPMConfig::instance->manager_address);
-  downloadUrl.append(":");
-  downloadUrl.append(std::to_string(NSPMConfig::instance->manager_port));
+  std::string downloadUrl = ManagerDiscovery::getManagerUrl();
   downloadUrl.append(url);
   if (type == U_FLASH) {
     WebManager::_state = WebManagerState::UPDATING_FIRMWARE;
@@ -301,28 +573,83 @@ bool WebManager::_update(uint8_t type, const char *url) {
     WebManager::_state = WebManagerState::UPDATING_LITTLEFS;
   }
 
+  Update.onProgress(WebManager::_onProgress);
+  if (type == U_FLASH && md5 != nullptr) {
+    if (WebManager::_updateFromDelta(md5)) {
+      WebManager::_update_progress = 100;
+      return true;
+    }
+    LOG_INFO("Delta update not possible, will download full firmware.");
+  }
+
+  if (WebManager::_updateFromCompressed(type, downloadUrl, md5)) {
+    WebManager::_update_progress = 100;
+    return true;
+  }
+
   LOG_DEBUG("Checking size of '", downloadUrl.c_str(), "'.");
   vTaskDelay(500 / portTICK_PERIOD_MS);
-  size_t totalSize = 0;
-  while (totalSize == 0) {
-    totalSize = HttpLib::GetFileSize(downloadUrl.c_str());
+  // The downloader reads the image in ranged segments and resumes from the last received offset if the stream drops.
+  ChunkDownloader downloader(downloadUrl, OTA_DOWNLOAD_CHUNK_SIZE, OTA_DOWNLOAD_PREFETCH_CHUNKS);
+  while (!downloader.start()) {
+    LOG_ERROR("Failed to start download of '", downloadUrl.c_str(), "'. Will try again.");
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
   }
+  size_t totalSize = downloader.getTotalFileSize();
   LOG_INFO("Size of remote file '", downloadUrl.c_str(), "' is ", totalSize, " bytes.");
 
   LOG_INFO("Starting update.");
-  Update.onProgress(WebManager::_onProgress);
   bool canBegin = Update.begin(totalSize, type);
   if (!canBegin) {
     LOG_ERROR("Could not start update!");
     return false;
   }
+  if (md5 != nullptr) {
+    Update.setMD5(md5);
+  }
 
-  HTTPClient http;
-  http.begin(downloadUrl.c_str());
-  int http_code = http.GET();
-  if (http_code == 200) {
-    LOG_INFO("Established download stream for firmware update.");
-    Update.writeStream(http.getStream());
+  uint8_t *buffer = new uint8_t[OTA_DOWNLOAD_CHUNK_SIZE];
+  MD5Builder image_md5;
+  image_md5.begin();
+  size_t written = 0;
+  uint8_t timeouts_in_row = 0;
+  unsigned long download_start = millis();
+  WebManager::_update_throughput = 0;
+  while (written < totalSize) {
+    uint16_t read_size = downloader.readNextChunk(buffer);
+    if (read_size == 0) {
+      timeouts_in_row++;
+      if (timeouts_in_row >= OTA_DOWNLOAD_MAX_TIMEOUTS_IN_ROW) {
+        LOG_ERROR("No data received at offset ", written, " after ", timeouts_in_row, " attempts. Giving up.");
+        break;
+      }
+      continue;
+    }
+    timeouts_in_row = 0;
+    image_md5.add(buffer, read_size);
+    if (Update.write(buffer, read_size) != read_size) {
+      LOG_ERROR("Failed to write update data. Error #: ", Update.getError());
+      break;
+    }
+    written += read_size;
+    unsigned long elapsed = millis() - download_start;
+    if (elapsed > 0) {
+      WebManager::_update_throughput = ((uint64_t)written * 1000) / elapsed;
+    }
+  }
+  delete[] buffer;
+  downloader.stop();
+
+  LOG_INFO("Downloaded ", written, " of ", totalSize, " bytes at ", WebManager::_update_throughput, " B/s with ", downloader.getRetries(), " stream retries.");
+  if (written != totalSize) {
+    Update.abort();
+    return false;
+  }
+  image_md5.calculate();
+  if (md5 != nullptr && !image_md5.toString().equalsIgnoreCase(md5)) {
+    LOG_ERROR("Downloaded image has MD5 ", image_md5.toString().c_str(), " but manager reports ", md5, ". Aborting update.");
+    Update.abort();
+    return false;
   }
 
   if (!Update.end()) {
@@ -341,8 +668,361 @@ bool WebManager::_update(uint8_t type, const char *url) {
   }
 }
 
+bool WebManager::_updateFromCompressed(uint8_t type, std::string downloadUrl, const char *md5) {
+  downloadUrl.append("?compressed=heatshrink");
+  HeatshrinkDownloader downloader(downloadUrl);
+  if (!downloader.open()) {
+    return false;
+  }
+
+  // Flash space is accounted for using the uncompressed size announced by the manager
+  size_t totalSize = downloader.getUncompressedSize();
+  LOG_INFO("Starting update from compressed image, ", totalSize, " bytes uncompressed.");
+  if (!Update.begin(totalSize, type)) {
+    LOG_ERROR("Could not start update!");
+    return false;
+  }
+  if (md5 != nullptr) {
+    Update.setMD5(md5);
+  }
+
+  uint8_t *buffer = new uint8_t[OTA_DOWNLOAD_CHUNK_SIZE];
+  MD5Builder image_md5;
+  image_md5.begin();
+  size_t written = 0;
+  uint8_t failed_reads_in_row = 0;
+  unsigned long download_start = millis();
+  WebManager::_update_throughput = 0;
+  while (written < totalSize) {
+    size_t read_size = totalSize - written < OTA_DOWNLOAD_CHUNK_SIZE ? totalSize - written : OTA_DOWNLOAD_CHUNK_SIZE;
+    size_t received = downloader.read(buffer, read_size);
+    if (received != read_size) {
+      // The compressed stream can't be resumed in the middle, restart it and skip what has already been written.
+      failed_reads_in_row++;
+      if (failed_reads_in_row >= OTA_DOWNLOAD_MAX_TIMEOUTS_IN_ROW) {
+        LOG_ERROR("Compressed stream failed at offset ", written, " after ", failed_reads_in_row, " attempts. Giving up.");
+        break;
+      }
+      LOG_ERROR("Compressed stream interrupted at offset ", written, ". Will restart stream.");
+      downloader.seek(written);
+      continue;
+    }
+    failed_reads_in_row = 0;
+    image_md5.add(buffer, received);
+    if (Update.write(buffer, received) != received) {
+      LOG_ERROR("Failed to write update data. Error #: ", Update.getError());
+      break;
+    }
+    written += received;
+    unsigned long elapsed = millis() - download_start;
+    if (elapsed > 0) {
+      WebManager::_update_throughput = ((uint64_t)written * 1000) / elapsed;
+    }
+  }
+  delete[] buffer;
+
+  LOG_INFO("Decompressed ", written, " of ", totalSize, " bytes from ", downloader.getCompressedBytesReceived(), " compressed bytes at ", WebManager::_update_throughput, " B/s.");
+  downloader.close();
+  if (written != totalSize) {
+    Update.abort();
+    return false;
+  }
+  image_md5.calculate();
+  if (md5 != nullptr && !image_md5.toString().equalsIgnoreCase(md5)) {
+    LOG_ERROR("Decompressed image has MD5 ", image_md5.toString().c_str(), " but manager reports ", md5, ". Aborting update.");
+    Update.abort();
+    return false;
+  }
+  if (!Update.end()) {
+    LOG_ERROR("Update failed #:", Update.getError());
+    return false;
+  }
+  LOG_INFO("OTA from compressed image successful!");
+  return Update.isFinished();
+}
+
+String WebManager::_getLittleFSFileMD5(const char *path) {
+  File file = LittleFS.open(path, "r");
+  if (!file) {
+    return "";
+  }
+  MD5Builder md5;
+  md5.begin();
+  md5.addStream(file, file.size());
+  md5.calculate();
+  file.close();
+  return md5.toString();
+}
+
+/// @brief Percent-encode a value for use in a URL query, '/' is kept as is
+static std::string urlEncode(const char *value) {
+  static const char hex[] = "0123456789ABCDEF";
+  std::string encoded;
+  for (const char *c = value; *c != '\0'; c++) {
+    if (isalnum((unsigned char)*c) || *c == '-' || *c == '_' || *c == '.' || *c == '~' || *c == '/') {
+      encoded.push_back(*c);
+    } else {
+      encoded.push_back('%');
+      encoded.push_back(hex[(unsigned char)*c >> 4]);
+      encoded.push_back(hex[(unsigned char)*c & 0x0F]);
+    }
+  }
+  return encoded;
+}
+
+bool WebManager::_downloadLittleFSFile(const char *path, const char *md5) {
+  std::string downloadUrl = ManagerDiscovery::getManagerUrl();
+  downloadUrl.append("/download_data_file?path=");
+  downloadUrl.append(urlEncode(path));
+
+  std::string tmp_path = path;
+  tmp_path.append(".tmp");
+
+  HTTPClient *http = HttpClientPool::acquire(downloadUrl.c_str());
+  int http_code = http->GET();
+  if (http_code != 200) {
+    LOG_ERROR("Failed to download '", path, "'. Got return code: ", http_code);
+    HttpClientPool::release(http, false);
+    return false;
+  }
+
+  File file = LittleFS.open(tmp_path.c_str(), "w", true);
+  if (!file) {
+    LOG_ERROR("Failed to open '", tmp_path.c_str(), "' for writing.");
+    HttpClientPool::release(http, false);
+    return false;
+  }
+  int size = http->writeToStream(&file);
+  file.close();
+  // writeToStream reads the whole body on success, the connection is then reused for the next file
+  HttpClientPool::release(http, size >= 0);
+  if (size < 0) {
+    LOG_ERROR("Failed to download '", path, "'. Error: ", size);
+    LittleFS.remove(tmp_path.c_str());
+    return false;
+  }
+
+  String downloaded_md5 = WebManager::_getLittleFSFileMD5(tmp_path.c_str());
+  if (!downloaded_md5.equalsIgnoreCase(md5)) {
+    LOG_ERROR("Downloaded '", path, "' has MD5 ", downloaded_md5.c_str(), ", expected ", md5);
+    LittleFS.remove(tmp_path.c_str());
+    return false;
+  }
+
+  // Rename replaces the old file in one step so the web interface never serves a partially written file.
+  if (!LittleFS.rename(tmp_path.c_str(), path)) {
+    LOG_ERROR("Failed to replace '", path, "'.");
+    LittleFS.remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool WebManager::_syncLittleFSFromManifest() {
+  std::string manifestUrl = ManagerDiscovery::getManagerUrl();
+  manifestUrl.append("/data_file_manifest");
+
+  JsonDocument *manifest = new JsonDocument;
+  if (!HttpLib::DownloadJSON(manifestUrl.c_str(), manifest) || !(*manifest)["files"].is<JsonArray>()) {
+    LOG_INFO("No LittleFS manifest available from manager.");
+    delete manifest;
+    return false;
+  }
+
+  WebManager::_state = WebManagerState::UPDATING_LITTLEFS;
+  WebManager::_update_progress = 0;
+  JsonArray files = (*manifest)["files"].as<JsonArray>();
+  size_t files_checked = 0;
+  size_t files_updated = 0;
+  bool success = true;
+  std::unordered_set<std::string> manifest_paths;
+  for (JsonVariant file : files) {
+    const char *path = file["path"] | "";
+    const char *md5 = file["md5"] | "";
+    files_checked++;
+    WebManager::_onProgress(files_checked, files.size());
+    if (path[0] != '/' || strlen(md5) != 32) {
+      LOG_ERROR("Invalid entry in LittleFS manifest.");
+      success = false;
+      break;
+    }
+    manifest_paths.insert(path);
+    if (strcmp(path, NSPM_CONFIG_PATH) == 0 || strcmp(path, NSPM_CONFIG_LEGACY_JSON_PATH) == 0) {
+      // Never replace the local config
+      continue;
+    }
+    if (WebManager::_getLittleFSFileMD5(path).equalsIgnoreCase(md5)) {
+      continue;
+    }
+    LOG_INFO("Updating LittleFS file '", path, "'.");
+    if (!WebManager::_downloadLittleFSFile(path, md5)) {
+      success = false;
+      break;
+    }
+    files_updated++;
+  }
+  delete manifest;
+
+  size_t files_removed = 0;
+  if (success) {
+    files_removed = WebManager::_removeFilesNotInManifest("/", manifest_paths);
+  }
+
+  LOG_INFO("LittleFS sync ", success ? "done" : "failed", ", updated ", files_updated, " of ", files_checked, " files, removed ", files_removed, " files.");
+  return success;
+}
+
+size_t WebManager::_removeFilesNotInManifest(const char *directory, std::unordered_set<std::string> &manifest_paths) {
+  File dir = LittleFS.open(directory);
+  if (!dir || !dir.isDirectory()) {
+    return 0;
+  }
+  std::vector<std::string> stale_paths;
+  std::vector<std::string> subdirectories;
+  for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+    std::string path = entry.path();
+    if (entry.isDirectory()) {
+      // Room config snapshots are written by RoomManager, not part of the data files
+      if (path != ROOM_MANAGER_SNAPSHOT_DIRECTORY) {
+        subdirectories.push_back(path);
+      }
+    } else if (manifest_paths.count(path) == 0 && path != NSPM_CONFIG_PATH && path != NSPM_CONFIG_TMP_PATH && path != NSPM_CONFIG_LEGACY_JSON_PATH &&
+               path != NSPM_CONFIG_LEGACY_JSON_TMP_PATH) {
+      stale_paths.push_back(path);
+    }
+    entry.close();
+  }
+  dir.close();
+
+  size_t removed = 0;
+  for (std::string &path : stale_paths) {
+    LOG_INFO("Removing LittleFS file '", path.c_str(), "', no longer in manifest.");
+    if (LittleFS.remove(path.c_str())) {
+      removed++;
+    }
+  }
+  for (std::string &subdirectory : subdirectories) {
+    removed += WebManager::_removeFilesNotInManifest(subdirectory.c_str(), manifest_paths);
+  }
+  return removed;
+}
+
+bool WebManager::_readRunningPartition(void *context, uint32_t offset, uint8_t *buffer, size_t size) {
+  return esp_partition_read((const esp_partition_t *)context, offset, buffer, size) == ESP_OK;
+}
+
+bool WebManager::_updateFromDelta(const char *md5) {
+  if (NSPMConfig::instance->md5_firmware.empty()) {
+    LOG_INFO("No stored firmware MD5, can't request delta update.");
+    return false;
+  }
+
+  std::string downloadUrl = ManagerDiscovery::getManagerUrl();
+  downloadUrl.append("/download_firmware_delta?from=");
+  downloadUrl.append(NSPMConfig::instance->md5_firmware);
+
+  HTTPClient *http = HttpClientPool::acquire(downloadUrl.c_str());
+  int http_code = http->GET();
+  if (http_code != 200) {
+    LOG_INFO("No delta update available from manager. Got return code: ", http_code);
+    HttpClientPool::release(http, false);
+    return false;
+  }
+
+  const esp_partition_t *running_partition = esp_ota_get_running_partition();
+  DeltaPatch patch(WebManager::_readRunningPartition, (void *)running_partition);
+  WiFiClient *stream = http->getStreamPtr();
+  uint8_t input_buffer[512];
+  uint8_t output_buffer[1024];
+  size_t input_length = 0;
+  size_t input_offset = 0;
+  bool update_started = false;
+  unsigned long last_data_received = millis();
+
+  while (!patch.isFinished()) {
+    if (patch.hasError()) {
+      LOG_ERROR("Delta patch is invalid or running firmware could not be read.");
+      break;
+    }
+    if (input_offset >= input_length) {
+      size_t available = stream->available();
+      if (available == 0) {
+        if (millis() - last_data_received > 5000 || !stream->connected()) {
+          LOG_ERROR("Delta patch download stalled.");
+          break;
+        }
+        vTaskDelay(5 / portTICK_PERIOD_MS);
+        continue;
+      }
+      input_length = stream->readBytes(input_buffer, available < sizeof(input_buffer) ? available : sizeof(input_buffer));
+      input_offset = 0;
+      last_data_received = millis();
+    }
+
+    size_t consumed = 0;
+    size_t output_length = patch.apply(&input_buffer[input_offset], input_length - input_offset, &consumed, output_buffer, sizeof(output_buffer));
+    input_offset += consumed;
+
+    if (!update_started && patch.isHeaderReady() && !patch.hasError()) {
+      char source_md5[33];
+      char target_md5[33];
+      patch.getSourceMD5(source_md5);
+      patch.getTargetMD5(target_md5);
+      if (NSPMConfig::instance->md5_firmware.compare(source_md5) != 0 || strcasecmp(target_md5, md5) != 0) {
+        LOG_ERROR("Delta patch is for ", source_md5, " -> ", target_md5, ", expected ", NSPMConfig::instance->md5_firmware.c_str(), " -> ", md5);
+        break;
+      }
+
+      // Make sure the running image really is what the patch was made against, the stored checksum could be stale.
+      MD5Builder running_md5;
+      running_md5.begin();
+      for (uint32_t offset = 0; offset < patch.getSourceSize(); offset += sizeof(output_buffer)) {
+        size_t read_size = patch.getSourceSize() - offset < sizeof(output_buffer) ? patch.getSourceSize() - offset : sizeof(output_buffer);
+        if (esp_partition_read(running_partition, offset, output_buffer, read_size) != ESP_OK) {
+          break;
+        }
+        running_md5.add(output_buffer, read_size);
+      }
+      running_md5.calculate();
+      if (!running_md5.toString().equalsIgnoreCase(source_md5)) {
+        LOG_ERROR("Running firmware MD5 ", running_md5.toString().c_str(), " does not match delta patch source ", source_md5);
+        break;
+      }
+
+      LOG_INFO("Applying delta patch, new firmware size ", patch.getTargetSize(), " bytes.");
+      if (!Update.begin(patch.getTargetSize(), U_FLASH)) {
+        LOG_ERROR("Could not start update!");
+        break;
+      }
+      Update.setMD5(md5);
+      update_started = true;
+    }
+
+    if (output_length > 0 && Update.write(output_buffer, output_length) != output_length) {
+      LOG_ERROR("Failed to write delta output. Error #: ", Update.getError());
+      break;
+    }
+  }
+  // The end of the patch is not necessarily the end of the response, never reuse the connection
+  HttpClientPool::release(http, false);
+
+  if (!patch.isFinished() || !update_started) {
+    if (update_started) {
+      Update.abort();
+    }
+    return false;
+  }
+
+  if (!Update.end()) {
+    LOG_ERROR("Delta update failed #:", Update.getError());
+    return false;
+  }
+  LOG_INFO("Delta OTA Successful!");
+  return Update.isFinished();
+}
+
 void WebManager::_onProgress(size_t progress, size_t total) {
-  WebManager::_update_progress = (progress / (total / 100));
+  WebManager::_update_progress = total > 0 ? ((uint64_t)progress * 100) / total : 0;
   if (WebManager::_state == WebManagerState::UPDATING_FIRMWARE && WebManager::_last_displayed_update_progress != WebManager::_update_progress) {
     std::string update_string = "Updating FW ";
     update_string.append(std::to_string(WebManager::_update_progress));
@@ -6,6 +6,15 @@
 #include <ArduinoJson.h>
 #include <ESPAsyncWebServer.h>
 #include <NSPMConfig.h>
+#include <string>
+#include <unordered_set>
+
+// Size of each segment downloaded during a firmware or LittleFS OTA
+#define OTA_DOWNLOAD_CHUNK_SIZE 4096
+// Number of segments to download ahead of flash writes
+#define OTA_DOWNLOAD_PREFETCH_CHUNKS 4
+// Number of segment read timeouts in a row before the OTA is aborted
+#define OTA_DOWNLOAD_MAX_TIMEOUTS_IN_ROW 3
 
 enum WebManagerState {
   ONLINE,
@@ -25,15 +34,90 @@ public:
   static void saveConfigFromWeb(AsyncWebServerRequest *request);
   static void respondAvailableWiFiNetworks(AsyncWebServerRequest *request);
   static void startOTAUpdate();
+  /// @brief Update firmware, LittleFS and TFT, only components with a changed checksum are updated, then reboot once
+  static void startCombinedUpdate();
   static void factoryReset(AsyncWebServerRequest *request);
   static void doRebootNow(AsyncWebServerRequest *request);
   static WebManagerState getState();
   static uint8_t getUpdateProgress();
+  /// @brief If updating, the download throughput in bytes/second
+  static uint32_t getUpdateThroughput();
 
 private:
   AsyncWebServer _server = AsyncWebServer(80);
-  static bool _update(uint8_t type, const char *url);
+  /// @brief Upload handler for firmware and LittleFS images posted directly to the panel, writes each part straight into Update
+  static void _handleImageUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final);
+  /// @brief Respond to a finished firmware or LittleFS upload and restart the panel
+  static void _handleImageUploadFinished(AsyncWebServerRequest *request);
+  /// @brief Start a TFT update from an uploaded file, the panel needs a couple of seconds to enter upload mode before data can be posted
+  static void _prepareTFTUpload(AsyncWebServerRequest *request);
+  /// @brief Respond with the state of a TFT update started by _prepareTFTUpload
+  static void _respondTFTUploadStatus(AsyncWebServerRequest *request);
+  /// @brief Respond with the boot timeline recorded by BootProfiler as JSON
+  static void _respondBootTimeline(AsyncWebServerRequest *request);
+  /// @brief Respond with the stored config as a JSON file
+  static void _respondExportConfig(AsyncWebServerRequest *request);
+  /// @brief Body handler for one part of a TFT file posted directly to the panel. A part is only accepted as a whole if it fits in the
+  /// @brief panel upload buffer, otherwise it is answered with 503 and the web interface posts it again.
+  static void _handleTFTUpload(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+  static void _handleTFTUploadFinished(AsyncWebServerRequest *request);
+  /// @brief Offset in the TFT file of the next part to accept
+  static inline size_t _tft_upload_offset = 0;
+  /// @brief HTTP status to answer the TFT file part being received with
+  static inline int _tft_upload_part_status = 200;
+  /// @brief Restart after a direct upload has been answered, saves the config back if writing LittleFS was started
+  /// @param param U_FLASH or U_SPIFFS
+  static void _taskRestartAfterUpload(void *param);
+  /// @brief Set if anything went wrong during a direct firmware or LittleFS upload
+  static inline bool _upload_failed = false;
+  /// @brief Set if a direct upload was ignored because another update is in progress
+  static inline bool _upload_rejected = false;
+  /// @brief Download and flash an image from the manager
+  /// @param type U_FLASH or U_SPIFFS
+  /// @param url The path on the manager to download the image from
+  /// @param md5 Expected MD5 of the image. If set, the update is verified against it and a firmware update will first try a delta patch
+  /// @return True if successful
+  static bool _update(uint8_t type, const char *url, const char *md5 = nullptr);
+  /// @brief Try to update the firmware by applying a delta patch from the manager to the running image
+  /// @param md5 Expected MD5 of the new firmware
+  /// @return True if successful, false if no patch was available or it could not be applied
+  static bool _updateFromDelta(const char *md5);
+  /// @brief Update LittleFS file by file from the manifest published by the manager, only files with a changed MD5 are downloaded
+  /// @return True if all files in the manifest are up to date
+  static bool _syncLittleFSFromManifest();
+  /// @brief Remove the files in a LittleFS directory and its subdirectories that are not in the manifest. The config files and the room
+  /// @brief config snapshots are kept.
+  /// @param directory The directory to clean up
+  /// @param manifest_paths The paths of all files in the manifest
+  /// @return The number of files removed
+  static size_t _removeFilesNotInManifest(const char *directory, std::unordered_set<std::string> &manifest_paths);
+  /// @brief Download a single file to LittleFS. The file is written to a temporary file and renamed over the old one once verified.
+  /// @param path The path of the file in LittleFS
+  /// @param md5 Expected MD5 of the file
+  /// @return True if successful
+  static bool _downloadLittleFSFile(const char *path, const char *md5);
+  /// @brief Calculate the MD5 of a file in LittleFS
+  /// @param path The path of the file
+  /// @return The MD5 as a hex string, empty if the file does not exist
+  static String _getLittleFSFileMD5(const char *path);
+  /// @brief Try to update from a heatshrink compressed image, decompressed on the fly while writing to Update
+  /// @param type U_FLASH or U_SPIFFS
+  /// @param downloadUrl The address of the uncompressed image
+  /// @param md5 Expected MD5 of the uncompressed image, or nullptr
+  /// @return True if successful, false if the manager has no compressed image or the update failed
+  static bool _updateFromCompressed(uint8_t type, std::string downloadUrl, const char *md5);
+  /// @brief Read data from the running app partition, used as source when applying a delta patch
+  static bool _readRunningPartition(void *context, uint32_t offset, uint8_t *buffer, size_t size);
+  /// @brief Task that updates firmware and LittleFS, and TFT if param is not NULL, then reboots
   static void _taskPerformOTAUpdate(void *param);
+  /// @brief Get a checksum from the manager, retrying until successful
+  /// @param path The checksum path on the manager
+  /// @param buffer Buffer of at least 33 bytes to put the checksum in to
+  static void _getChecksum(const char *path, char *buffer);
+  /// @brief Get the checksums of all components from the manager in one request
+  /// @param tft_md5 Set to the TFT checksum for this panel, nullptr if the TFT is not updated and its checksum is not needed
+  /// @return True if successful, false if the manager does not provide a manifest or it is missing a needed checksum
+  static bool _getUpdateManifest(char *firmware_md5, char *data_file_md5, char *tft_md5);
   static void _onProgress(size_t current, size_t total);
   std::string _nspmFirmwareVersion;
   /// @brief Contains the current state of actions.
@@ -41,6 +125,8 @@ private:
   /// @brief If updating, contains the % done of the update
   static inline uint8_t _update_progress;
   static inline uint8_t _last_displayed_update_progress;
+  /// @brief If updating, the download throughput in bytes/second
+  static inline uint32_t _update_throughput;
 
   static inline bool _has_already_been_started = false;
 };
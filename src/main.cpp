@@ -1,10 +1,14 @@
 #include "esp32-hal.h"
 #include "freertos/portmacro.h"
 #include <Arduino.h>
+#include <BootProfiler.hpp>
 #include <ButtonManager.hpp>
+#include <ConnectionState.hpp>
 #include <HTTPClient.h>
+#include <HttpClientPool.hpp>
 #include <InterfaceManager.hpp>
 #include <LittleFS.h>
+#include <ManagerDiscovery.hpp>
 #include <MqttLog.hpp>
 #include <MqttManager.hpp>
 #include <NSPMConfig.h>
@@ -111,6 +115,7 @@ void onWiFiEvent(WiFiEvent_t event) {
     break;
   case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
     Serial.println("Disconnected from WiFi access point");
+    ConnectionState::clear(CONNECTION_STATE_WIFI_CONNECTED);
     break;
   case ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE:
     Serial.println("Authentication mode of access point has changed");
@@ -118,9 +123,11 @@ void onWiFiEvent(WiFiEvent_t event) {
   case ARDUINO_EVENT_WIFI_STA_GOT_IP:
     Serial.print("Obtained IP address: ");
     Serial.println(WiFi.localIP());
+    ConnectionState::set(CONNECTION_STATE_WIFI_CONNECTED);
     break;
   case ARDUINO_EVENT_WIFI_STA_LOST_IP:
     Serial.println("Lost IP address and IP address is reset to 0");
+    ConnectionState::clear(CONNECTION_STATE_WIFI_CONNECTED);
     break;
   case ARDUINO_EVENT_WPS_ER_SUCCESS:
     Serial.println("WiFi Protected Setup (WPS): succeeded in enrollee mode");
@@ -258,11 +265,10 @@ void taskManageWifiAndMqtt(void *param) {
           Serial.print("Connecting to WiFi ");
           Serial.println(config.wifi_ssid.c_str());
           WiFi.begin(config.wifi_ssid.c_str(), config.wifi_psk.c_str());
-          vTaskDelay(2000 / portTICK_PERIOD_MS);
-          if (!WiFi.isConnected()) {
-            LOG_ERROR("Failed to connect to WiFi. Will try again in 5 seconds");
-            Serial.println("Failed to connect to WiFi. Will try again in 5 seconds");
-            vTaskDelay(5000 / portTICK_PERIOD_MS);
+          // Continue as soon as an IP address is assigned
+          if (!ConnectionState::waitFor(CONNECTION_STATE_WIFI_CONNECTED, 7000 / portTICK_PERIOD_MS)) {
+            LOG_ERROR("Failed to connect to WiFi. Will try again.");
+            Serial.println("Failed to connect to WiFi. Will try again.");
           }
         }
 
@@ -274,6 +280,7 @@ void taskManageWifiAndMqtt(void *param) {
           LOG_INFO("IP Address: ", WiFi.localIP().toString());
           LOG_INFO("Netmask:    ", WiFi.subnetMask().toString());
           LOG_INFO("Gateway:    ", WiFi.gatewayIP().toString());
+          BootProfiler::mark("wifi_connected");
 
           // We successfully connected to WiFi. Init the rest of the components.
           webMan.init(NSPanelManagerFirmwareVersion);
@@ -287,20 +294,27 @@ void taskManageWifiAndMqtt(void *param) {
         if (!InterfaceManager::hasRegisteredToManager) {
           sendMqttManagerRegistrationRequest();
         }
+        BootProfiler::publishIfComplete();
+      }
+      // Status reports include the display state, wait for the display to be initialised before sending any
+      if (WiFi.isConnected() && MqttManager::connected() && ConnectionState::isSet(CONNECTION_STATE_PANEL_INITIALISED)) {
         bool force_send_mqtt_update = false;
         JsonDocument *status_report_doc = new JsonDocument;
         if (NSPanel::instance->getUpdateState()) {
           force_send_mqtt_update = true;
           (*status_report_doc)["state"] = "updating_tft";
           (*status_report_doc)["progress"] = NSPanel::instance->getUpdateProgress();
+          NSPanel::instance->getTFTUploadStats((*status_report_doc)["tft_upload"].to<JsonObject>());
         } else if (WebManager::getState() == WebManagerState::UPDATING_FIRMWARE) {
           force_send_mqtt_update = true;
           (*status_report_doc)["state"] = "updating_fw";
           (*status_report_doc)["progress"] = WebManager::getUpdateProgress();
+          (*status_report_doc)["throughput"] = WebManager::getUpdateThroughput();
         } else if (WebManager::getState() == WebManagerState::UPDATING_LITTLEFS) {
           force_send_mqtt_update = true;
           (*status_report_doc)["state"] = "updating_fs";
           (*status_report_doc)["progress"] = WebManager::getUpdateProgress();
+          (*status_report_doc)["throughput"] = WebManager::getUpdateThroughput();
         }
         // Online/Offline state is handled in /status topic managed by MQTTManager.
 
@@ -312,13 +326,20 @@ void taskManageWifiAndMqtt(void *param) {
           (*status_report_doc)["mac"] = WiFi.macAddress();
           (*status_report_doc)["temperature"] = display_temp;
           (*status_report_doc)["ip"] = WiFi.localIP().toString();
+          HttpClientPool::Metrics http_metrics = HttpClientPool::getMetrics();
+          JsonObject http_status = (*status_report_doc)["http"].to<JsonObject>();
+          http_status["requests"] = http_metrics.requests;
+          http_status["reused"] = http_metrics.reused_connections;
+          http_status["avg_ms"] = http_metrics.requests > 0 ? http_metrics.total_request_time_ms / http_metrics.requests : 0;
+          http_status["max_ms"] = http_metrics.max_request_time_ms;
+          http_status["wait_ms"] = http_metrics.total_wait_time_ms;
 
           std::string warning_string = NSPanel::instance->getWarnings();
           (*status_report_doc)["warnings"] = warning_string.c_str();
 
           MqttManager::publish(NSPMConfig::instance->mqtt_panel_temperature_topic, display_temp);
 
-          char buffer[512];
+          char buffer[1024];
           uint json_length = serializeJson(*status_report_doc, buffer);
           MqttManager::publish(NSPMConfig::instance->mqtt_panel_status_topic, buffer, true);
 
@@ -336,7 +357,8 @@ void taskManageWifiAndMqtt(void *param) {
         lastWiFiconnected = millis();
       }
       yield();
-      vTaskDelay(1000 / portTICK_PERIOD_MS);
+      // Wake up as soon as the next connection stage is reached, at least once a second to send registration requests and status reports
+      ConnectionState::waitForNextStage(1000 / portTICK_PERIOD_MS);
     }
   } else {
     // No WiFi SSID configured.
@@ -344,7 +366,28 @@ void taskManageWifiAndMqtt(void *param) {
   }
 }
 
+void taskInitNSPanel(void *param) {
+  vTaskDelay(250 / portTICK_PERIOD_MS);
+  LOG_INFO("Initializing NSPanel communication");
+  if (nspanel.init()) {
+    LOG_INFO("Successfully initiated NSPanel.");
+  } else {
+    LOG_ERROR("Failed to initiate NSPanel.");
+  }
+  BootProfiler::mark("nspanel_init");
+  vTaskDelay(500 / portTICK_PERIOD_MS);
+  PageManager::init(); // Attach event callbacks
+
+  LOG_INFO("Starting tasks");
+  interfaceManager.init();
+  ConnectionState::set(CONNECTION_STATE_PANEL_INITIALISED);
+  BootProfiler::mark("interface_manager_started");
+  vTaskDelete(NULL);
+}
+
 void setup() {
+  BootProfiler::mark("setup");
+  ConnectionState::init();
   Serial.begin(115200);
   Serial.print("Starting NSPanel Manager firmware v. ");
   Serial.println(NSPanelManagerFirmwareVersion);
@@ -353,27 +396,23 @@ void setup() {
   if (!(config.init() && config.loadFromLittleFS())) {
     config.factoryReset();
   }
+  BootProfiler::mark("config_loaded");
 
   // Setup logging
   logger.init(&(NSPMConfig::instance->mqtt_log_topic));
   logger.setLogLevel(static_cast<MqttLogLevel>(config.logging_level));
 
   mqttManager.init();
+  // The manager answers registration requests on the command topic, listen to it as soon as MQTT connects, whether or not the display is up
+  MqttManager::subscribeToTopic(NSPMConfig::instance->mqtt_panel_cmd_topic.c_str(), &InterfaceManager::handleNSPanelCommand);
   ButtonManager::init();
   xTaskCreatePinnedToCore(readNTCTemperatureTask, "readTempTask", 5000, NULL, 0, NULL, CONFIG_ARDUINO_RUNNING_CORE);
 
-  vTaskDelay(250 / portTICK_PERIOD_MS);
-  LOG_INFO("Initializing NSPanel communication");
-  if (nspanel.init()) {
-    LOG_INFO("Successfully initiated NSPanel.");
-  } else {
-    LOG_ERROR("Failed to initiate NSPanel.");
-  }
-  vTaskDelay(500 / portTICK_PERIOD_MS);
-  PageManager::init(); // Attach event callbacks
+  // Look for the manager with mDNS as soon as WiFi is up, in parallel with connecting to MQTT
+  ManagerDiscovery::start();
 
-  LOG_INFO("Starting tasks");
-  interfaceManager.init();
+  // The display handshake takes several seconds, run it while loop() brings up WiFi and MQTT
+  xTaskCreatePinnedToCore(taskInitNSPanel, "taskInitNSPanel", 8192, NULL, 1, NULL, CONFIG_ARDUINO_RUNNING_CORE);
 
   pinMode(38, INPUT);
 }
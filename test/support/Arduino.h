@@ -0,0 +1,98 @@
+#ifndef TEST_SUPPORT_ARDUINO_H
+#define TEST_SUPPORT_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino ESP32 core used by the libraries under test
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <string>
+
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
+#define BIT4 0x00000010
+#define BIT5 0x00000020
+#define BIT6 0x00000040
+#define BIT7 0x00000080
+
+inline unsigned long millis() {
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline void delay(uint32_t ms) {
+  vTaskDelay(ms);
+}
+
+inline bool psramFound() {
+  return false;
+}
+
+class String {
+public:
+  String() {}
+  String(const char *value) : _value(value != nullptr ? value : "") {}
+  String(const std::string &value) : _value(value) {}
+  String(int value) : _value(std::to_string(value)) {}
+  String(unsigned int value) : _value(std::to_string(value)) {}
+  String(long value) : _value(std::to_string(value)) {}
+  String(unsigned long value) : _value(std::to_string(value)) {}
+  const char *c_str() const { return this->_value.c_str(); }
+  unsigned int length() const { return this->_value.length(); }
+  bool isEmpty() const { return this->_value.empty(); }
+  long toInt() const { return strtol(this->_value.c_str(), nullptr, 10); }
+  bool equals(const String &other) const { return this->_value == other._value; }
+  bool equalsIgnoreCase(const String &other) const {
+    return this->_value.size() == other._value.size() && std::equal(this->_value.begin(), this->_value.end(), other._value.begin(), [](char a, char b) { return tolower(a) == tolower(b); });
+  }
+  bool operator==(const String &other) const { return this->equals(other); }
+  bool operator==(const char *other) const { return this->_value == other; }
+  bool operator!=(const String &other) const { return !this->equals(other); }
+  String &operator+=(const String &other) {
+    this->_value += other._value;
+    return *this;
+  }
+
+private:
+  std::string _value;
+};
+
+class IPAddress {
+public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _octets{a, b, c, d} {}
+  String toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", this->_octets[0], this->_octets[1], this->_octets[2], this->_octets[3]);
+    return String(buffer);
+  }
+
+private:
+  uint8_t _octets[4];
+};
+
+class HardwareSerial {
+public:
+  template <typename T>
+  size_t print(const T &) { return 0; }
+  template <typename T>
+  size_t println(const T &) { return 0; }
+  size_t println() { return 0; }
+  size_t printf(const char *, ...) { return 0; }
+};
+
+inline HardwareSerial Serial;
+
+#endif
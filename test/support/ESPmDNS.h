@@ -0,0 +1,86 @@
+#ifndef TEST_SUPPORT_ESPMDNS_H
+#define TEST_SUPPORT_ESPMDNS_H
+
+#include <Arduino.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// @brief Stand-in for the mDNS responders on the network, answers queries made through the host MDNS
+class MdnsStandIn {
+public:
+  struct Service {
+    std::string service;
+    std::string protocol;
+    IPAddress ip;
+    uint16_t port;
+  };
+
+  /// @brief Answer queries for service and protocol with ip and port
+  static void advertise(const std::string &service, const std::string &protocol, IPAddress ip, uint16_t port) {
+    std::lock_guard<std::mutex> lock(_mutex());
+    _services().push_back({service, protocol, ip, port});
+  }
+
+  /// @brief Stop advertising all services and clear the query count
+  static void reset() {
+    std::lock_guard<std::mutex> lock(_mutex());
+    _services().clear();
+    _queries() = 0;
+  }
+
+  /// @brief Number of queries made since the last reset
+  static int getQueries() {
+    std::lock_guard<std::mutex> lock(_mutex());
+    return _queries();
+  }
+
+  static std::vector<Service> query(const std::string &service, const std::string &protocol) {
+    std::lock_guard<std::mutex> lock(_mutex());
+    _queries()++;
+    std::vector<Service> found;
+    for (Service &advertised : _services()) {
+      if (advertised.service == service && advertised.protocol == protocol) {
+        found.push_back(advertised);
+      }
+    }
+    return found;
+  }
+
+private:
+  static std::mutex &_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::vector<Service> &_services() {
+    static std::vector<Service> services;
+    return services;
+  }
+
+  static int &_queries() {
+    static int queries = 0;
+    return queries;
+  }
+};
+
+/// @brief Host stand-in for the ESP32 mDNS responder, queries are answered by MdnsStandIn
+class MDNSResponder {
+public:
+  bool begin(const char *hostname) { return true; }
+
+  int queryService(const char *service, const char *protocol) {
+    this->_results = MdnsStandIn::query(service, protocol);
+    return this->_results.size();
+  }
+
+  IPAddress IP(int index) { return this->_results[index].ip; }
+  uint16_t port(int index) { return this->_results[index].port; }
+
+private:
+  std::vector<MdnsStandIn::Service> _results;
+};
+
+inline MDNSResponder MDNS;
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef TEST_SUPPORT_HTTPCLIENT_H
+#define TEST_SUPPORT_HTTPCLIENT_H
+
+#include <Arduino.h>
+#include <HttpStandIn.hpp>
+#include <WiFi.h>
+
+/// @brief Host stand-in for the Arduino HTTPClient, requests are answered by HttpStandIn
+class HTTPClient {
+public:
+  bool begin(const char *url) {
+    this->_url = url;
+    this->_range.clear();
+    return true;
+  }
+  bool begin(const String &url) { return this->begin(url.c_str()); }
+  void end() { this->_range.clear(); }
+  void setReuse(bool reuse) {}
+  void setConnectTimeout(int32_t timeout) {}
+  void setTimeout(uint16_t timeout) {}
+  void collectHeaders(const char *header_names[], size_t count) {}
+
+  void addHeader(const String &name, const String &value) {
+    if (name == "Range") {
+      this->_range = value.c_str();
+    }
+  }
+
+  int GET() { return this->sendRequest("GET"); }
+
+  int sendRequest(const char *method) {
+    this->_response = HttpStandIn::handle(method, this->_url, this->_range);
+    this->_stream.open(this->_response);
+    return this->_response.code;
+  }
+
+  bool hasHeader(const char *name) { return this->_response.headers.count(name) > 0; }
+
+  String header(const char *name) {
+    auto header = this->_response.headers.find(name);
+    return header == this->_response.headers.end() ? String() : String(header->second);
+  }
+
+  int getSize() { return this->header("Content-Length").toInt(); }
+  WiFiClient *getStreamPtr() { return &this->_stream; }
+  bool connected() { return this->_stream.connected(); }
+
+private:
+  std::string _url;
+  std::string _range;
+  HttpStandIn::Response _response;
+  WiFiClient _stream;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef HEATSHRINK_TEST_ENCODER_HPP
+#define HEATSHRINK_TEST_ENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Minimal heatshrink (LZSS) encoder used to create compressed test data on the host. It writes the same bit
+/// @brief stream as the heatshrink command line tool: a 1 tag bit followed by a literal byte, or a 0 tag bit followed
+/// @brief by (offset - 1) in window_bits bits and (count - 1) in lookahead_bits bits. Matching is greedy and slow,
+/// @brief which is fine for test data.
+class HeatshrinkTestEncoder {
+public:
+  static std::vector<uint8_t> encode(const std::vector<uint8_t> &input, uint8_t window_bits, uint8_t lookahead_bits) {
+    HeatshrinkTestEncoder encoder;
+    size_t max_offset = (size_t)1 << window_bits;
+    size_t max_count = (size_t)1 << lookahead_bits;
+    // A back-reference only saves space when it covers more bits than the literals it replaces
+    size_t min_count = (1 + window_bits + lookahead_bits) / 9 + 1;
+
+    size_t position = 0;
+    while (position < input.size()) {
+      size_t best_count = 0;
+      size_t best_offset = 0;
+      for (size_t offset = 1; offset <= max_offset && offset <= position; offset++) {
+        size_t count = 0;
+        while (count < max_count && position + count < input.size() && input[position + count] == input[position + count - offset]) {
+          count++;
+        }
+        if (count > best_count) {
+          best_count = count;
+          best_offset = offset;
+        }
+      }
+
+      if (best_count >= min_count) {
+        encoder._putBits(0, 1);
+        encoder._putBits(best_offset - 1, window_bits);
+        encoder._putBits(best_count - 1, lookahead_bits);
+        position += best_count;
+      } else {
+        encoder._putBits(1, 1);
+        encoder._putBits(input[position], 8);
+        position++;
+      }
+    }
+    return encoder._output;
+  }
+
+private:
+  void _putBits(uint16_t value, uint8_t count) {
+    for (int bit = count - 1; bit >= 0; bit--) {
+      if (this->_bitCount == 0) {
+        this->_output.push_back(0);
+      }
+      if (value & (1 << bit)) {
+        this->_output.back() |= 0x80 >> this->_bitCount;
+      }
+      this->_bitCount = (this->_bitCount + 1) % 8;
+    }
+  }
+
+  std::vector<uint8_t> _output;
+  uint8_t _bitCount = 0;
+};
+
+#endif
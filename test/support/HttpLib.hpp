@@ -0,0 +1,20 @@
+#ifndef HTTP_LIB_H
+#define HTTP_LIB_H
+
+// Host stand-in for HttpLib with the calls used by the downloaders, the real library needs ArduinoJson and MD5Builder
+
+#include <Arduino.h>
+#include <HttpClientPool.hpp>
+
+class HttpLib {
+public:
+  static size_t GetFileSize(const char *url) {
+    HTTPClient *httpClient = HttpClientPool::acquire(url);
+    int httpReturnCode = httpClient->sendRequest("HEAD");
+    size_t content_length = httpReturnCode == 200 ? httpClient->header("Content-Length").toInt() : 0;
+    HttpClientPool::release(httpClient);
+    return content_length;
+  }
+};
+
+#endif
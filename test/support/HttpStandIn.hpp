@@ -0,0 +1,137 @@
+#ifndef HTTP_STAND_IN_HPP
+#define HTTP_STAND_IN_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// @brief In-process stand-in for the manager's HTTP server, answers requests made through the host HTTPClient.
+/// @brief Files are served with Range support, and faults can be injected per file: short reads and connections
+/// @brief that drop after a number of body bytes.
+class HttpStandIn {
+public:
+  struct File {
+    std::vector<uint8_t> body;
+    /// @brief Extra response headers
+    std::map<std::string, std::string> headers;
+    /// @brief Answer Range requests with 206, otherwise the whole body is returned with 200
+    bool ranges = true;
+    /// @brief Most bytes made available by a single read, smaller than the request to force short reads
+    size_t max_read = SIZE_MAX;
+    /// @brief For each of the next GET requests, the number of body bytes sent before the connection drops
+    std::deque<size_t> drop_after;
+  };
+
+  struct Request {
+    std::string method;
+    std::string path;
+    /// @brief The Range header sent with the request, empty if none
+    std::string range;
+  };
+
+  struct Response {
+    int code = -1;
+    std::map<std::string, std::string> headers;
+    std::shared_ptr<const std::vector<uint8_t>> body;
+    size_t body_start = 0;
+    size_t body_end = 0;
+    size_t max_read = SIZE_MAX;
+  };
+
+  /// @brief Serve a file at path (including any query string) on every host
+  static void serve(const std::string &path, const File &file) {
+    std::lock_guard<std::mutex> lock(_mutex());
+    _files()[path] = std::make_shared<File>(file);
+  }
+
+  /// @brief Remove all files and the request log
+  static void reset() {
+    std::lock_guard<std::mutex> lock(_mutex());
+    _files().clear();
+    _requests().clear();
+  }
+
+  /// @brief All requests made since the last reset
+  static std::vector<Request> getRequests() {
+    std::lock_guard<std::mutex> lock(_mutex());
+    return _requests();
+  }
+
+  static Response handle(const std::string &method, const std::string &url, const std::string &range) {
+    std::lock_guard<std::mutex> lock(_mutex());
+    Response response;
+    std::string path = _getPath(url);
+    _requests().push_back({method, path, range});
+    auto file_iterator = _files().find(path);
+    if (file_iterator == _files().end()) {
+      response.code = 404;
+      response.headers["Content-Length"] = "0";
+      return response;
+    }
+
+    File *file = file_iterator->second.get();
+    size_t total = file->body.size();
+    response.body = std::make_shared<const std::vector<uint8_t>>(file->body);
+    response.headers = file->headers;
+    response.max_read = file->max_read;
+    response.code = 200;
+    response.body_start = 0;
+    response.body_end = total;
+
+    unsigned long range_start, range_end;
+    if (file->ranges && !range.empty()) {
+      int fields = sscanf(range.c_str(), "bytes=%lu-%lu", &range_start, &range_end);
+      if (fields < 1 || range_start >= total) {
+        response.code = 416;
+        response.headers["Content-Length"] = "0";
+        response.body_end = 0;
+        return response;
+      }
+      response.code = 206;
+      response.body_start = range_start;
+      response.body_end = fields == 2 && range_end + 1 < total ? range_end + 1 : total;
+      response.headers["Content-Range"] = "bytes " + std::to_string(response.body_start) + "-" + std::to_string(response.body_end - 1) + "/" + std::to_string(total);
+    }
+    response.headers["Content-Length"] = std::to_string(response.body_end - response.body_start);
+
+    if (method == "HEAD") {
+      response.body_end = response.body_start;
+    } else if (!file->drop_after.empty()) {
+      size_t drop_after = file->drop_after.front();
+      file->drop_after.pop_front();
+      if (response.body_start + drop_after < response.body_end) {
+        response.body_end = response.body_start + drop_after;
+      }
+    }
+    return response;
+  }
+
+private:
+  static std::string _getPath(const std::string &url) {
+    size_t scheme_end = url.find("://");
+    size_t path_start = url.find('/', scheme_end == std::string::npos ? 0 : scheme_end + 3);
+    return path_start == std::string::npos ? "/" : url.substr(path_start);
+  }
+
+  static std::mutex &_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::map<std::string, std::shared_ptr<File>> &_files() {
+    static std::map<std::string, std::shared_ptr<File>> files;
+    return files;
+  }
+
+  static std::vector<Request> &_requests() {
+    static std::vector<Request> requests;
+    return requests;
+  }
+};
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef MqttLog_H
+#define MqttLog_H
+
+// Host stand-in for MqttLog, log messages from the libraries under test are discarded
+
+#include <Arduino.h>
+
+namespace mqtt_log_host {
+template <typename... Args>
+inline void discard(Args &&...) {}
+} // namespace mqtt_log_host
+
+#define LOG_ERROR(...) mqtt_log_host::discard(__VA_ARGS__)
+#define LOG_WARNING(...) mqtt_log_host::discard(__VA_ARGS__)
+#define LOG_INFO(...) mqtt_log_host::discard(__VA_ARGS__)
+#define LOG_DEBUG(...) mqtt_log_host::discard(__VA_ARGS__)
+#define LOG_TRACE(...) mqtt_log_host::discard(__VA_ARGS__)
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef NSPMConfig_H
+#define NSPMConfig_H
+
+// Host stand-in for NSPMConfig with the values read by the libraries under test, the real config needs LittleFS
+
+#include <cstdint>
+#include <string>
+
+class NSPMConfig {
+public:
+  static inline NSPMConfig *instance;
+
+  std::string wifi_hostname = "NSPMPanel";
+  std::string manager_address = "";
+  uint16_t manager_port = 8000;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TEST_IMAGE_HPP
+#define TEST_IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Deterministic stand-in for a TFT or firmware image. Mixes long runs, repeated records and noise
+/// @brief so that compressed data contains both literals and back-references of every length.
+class TestImage {
+public:
+  static std::vector<uint8_t> create(size_t size, uint32_t seed = 0x4E53504D) {
+    std::vector<uint8_t> image;
+    image.reserve(size);
+    uint32_t state = seed;
+    while (image.size() < size) {
+      state = state * 1664525 + 1013904223;
+      size_t length = 1 + ((state >> 8) % 96);
+      switch ((state >> 24) % 3) {
+      case 0:
+        // Run of the same byte, like padding or a filled picture area
+        image.insert(image.end(), length, (uint8_t)(state >> 16));
+        break;
+      case 1:
+        // Repeat of earlier data, like a repeated resource or record
+        if (image.size() > 0) {
+          size_t start = (state >> 4) % image.size();
+          for (size_t i = 0; i < length; i++) {
+            image.push_back(image[start + (i % (image.size() - start))]);
+          }
+          break;
+        }
+        // Fall through
+      default:
+        // Noise
+        for (size_t i = 0; i < length; i++) {
+          state = state * 1664525 + 1013904223;
+          image.push_back((uint8_t)(state >> 24));
+        }
+        break;
+      }
+    }
+    image.resize(size);
+    return image;
+  }
+};
+
+#endif
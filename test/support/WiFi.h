@@ -0,0 +1,63 @@
+#ifndef TEST_SUPPORT_WIFI_H
+#define TEST_SUPPORT_WIFI_H
+
+#include <Arduino.h>
+#include <HttpStandIn.hpp>
+
+/// @brief Host stand-in for the stream of an HTTP response, reads the body of a HttpStandIn response
+class WiFiClient {
+public:
+  void open(const HttpStandIn::Response &response) {
+    this->_body = response.body;
+    this->_position = response.body_start;
+    this->_end = response.body_end;
+    this->_maxRead = response.max_read;
+    this->_connected = response.code > 0;
+  }
+
+  int available() {
+    if (!this->_connected || this->_body == nullptr) {
+      return 0;
+    }
+    size_t remaining = this->_end - this->_position;
+    return remaining < this->_maxRead ? remaining : this->_maxRead;
+  }
+
+  size_t readBytes(uint8_t *buffer, size_t length) {
+    size_t available = this->available();
+    if (length > available) {
+      length = available;
+    }
+    memcpy(buffer, &this->_body->data()[this->_position], length);
+    this->_position += length;
+    return length;
+  }
+
+  size_t readBytes(char *buffer, size_t length) {
+    return this->readBytes((uint8_t *)buffer, length);
+  }
+
+  int read() {
+    uint8_t byte;
+    return this->readBytes(&byte, 1) == 1 ? byte : -1;
+  }
+
+  /// @brief Connected until the body has been read to its end, a dropped connection ends early
+  uint8_t connected() {
+    return this->_connected && this->_body != nullptr && this->_position < this->_end;
+  }
+
+  void stop() {
+    this->_connected = false;
+    this->_body = nullptr;
+  }
+
+private:
+  std::shared_ptr<const std::vector<uint8_t>> _body;
+  size_t _position = 0;
+  size_t _end = 0;
+  size_t _maxRead = SIZE_MAX;
+  bool _connected = false;
+};
+
+#endif
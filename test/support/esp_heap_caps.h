@@ -0,0 +1,17 @@
+#ifndef TEST_SUPPORT_ESP_HEAP_CAPS_H
+#define TEST_SUPPORT_ESP_HEAP_CAPS_H
+
+#include <cstdlib>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+  return malloc(size);
+}
+
+inline void heap_caps_free(void *ptr) {
+  free(ptr);
+}
+
+#endif
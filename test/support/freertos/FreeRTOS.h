@@ -0,0 +1,54 @@
+#ifndef TEST_SUPPORT_FREERTOS_H
+#define TEST_SUPPORT_FREERTOS_H
+
+// Host stand-in for the parts of the FreeRTOS API used by the firmware. Tasks are threads, one tick is one millisecond.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t EventBits_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFF
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (ms)
+#define CONFIG_ARDUINO_RUNNING_CORE 1
+
+namespace freertos_host {
+/// @brief Wait on condition until predicate is true or ticks have passed, portMAX_DELAY waits forever
+template <typename Predicate>
+bool waitTicks(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, TickType_t ticks, Predicate predicate) {
+  if (ticks == portMAX_DELAY) {
+    condition.wait(lock, predicate);
+    return true;
+  }
+  return condition.wait_for(lock, std::chrono::milliseconds(ticks), predicate);
+}
+
+/// @brief Thrown by vTaskDelete(NULL) to end the calling task's thread
+struct TaskDeleted {};
+} // namespace freertos_host
+
+// Critical sections, one lock shared by all
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+inline std::recursive_mutex &freertosHostCriticalMutex() {
+  static std::recursive_mutex mutex;
+  return mutex;
+}
+#define portENTER_CRITICAL(mux) freertosHostCriticalMutex().lock()
+#define portEXIT_CRITICAL(mux) freertosHostCriticalMutex().unlock()
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TEST_SUPPORT_FREERTOS_EVENT_GROUPS_H
+#define TEST_SUPPORT_FREERTOS_EVENT_GROUPS_H
+
+#include <freertos/FreeRTOS.h>
+
+struct EventGroupDefinition {
+  std::mutex mutex;
+  std::condition_variable condition;
+  EventBits_t bits = 0;
+};
+typedef EventGroupDefinition *EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() {
+  return new EventGroupDefinition();
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard<std::mutex> lock(group->mutex);
+  group->bits |= bits;
+  group->condition.notify_all();
+  return group->bits;
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+  std::lock_guard<std::mutex> lock(group->mutex);
+  EventBits_t before = group->bits;
+  group->bits &= ~bits;
+  return before;
+}
+
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+  std::lock_guard<std::mutex> lock(group->mutex);
+  return group->bits;
+}
+
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit, BaseType_t wait_for_all, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(group->mutex);
+  freertos_host::waitTicks(group->condition, lock, ticks, [group, bits, wait_for_all]() {
+    return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+  });
+  EventBits_t value = group->bits;
+  if (clear_on_exit) {
+    group->bits &= ~bits;
+  }
+  return value;
+}
+
+#endif
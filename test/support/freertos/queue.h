@@ -0,0 +1,64 @@
+#ifndef TEST_SUPPORT_FREERTOS_QUEUE_H
+#define TEST_SUPPORT_FREERTOS_QUEUE_H
+
+#include <freertos/FreeRTOS.h>
+
+struct QueueDefinition {
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t item_size;
+};
+typedef QueueDefinition *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  QueueHandle_t queue = new QueueDefinition();
+  queue->length = length;
+  queue->item_size = item_size;
+  return queue;
+}
+
+inline void vQueueDelete(QueueHandle_t queue) {
+  delete queue;
+}
+
+inline BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!freertos_host::waitTicks(queue->condition, lock, ticks, [queue]() { return queue->items.size() < queue->length; })) {
+    return pdFALSE;
+  }
+  const uint8_t *bytes = (const uint8_t *)item;
+  queue->items.emplace_back(bytes, bytes + queue->item_size);
+  queue->condition.notify_all();
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+  return xQueueSendToBack(queue, item, ticks);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!freertos_host::waitTicks(queue->condition, lock, ticks, [queue]() { return !queue->items.empty(); })) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->item_size);
+  queue->items.pop_front();
+  queue->condition.notify_all();
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->items.clear();
+  queue->condition.notify_all();
+  return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->items.size();
+}
+
+#endif
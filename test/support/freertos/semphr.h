@@ -0,0 +1,52 @@
+#ifndef TEST_SUPPORT_FREERTOS_SEMPHR_H
+#define TEST_SUPPORT_FREERTOS_SEMPHR_H
+
+#include <freertos/FreeRTOS.h>
+
+struct SemaphoreDefinition {
+  std::mutex mutex;
+  std::condition_variable condition;
+  UBaseType_t count;
+  UBaseType_t max_count;
+};
+typedef SemaphoreDefinition *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+  SemaphoreHandle_t semaphore = new SemaphoreDefinition();
+  semaphore->count = initial_count;
+  semaphore->max_count = max_count;
+  return semaphore;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return xSemaphoreCreateCounting(1, 1);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return xSemaphoreCreateCounting(1, 0);
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+  delete semaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  if (!freertos_host::waitTicks(semaphore->condition, lock, ticks, [semaphore]() { return semaphore->count > 0; })) {
+    return pdFALSE;
+  }
+  semaphore->count--;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if (semaphore->count >= semaphore->max_count) {
+    return pdFALSE;
+  }
+  semaphore->count++;
+  semaphore->condition.notify_all();
+  return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TEST_SUPPORT_FREERTOS_TASK_H
+#define TEST_SUPPORT_FREERTOS_TASK_H
+
+#include <freertos/FreeRTOS.h>
+
+struct TaskControlBlock {
+  std::mutex mutex;
+  std::condition_variable condition;
+  uint32_t notifications = 0;
+};
+typedef TaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+namespace freertos_host {
+inline thread_local TaskHandle_t currentTask = nullptr;
+} // namespace freertos_host
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth, void *param, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+  // The control block is kept for the life of the test process, a handle may be notified after its task has ended
+  TaskHandle_t task = new TaskControlBlock();
+  if (handle != nullptr) {
+    *handle = task;
+  }
+  std::thread([function, param, task]() {
+    freertos_host::currentTask = task;
+    try {
+      function(param);
+    } catch (const freertos_host::TaskDeleted &) {
+    }
+  }).detach();
+  return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth, void *param, UBaseType_t priority, TaskHandle_t *handle) {
+  return xTaskCreatePinnedToCore(function, name, stack_depth, param, priority, handle, CONFIG_ARDUINO_RUNNING_CORE);
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr || task == freertos_host::currentTask) {
+    throw freertos_host::TaskDeleted();
+  }
+  // Deleting another task is not supported on the host, the tests never need it
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return freertos_host::currentTask;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lock(task->mutex);
+  task->notifications++;
+  task->condition.notify_all();
+  return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+  TaskHandle_t task = freertos_host::currentTask;
+  if (task == nullptr) {
+    vTaskDelay(ticks);
+    return 0;
+  }
+  std::unique_lock<std::mutex> lock(task->mutex);
+  freertos_host::waitTicks(task->condition, lock, ticks, [task]() { return task->notifications > 0; });
+  uint32_t value = task->notifications;
+  if (value > 0) {
+    task->notifications = clear_on_exit ? 0 : value - 1;
+  }
+  return value;
+}
+
+#endif
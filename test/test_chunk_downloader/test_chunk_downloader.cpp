@@ -0,0 +1,144 @@
+#include <ChunkDownloader.hpp>
+#include <HttpStandIn.hpp>
+#include <TestImage.hpp>
+#include <unity.h>
+#include <vector>
+
+#define TEST_URL "http://manager.test:8000/download_tft_eu"
+#define TEST_PATH "/download_tft_eu"
+#define TEST_CHUNK_SIZE 4096
+// Ten full chunks and a short last chunk, like a TFT file
+#define TEST_FILE_SIZE (10 * TEST_CHUNK_SIZE + 1000)
+
+static std::vector<uint8_t> reference;
+
+void setUp() {
+  HttpStandIn::reset();
+  reference = TestImage::create(TEST_FILE_SIZE);
+}
+
+void tearDown() {}
+
+static void serve(size_t max_read, std::deque<size_t> drop_after = {}) {
+  HttpStandIn::File file;
+  file.body = reference;
+  file.max_read = max_read;
+  file.drop_after = drop_after;
+  HttpStandIn::serve(TEST_PATH, file);
+}
+
+/// @brief Read chunks until the downloader reports the end of the file
+static std::vector<uint8_t> readToEnd(ChunkDownloader *downloader, std::vector<uint16_t> *chunk_sizes = nullptr) {
+  std::vector<uint8_t> data;
+  uint8_t buffer[TEST_CHUNK_SIZE];
+  uint16_t read;
+  while ((read = downloader->readNextChunk(buffer, 5000)) > 0) {
+    data.insert(data.end(), buffer, buffer + read);
+    if (chunk_sizes != nullptr) {
+      chunk_sizes->push_back(read);
+    }
+  }
+  return data;
+}
+
+static size_t countRequestsWithRange(const std::string &range) {
+  size_t count = 0;
+  for (HttpStandIn::Request &request : HttpStandIn::getRequests()) {
+    if (request.method == "GET" && request.range == range) {
+      count++;
+    }
+  }
+  return count;
+}
+
+void test_short_reads_fill_whole_chunks() {
+  // The stand-in never hands out more than 100 bytes at a time
+  serve(100);
+  ChunkDownloader downloader(TEST_URL, TEST_CHUNK_SIZE, 4);
+  TEST_ASSERT_TRUE(downloader.start());
+  TEST_ASSERT_EQUAL(TEST_FILE_SIZE, downloader.getTotalFileSize());
+
+  std::vector<uint16_t> chunk_sizes;
+  std::vector<uint8_t> data = readToEnd(&downloader, &chunk_sizes);
+  TEST_ASSERT_EQUAL(11, chunk_sizes.size());
+  for (size_t i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(TEST_CHUNK_SIZE, chunk_sizes[i]);
+  }
+  TEST_ASSERT_EQUAL(1000, chunk_sizes[10]);
+  TEST_ASSERT_EQUAL(reference.size(), data.size());
+  TEST_ASSERT_EQUAL_MEMORY(reference.data(), data.data(), reference.size());
+  TEST_ASSERT_EQUAL(0, downloader.getRetries());
+}
+
+void test_resume_after_dropped_stream() {
+  // The first stream drops in the middle of the second chunk, the second before that chunk is complete
+  serve(512, {TEST_CHUNK_SIZE + 904, 3000});
+  ChunkDownloader downloader(TEST_URL, TEST_CHUNK_SIZE, 4);
+  TEST_ASSERT_TRUE(downloader.start());
+
+  std::vector<uint8_t> data = readToEnd(&downloader);
+  TEST_ASSERT_EQUAL(reference.size(), data.size());
+  TEST_ASSERT_EQUAL_MEMORY(reference.data(), data.data(), reference.size());
+  TEST_ASSERT_EQUAL(2, downloader.getRetries());
+  // Both reconnects continue from the start of the chunk that was being filled
+  TEST_ASSERT_EQUAL(1, countRequestsWithRange("bytes=0-"));
+  TEST_ASSERT_EQUAL(2, countRequestsWithRange("bytes=4096-"));
+}
+
+void test_end_of_file_returns_zero_without_waiting() {
+  serve(SIZE_MAX);
+  ChunkDownloader downloader(TEST_URL, TEST_CHUNK_SIZE, 4);
+  TEST_ASSERT_TRUE(downloader.start());
+  readToEnd(&downloader);
+
+  uint8_t buffer[TEST_CHUNK_SIZE];
+  unsigned long start = millis();
+  TEST_ASSERT_EQUAL(0, downloader.readNextChunk(buffer, 5000));
+  TEST_ASSERT_EQUAL(0, downloader.readNextChunk(buffer, 5000));
+  TEST_ASSERT_LESS_THAN(1000, millis() - start);
+  TEST_ASSERT_EQUAL(TEST_FILE_SIZE, downloader.getCurrentChunkPosition());
+}
+
+void test_forward_jump_into_last_chunk() {
+  // Like a 0x08 from the panel asking to continue 3000 bytes before the end, not on a chunk boundary
+  serve(700);
+  ChunkDownloader downloader(TEST_URL, TEST_CHUNK_SIZE, 4);
+  TEST_ASSERT_TRUE(downloader.start());
+
+  uint8_t buffer[TEST_CHUNK_SIZE];
+  TEST_ASSERT_EQUAL(TEST_CHUNK_SIZE, downloader.readNextChunk(buffer, 5000));
+  TEST_ASSERT_EQUAL(TEST_CHUNK_SIZE, downloader.readNextChunk(buffer, 5000));
+
+  uint32_t jump_offset = TEST_FILE_SIZE - 3000;
+  downloader.seek(jump_offset);
+  TEST_ASSERT_EQUAL(jump_offset, downloader.getCurrentChunkPosition());
+  TEST_ASSERT_EQUAL(3000, downloader.readNextChunk(buffer, 5000));
+  TEST_ASSERT_EQUAL_MEMORY(&reference[jump_offset], buffer, 3000);
+  TEST_ASSERT_EQUAL(0, downloader.readNextChunk(buffer, 5000));
+  TEST_ASSERT_EQUAL(1, countRequestsWithRange("bytes=" + std::to_string(jump_offset) + "-"));
+}
+
+void test_seek_to_next_chunk_keeps_prefetched_data() {
+  serve(SIZE_MAX);
+  ChunkDownloader downloader(TEST_URL, TEST_CHUNK_SIZE, 4);
+  TEST_ASSERT_TRUE(downloader.start());
+
+  uint8_t buffer[TEST_CHUNK_SIZE];
+  TEST_ASSERT_EQUAL(TEST_CHUNK_SIZE, downloader.readNextChunk(buffer, 5000));
+  downloader.seek(TEST_CHUNK_SIZE);
+  TEST_ASSERT_EQUAL(TEST_CHUNK_SIZE, downloader.readNextChunk(buffer, 5000));
+  TEST_ASSERT_EQUAL_MEMORY(&reference[TEST_CHUNK_SIZE], buffer, TEST_CHUNK_SIZE);
+  // Only the stream opened by start() was used
+  TEST_ASSERT_EQUAL(1, countRequestsWithRange("bytes=0-"));
+  TEST_ASSERT_EQUAL(0, countRequestsWithRange("bytes=4096-"));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_short_reads_fill_whole_chunks);
+  RUN_TEST(test_resume_after_dropped_stream);
+  RUN_TEST(test_end_of_file_returns_zero_without_waiting);
+  RUN_TEST(test_forward_jump_into_last_chunk);
+  RUN_TEST(test_seek_to_next_chunk_keeps_prefetched_data);
+  return UNITY_END();
+}
@@ -0,0 +1,98 @@
+#include <HeatshrinkDecoder.hpp>
+#include <HeatshrinkTestEncoder.hpp>
+#include <TestImage.hpp>
+#include <unity.h>
+#include <vector>
+
+void setUp() {}
+
+void tearDown() {}
+
+/// @brief Decompress all of input, feeding the decoder input_step compressed bytes and output_step bytes of output space at a time
+static std::vector<uint8_t> decompressAll(HeatshrinkDecoder *decoder, const std::vector<uint8_t> &input, size_t input_step, size_t output_step, size_t expected_size) {
+  std::vector<uint8_t> output;
+  std::vector<uint8_t> buffer(output_step);
+  size_t input_position = 0;
+  while (output.size() < expected_size) {
+    size_t input_size = input.size() - input_position < input_step ? input.size() - input_position : input_step;
+    size_t consumed = 0;
+    size_t written = decoder->decompress(&input.data()[input_position], input_size, &consumed, buffer.data(), buffer.size());
+    input_position += consumed;
+    output.insert(output.end(), buffer.begin(), buffer.begin() + written);
+    if (written == 0 && consumed == 0) {
+      // Out of input, the rest of the last byte is padding
+      break;
+    }
+  }
+  return output;
+}
+
+static void assertDecompressesToReference(const std::vector<uint8_t> &reference, uint8_t window_bits, uint8_t lookahead_bits, size_t input_step, size_t output_step) {
+  std::vector<uint8_t> compressed = HeatshrinkTestEncoder::encode(reference, window_bits, lookahead_bits);
+  HeatshrinkDecoder decoder(window_bits, lookahead_bits);
+  TEST_ASSERT_TRUE(decoder.isValid());
+  std::vector<uint8_t> output = decompressAll(&decoder, compressed, input_step, output_step, reference.size());
+  TEST_ASSERT_EQUAL(reference.size(), output.size());
+  TEST_ASSERT_EQUAL(reference.size(), decoder.getTotalOutput());
+  TEST_ASSERT_EQUAL_MEMORY(reference.data(), output.data(), reference.size());
+}
+
+void test_known_vector() {
+  // 'a' as a literal, then a back-reference to offset 1 with count 9:
+  // 1 01100001 | 0 0000000000 01000 | padding
+  const std::vector<uint8_t> compressed = {0xB0, 0x80, 0x04, 0x00};
+  HeatshrinkDecoder decoder(10, 5);
+  std::vector<uint8_t> output = decompressAll(&decoder, compressed, compressed.size(), 64, 10);
+  TEST_ASSERT_EQUAL(10, output.size());
+  TEST_ASSERT_EQUAL_MEMORY("aaaaaaaaaa", output.data(), 10);
+}
+
+void test_invalid_parameters() {
+  HeatshrinkDecoder too_small_window(HEATSHRINK_MIN_WINDOW_BITS - 1, 3);
+  TEST_ASSERT_FALSE(too_small_window.isValid());
+  HeatshrinkDecoder too_large_window(HEATSHRINK_MAX_WINDOW_BITS + 1, 5);
+  TEST_ASSERT_FALSE(too_large_window.isValid());
+  HeatshrinkDecoder lookahead_not_smaller_than_window(8, 8);
+  TEST_ASSERT_FALSE(lookahead_not_smaller_than_window.isValid());
+}
+
+void test_reference_image_default_parameters() {
+  assertDecompressesToReference(TestImage::create(64 * 1024), HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS, 1024, 4096);
+}
+
+void test_reference_image_small_window() {
+  assertDecompressesToReference(TestImage::create(16 * 1024), 8, 4, 1024, 4096);
+}
+
+void test_reference_image_split_input_and_output() {
+  // Odd step sizes split bit fields, literals and back-references across calls
+  std::vector<uint8_t> reference = TestImage::create(16 * 1024);
+  assertDecompressesToReference(reference, HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS, 1, 4096);
+  assertDecompressesToReference(reference, HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS, 1024, 1);
+  assertDecompressesToReference(reference, HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS, 7, 13);
+}
+
+void test_reset_between_streams() {
+  std::vector<uint8_t> first = TestImage::create(8 * 1024, 1);
+  std::vector<uint8_t> second = TestImage::create(8 * 1024, 2);
+  HeatshrinkDecoder decoder;
+  std::vector<uint8_t> output = decompressAll(&decoder, HeatshrinkTestEncoder::encode(first, HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS), 1024, 4096, first.size());
+  TEST_ASSERT_EQUAL_MEMORY(first.data(), output.data(), first.size());
+
+  decoder.reset();
+  TEST_ASSERT_EQUAL(0, decoder.getTotalOutput());
+  output = decompressAll(&decoder, HeatshrinkTestEncoder::encode(second, HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS), 1024, 4096, second.size());
+  TEST_ASSERT_EQUAL(second.size(), output.size());
+  TEST_ASSERT_EQUAL_MEMORY(second.data(), output.data(), second.size());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_known_vector);
+  RUN_TEST(test_invalid_parameters);
+  RUN_TEST(test_reference_image_default_parameters);
+  RUN_TEST(test_reference_image_small_window);
+  RUN_TEST(test_reference_image_split_input_and_output);
+  RUN_TEST(test_reset_between_streams);
+  return UNITY_END();
+}
@@ -0,0 +1,162 @@
+#include <HeatshrinkDownloader.hpp>
+#include <HeatshrinkTestEncoder.hpp>
+#include <HttpStandIn.hpp>
+#include <TestImage.hpp>
+#include <unity.h>
+#include <vector>
+
+#define TEST_URL "http://manager.test:8000/download_firmware?compressed=heatshrink"
+#define TEST_PATH "/download_firmware?compressed=heatshrink"
+#define TEST_IMAGE_SIZE (48 * 1024 + 123)
+#define TEST_BLOCK_SIZE 4096
+
+static std::vector<uint8_t> reference;
+static std::vector<uint8_t> compressed;
+
+void setUp() {
+  HttpStandIn::reset();
+}
+
+void tearDown() {}
+
+static void serve(uint8_t window_bits, uint8_t lookahead_bits, size_t max_read, std::deque<size_t> drop_after = {}) {
+  compressed = HeatshrinkTestEncoder::encode(reference, window_bits, lookahead_bits);
+  HttpStandIn::File file;
+  file.body = compressed;
+  file.ranges = false;
+  file.max_read = max_read;
+  file.drop_after = drop_after;
+  file.headers["X-Uncompressed-Length"] = std::to_string(reference.size());
+  file.headers["X-Heatshrink-Window"] = std::to_string(window_bits);
+  file.headers["X-Heatshrink-Lookahead"] = std::to_string(lookahead_bits);
+  HttpStandIn::serve(TEST_PATH, file);
+}
+
+/// @brief Read the rest of the image in blocks, the way the firmware and TFT updates consume the stream
+static std::vector<uint8_t> readToEnd(HeatshrinkDownloader *downloader) {
+  std::vector<uint8_t> data;
+  uint8_t buffer[TEST_BLOCK_SIZE];
+  while (downloader->getPosition() < downloader->getUncompressedSize()) {
+    size_t read = downloader->read(buffer, sizeof(buffer));
+    if (read == 0) {
+      break;
+    }
+    data.insert(data.end(), buffer, buffer + read);
+  }
+  return data;
+}
+
+static size_t countGetRequests() {
+  size_t count = 0;
+  for (HttpStandIn::Request &request : HttpStandIn::getRequests()) {
+    count += request.method == "GET" ? 1 : 0;
+  }
+  return count;
+}
+
+void test_decompresses_image_to_reference() {
+  serve(HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS, SIZE_MAX);
+  HeatshrinkDownloader downloader(TEST_URL);
+  TEST_ASSERT_TRUE(downloader.open());
+  TEST_ASSERT_EQUAL(reference.size(), downloader.getUncompressedSize());
+
+  std::vector<uint8_t> data = readToEnd(&downloader);
+  TEST_ASSERT_EQUAL(reference.size(), data.size());
+  TEST_ASSERT_EQUAL_MEMORY(reference.data(), data.data(), reference.size());
+  TEST_ASSERT_EQUAL(compressed.size(), downloader.getCompressedBytesReceived());
+  TEST_ASSERT_LESS_THAN(reference.size(), compressed.size());
+}
+
+void test_parameters_from_headers_and_short_reads() {
+  serve(8, 4, 37);
+  HeatshrinkDownloader downloader(TEST_URL);
+  TEST_ASSERT_TRUE(downloader.open());
+  std::vector<uint8_t> data = readToEnd(&downloader);
+  TEST_ASSERT_EQUAL(reference.size(), data.size());
+  TEST_ASSERT_EQUAL_MEMORY(reference.data(), data.data(), reference.size());
+}
+
+void test_uncompressed_response_is_rejected() {
+  // A manager that doesn't support compression answers with the plain file
+  HttpStandIn::File file;
+  file.body = reference;
+  HttpStandIn::serve(TEST_PATH, file);
+  HeatshrinkDownloader downloader(TEST_URL);
+  TEST_ASSERT_FALSE(downloader.open());
+}
+
+void test_seek_forward_and_backward() {
+  serve(HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS, 512);
+  HeatshrinkDownloader downloader(TEST_URL);
+  TEST_ASSERT_TRUE(downloader.open());
+  uint8_t buffer[TEST_BLOCK_SIZE];
+
+  // Forward, like a 0x08 jump from the panel, decompresses and discards on the same stream
+  TEST_ASSERT_TRUE(downloader.seek(20000));
+  TEST_ASSERT_EQUAL(TEST_BLOCK_SIZE, downloader.read(buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_MEMORY(&reference[20000], buffer, TEST_BLOCK_SIZE);
+  TEST_ASSERT_EQUAL(1, countGetRequests());
+
+  // Backward restarts the stream
+  TEST_ASSERT_TRUE(downloader.seek(1000));
+  TEST_ASSERT_EQUAL(1000, downloader.getPosition());
+  TEST_ASSERT_EQUAL(TEST_BLOCK_SIZE, downloader.read(buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_MEMORY(&reference[1000], buffer, TEST_BLOCK_SIZE);
+  TEST_ASSERT_EQUAL(2, countGetRequests());
+}
+
+void test_restart_after_dropped_stream() {
+  // The first stream drops half way, as in WebManager::_updateFromCompressed the read comes back short and the stream is
+  // restarted at the last position written
+  serve(HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS, 700, {HeatshrinkTestEncoder::encode(reference, HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS).size() / 2});
+  HeatshrinkDownloader downloader(TEST_URL);
+  TEST_ASSERT_TRUE(downloader.open());
+
+  std::vector<uint8_t> written;
+  uint8_t buffer[TEST_BLOCK_SIZE];
+  uint8_t failed_reads = 0;
+  while (written.size() < reference.size() && failed_reads < 3) {
+    size_t read_size = reference.size() - written.size() < sizeof(buffer) ? reference.size() - written.size() : sizeof(buffer);
+    if (downloader.read(buffer, read_size) != read_size) {
+      failed_reads++;
+      TEST_ASSERT_TRUE(downloader.seek(written.size()));
+      continue;
+    }
+    failed_reads = 0;
+    written.insert(written.end(), buffer, buffer + read_size);
+  }
+  TEST_ASSERT_EQUAL(reference.size(), written.size());
+  TEST_ASSERT_EQUAL_MEMORY(reference.data(), written.data(), reference.size());
+  TEST_ASSERT_EQUAL(2, countGetRequests());
+}
+
+void test_seek_to_current_position_after_dropped_stream() {
+  // When the stream drops exactly where the last block ended the read returns nothing, seeking to the same position must
+  // still restart the stream instead of reading from the dropped one again
+  serve(HEATSHRINK_DEFAULT_WINDOW_BITS, HEATSHRINK_DEFAULT_LOOKAHEAD_BITS, SIZE_MAX, {1000});
+  HeatshrinkDownloader downloader(TEST_URL);
+  TEST_ASSERT_TRUE(downloader.open());
+  uint8_t buffer[TEST_BLOCK_SIZE];
+  downloader.read(buffer, sizeof(buffer));
+  size_t position = downloader.getPosition();
+  TEST_ASSERT_LESS_THAN(TEST_BLOCK_SIZE, position);
+  TEST_ASSERT_EQUAL(0, downloader.read(buffer, sizeof(buffer)));
+
+  TEST_ASSERT_TRUE(downloader.seek(position));
+  TEST_ASSERT_EQUAL(position, downloader.getPosition());
+  TEST_ASSERT_EQUAL(TEST_BLOCK_SIZE, downloader.read(buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_MEMORY(&reference[position], buffer, TEST_BLOCK_SIZE);
+  TEST_ASSERT_EQUAL(2, countGetRequests());
+}
+
+int main(int argc, char **argv) {
+  reference = TestImage::create(TEST_IMAGE_SIZE);
+  UNITY_BEGIN();
+  RUN_TEST(test_decompresses_image_to_reference);
+  RUN_TEST(test_parameters_from_headers_and_short_reads);
+  RUN_TEST(test_uncompressed_response_is_rejected);
+  RUN_TEST(test_seek_forward_and_backward);
+  RUN_TEST(test_restart_after_dropped_stream);
+  RUN_TEST(test_seek_to_current_position_after_dropped_stream);
+  return UNITY_END();
+}
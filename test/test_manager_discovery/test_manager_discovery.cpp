@@ -0,0 +1,112 @@
+#include <ConnectionState.hpp>
+#include <ESPmDNS.h>
+#include <HttpStandIn.hpp>
+#include <ManagerDiscovery.hpp>
+#include <NSPMConfig.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+// ManagerDiscovery keeps the manager in static state for the life of the firmware, so the tests run in order:
+// nothing known, then discovered, then registered.
+
+static NSPMConfig config;
+
+void setUp() {
+  MdnsStandIn::reset();
+  HttpStandIn::reset();
+}
+
+void tearDown() {}
+
+/// @brief Wait for the discovery task to finish its queries and act on them
+static void waitForDiscoveryTask() {
+  vTaskDelay(200 / portTICK_PERIOD_MS);
+}
+
+void test_discover_finds_stand_in_responder() {
+  MdnsStandIn::advertise("nspanelmanager", "tcp", IPAddress(192, 168, 1, 20), 8001);
+  std::string address;
+  uint16_t port = 0;
+  TEST_ASSERT_TRUE(ManagerDiscovery::discover(&address, &port));
+  TEST_ASSERT_EQUAL_STRING("192.168.1.20", address.c_str());
+  TEST_ASSERT_EQUAL(8001, port);
+}
+
+void test_discover_ignores_other_services() {
+  std::string address;
+  uint16_t port = 0;
+  TEST_ASSERT_FALSE(ManagerDiscovery::discover(&address, &port));
+  MdnsStandIn::advertise("http", "tcp", IPAddress(192, 168, 1, 30), 80);
+  MdnsStandIn::advertise("nspanelmanager", "udp", IPAddress(192, 168, 1, 31), 8000);
+  TEST_ASSERT_FALSE(ManagerDiscovery::discover(&address, &port));
+  TEST_ASSERT_FALSE(ManagerDiscovery::getManager(&address, &port));
+  TEST_ASSERT_EQUAL_STRING("", ManagerDiscovery::getManagerUrl().c_str());
+}
+
+void test_task_discovers_manager_and_prewarms_connection() {
+  MdnsStandIn::advertise("nspanelmanager", "tcp", IPAddress(192, 168, 1, 20), 8001);
+  HttpStandIn::File root;
+  HttpStandIn::serve("/", root);
+  ConnectionState::set(CONNECTION_STATE_WIFI_CONNECTED);
+  ManagerDiscovery::start();
+  TEST_ASSERT_TRUE(ConnectionState::waitFor(CONNECTION_STATE_MANAGER_KNOWN, 2000 / portTICK_PERIOD_MS));
+  waitForDiscoveryTask();
+
+  TEST_ASSERT_TRUE(ManagerDiscovery::getManagerSource() == ManagerSource::DISCOVERED);
+  TEST_ASSERT_EQUAL_STRING("http://192.168.1.20:8001", ManagerDiscovery::getManagerUrl().c_str());
+  // Only register accept writes the saved manager
+  TEST_ASSERT_EQUAL_STRING("", config.manager_address.c_str());
+  std::vector<HttpStandIn::Request> requests = HttpStandIn::getRequests();
+  TEST_ASSERT_EQUAL(1, requests.size());
+  TEST_ASSERT_EQUAL_STRING("HEAD", requests[0].method.c_str());
+}
+
+void test_saved_manager_does_not_replace_discovered() {
+  TEST_ASSERT_FALSE(ManagerDiscovery::setManager("192.168.1.5", 8000, ManagerSource::SAVED));
+  TEST_ASSERT_EQUAL_STRING("http://192.168.1.20:8001", ManagerDiscovery::getManagerUrl().c_str());
+}
+
+void test_register_accept_replaces_discovered() {
+  TEST_ASSERT_TRUE(ManagerDiscovery::setManager("manager.lan", 8000, ManagerSource::REGISTERED));
+  TEST_ASSERT_TRUE(ManagerDiscovery::getManagerSource() == ManagerSource::REGISTERED);
+  TEST_ASSERT_EQUAL_STRING("http://manager.lan:8000", ManagerDiscovery::getManagerUrl().c_str());
+}
+
+void test_discovery_after_register_accept_is_ignored() {
+  MdnsStandIn::advertise("nspanelmanager", "tcp", IPAddress(192, 168, 1, 40), 9000);
+  ManagerDiscovery::start();
+  waitForDiscoveryTask();
+  // Once registered the task doesn't even query
+  TEST_ASSERT_EQUAL(0, MdnsStandIn::getQueries());
+
+  // Discoveries racing a register accept never win, whatever order they finish in
+  std::vector<std::thread> discoveries;
+  for (int i = 0; i < 8; i++) {
+    discoveries.emplace_back([i]() {
+      ManagerDiscovery::setManager("192.168.1." + std::to_string(100 + i), 9000, ManagerSource::DISCOVERED);
+    });
+  }
+  ManagerDiscovery::setManager("manager.lan", 8000, ManagerSource::REGISTERED);
+  for (std::thread &discovery : discoveries) {
+    discovery.join();
+  }
+  std::string address;
+  uint16_t port;
+  TEST_ASSERT_TRUE(ManagerDiscovery::getManager(&address, &port));
+  TEST_ASSERT_EQUAL_STRING("manager.lan", address.c_str());
+  TEST_ASSERT_EQUAL(8000, port);
+}
+
+int main(int argc, char **argv) {
+  NSPMConfig::instance = &config;
+  ConnectionState::init();
+  UNITY_BEGIN();
+  RUN_TEST(test_discover_finds_stand_in_responder);
+  RUN_TEST(test_discover_ignores_other_services);
+  RUN_TEST(test_task_discovers_manager_and_prewarms_connection);
+  RUN_TEST(test_saved_manager_does_not_replace_discovered);
+  RUN_TEST(test_register_accept_replaces_discovered);
+  RUN_TEST(test_discovery_after_register_accept_is_ignored);
+  return UNITY_END();
+}
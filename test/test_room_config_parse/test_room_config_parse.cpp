@@ -0,0 +1,273 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LightConfig.hpp>
+#include <RoomConfigFilter.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+// Compares loading the room configs of a 300 light house the way RoomManager did before configs were filtered (whole body
+// buffered, unfiltered document, a std::map of strings per light) with how it does now (streamed through RoomConfigFilter,
+// lights read straight from the document). Peak heap and parse time are printed, run with "pio test -e native -v" to see them.
+
+#define ROOMS 20
+#define LIGHTS_PER_ROOM 15
+#define SCENES_PER_ROOM 4
+#define ITERATIONS 20
+
+// Heap in use and its peak, counting both operator new and the documents' allocator
+static size_t heapInUse = 0;
+static size_t heapPeak = 0;
+
+static void *trackedAllocate(size_t size) {
+  max_align_t *block = (max_align_t *)malloc(sizeof(max_align_t) + size);
+  if (block == nullptr) {
+    return nullptr;
+  }
+  *(size_t *)block = size;
+  heapInUse += size;
+  heapPeak = heapInUse > heapPeak ? heapInUse : heapPeak;
+  return block + 1;
+}
+
+static void trackedFree(void *pointer) {
+  if (pointer == nullptr) {
+    return;
+  }
+  max_align_t *block = (max_align_t *)pointer - 1;
+  heapInUse -= *(size_t *)block;
+  free(block);
+}
+
+static void *trackedReallocate(void *pointer, size_t size) {
+  if (pointer == nullptr) {
+    return trackedAllocate(size);
+  }
+  max_align_t *block = (max_align_t *)pointer - 1;
+  size_t old_size = *(size_t *)block;
+  block = (max_align_t *)realloc(block, sizeof(max_align_t) + size);
+  if (block == nullptr) {
+    return nullptr;
+  }
+  *(size_t *)block = size;
+  heapInUse = heapInUse - old_size + size;
+  heapPeak = heapInUse > heapPeak ? heapInUse : heapPeak;
+  return block + 1;
+}
+
+void *operator new(size_t size) {
+  void *pointer = trackedAllocate(size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void *pointer) noexcept {
+  trackedFree(pointer);
+}
+
+void operator delete(void *pointer, size_t size) noexcept {
+  trackedFree(pointer);
+}
+
+class TrackedAllocator : public ArduinoJson::Allocator {
+public:
+  void *allocate(size_t size) override { return trackedAllocate(size); }
+  void deallocate(void *pointer) override { trackedFree(pointer); }
+  void *reallocate(void *pointer, size_t new_size) override { return trackedReallocate(pointer, new_size); }
+};
+
+static TrackedAllocator allocator;
+
+/// @brief A light read from a room config
+struct LightSettings {
+  uint16_t id;
+  LightConfig config;
+};
+
+/// @brief Reads a response body the way the HTTP connection is read, without holding a copy of it
+class BodyReader {
+public:
+  BodyReader(const std::string &body) : _body(body) {}
+  int read() { return this->_position < this->_body.size() ? (uint8_t)this->_body[this->_position++] : -1; }
+  size_t readBytes(char *buffer, size_t length) {
+    size_t read = this->_body.size() - this->_position < length ? this->_body.size() - this->_position : length;
+    memcpy(buffer, &this->_body[this->_position], read);
+    this->_position += read;
+    return read;
+  }
+
+private:
+  const std::string &_body;
+  size_t _position = 0;
+};
+
+/// @brief A room config as sent by the manager, including the fields it sends for its own use that the panel never reads
+static std::string createRoomConfig(uint16_t room_id) {
+  JsonDocument room;
+  room["name"] = "Room " + std::to_string(room_id);
+  room["id"] = room_id;
+  room["displayed_name"] = "Room " + std::to_string(room_id);
+  for (int i = 0; i < LIGHTS_PER_ROOM; i++) {
+    uint16_t light_id = room_id * 100 + i;
+    JsonObject light = room["lights"][std::to_string(light_id)].to<JsonObject>();
+    light["name"] = "Light " + std::to_string(light_id) + " above the kitchen table";
+    light["can_dim"] = true;
+    light["can_temperature"] = i % 2 == 0;
+    light["can_rgb"] = i % 3 == 0;
+    light["view_position"] = i + 1;
+    light["ceiling"] = i % 4 != 0;
+    light["type"] = "home_assistant";
+    light["home_assistant_name"] = "light.room_" + std::to_string(room_id) + "_light_" + std::to_string(i);
+    light["openhab_name"] = "";
+    light["openhab_item_switch"] = "";
+    light["openhab_item_dimmer"] = "";
+    light["openhab_item_color_temp"] = "";
+    light["openhab_item_rgb"] = "";
+    light["controlled_by_nspanel_main_page"] = true;
+  }
+  for (int i = 0; i < SCENES_PER_ROOM; i++) {
+    JsonObject scene = room["scenes"][std::to_string(room_id * 100 + i)].to<JsonObject>();
+    scene["name"] = "Scene " + std::to_string(i);
+    scene["can_save"] = true;
+    scene["scene_type"] = "nspm_scene";
+    scene["backend_name"] = "";
+  }
+  std::string body;
+  serializeJson(room, body);
+  return body;
+}
+
+/// @brief As the removed Light::initFromMap
+static LightSettings settingsFromMap(std::map<std::string, std::string> &data) {
+  LightConfig config;
+  config.name = data["name"];
+  config.can_dim = data["can_dim"].compare("true") == 0;
+  config.can_temperature = data["can_temperature"].compare("true") == 0;
+  config.can_rgb = data["can_rgb"].compare("true") == 0;
+  config.view_position = atoi(data["view_position"].c_str());
+  config.ceiling = data["ceiling"].compare("true") == 0;
+  return LightSettings{(uint16_t)atoi(data["id"].c_str()), config};
+}
+
+/// @brief Load a room config the way RoomManager did before the filter
+static void loadRoomUnfiltered(const std::string &body, std::vector<LightSettings> *lights) {
+  // HTTPClient::getString buffered the whole body before parsing
+  String payload(body);
+  JsonDocument document(&allocator);
+  TEST_ASSERT_FALSE(deserializeJson(document, payload.c_str()));
+  for (JsonPair lightPair : document["lights"].as<JsonObject>()) {
+    std::map<std::string, std::string> data;
+    data["id"] = lightPair.key().c_str();
+    for (JsonPair field : lightPair.value().as<JsonObject>()) {
+      data[field.key().c_str()] = field.value().as<std::string>();
+    }
+    lights->push_back(settingsFromMap(data));
+  }
+}
+
+/// @brief Load a room config the way RoomManager does now
+static void loadRoomFiltered(const std::string &body, std::vector<LightSettings> *lights) {
+  BodyReader reader(body);
+  JsonDocument document(&allocator);
+  TEST_ASSERT_FALSE(deserializeJson(document, reader, DeserializationOption::Filter(RoomConfigFilter::roomConfig)));
+  for (JsonPairConst lightPair : document["lights"].as<JsonObjectConst>()) {
+    lights->push_back(LightSettings{(uint16_t)atoi(lightPair.key().c_str()), LightConfig::fromJson(lightPair.value().as<JsonObjectConst>())});
+  }
+}
+
+struct LoadResult {
+  size_t peak_bytes;
+  double milliseconds;
+};
+
+/// @brief Load all room configs ITERATIONS times, the peak is of the heap used on top of what was in use before
+static LoadResult loadHouse(void (*loadRoom)(const std::string &, std::vector<LightSettings> *), const std::vector<std::string> &rooms, std::vector<LightSettings> *lights) {
+  lights->reserve(ROOMS * LIGHTS_PER_ROOM);
+  size_t baseline = heapInUse;
+  heapPeak = heapInUse;
+  auto start = std::chrono::steady_clock::now();
+  for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+    lights->clear();
+    for (const std::string &room : rooms) {
+      loadRoom(room, lights);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return LoadResult{heapPeak - baseline, std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS};
+}
+
+static std::vector<std::string> rooms;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_filtered_parse_reads_the_same_lights() {
+  std::vector<LightSettings> unfiltered;
+  std::vector<LightSettings> filtered;
+  for (const std::string &room : rooms) {
+    loadRoomUnfiltered(room, &unfiltered);
+    loadRoomFiltered(room, &filtered);
+  }
+  TEST_ASSERT_EQUAL(ROOMS * LIGHTS_PER_ROOM, filtered.size());
+  TEST_ASSERT_EQUAL(unfiltered.size(), filtered.size());
+  for (size_t i = 0; i < filtered.size(); i++) {
+    TEST_ASSERT_EQUAL(unfiltered[i].id, filtered[i].id);
+    TEST_ASSERT_EQUAL_STRING(unfiltered[i].config.name.c_str(), filtered[i].config.name.c_str());
+    TEST_ASSERT_TRUE(unfiltered[i].config == filtered[i].config);
+  }
+}
+
+void test_light_config_reads_string_values() {
+  JsonDocument light;
+  deserializeJson(light, "{\"name\":\"Desk\",\"can_dim\":\"True\",\"can_temperature\":\"false\",\"can_rgb\":true,\"view_position\":\"7\"}");
+  LightConfig config = LightConfig::fromJson(light.as<JsonObjectConst>());
+  TEST_ASSERT_EQUAL_STRING("Desk", config.name.c_str());
+  TEST_ASSERT_TRUE(config.can_dim);
+  TEST_ASSERT_FALSE(config.can_temperature);
+  TEST_ASSERT_TRUE(config.can_rgb);
+  TEST_ASSERT_EQUAL(7, config.view_position);
+  TEST_ASSERT_FALSE(config.ceiling);
+}
+
+void test_benchmark_300_lights() {
+  size_t total_size = 0;
+  for (const std::string &room : rooms) {
+    total_size += room.size();
+  }
+  std::vector<LightSettings> unfiltered_lights;
+  std::vector<LightSettings> filtered_lights;
+  LoadResult unfiltered = loadHouse(loadRoomUnfiltered, rooms, &unfiltered_lights);
+  LoadResult filtered = loadHouse(loadRoomFiltered, rooms, &filtered_lights);
+
+  char message[160];
+  snprintf(message, sizeof(message), "%d rooms, %d lights, %u bytes of room configs", ROOMS, ROOMS * LIGHTS_PER_ROOM, (unsigned)total_size);
+  TEST_MESSAGE(message);
+  snprintf(message, sizeof(message), "Unfiltered: peak heap %u bytes, %.2f ms per load", (unsigned)unfiltered.peak_bytes, unfiltered.milliseconds);
+  TEST_MESSAGE(message);
+  snprintf(message, sizeof(message), "Filtered:   peak heap %u bytes, %.2f ms per load", (unsigned)filtered.peak_bytes, filtered.milliseconds);
+  TEST_MESSAGE(message);
+
+  // Times depend on the host, only the memory is checked
+  TEST_ASSERT_LESS_THAN(unfiltered.peak_bytes, filtered.peak_bytes);
+}
+
+int main(int argc, char **argv) {
+  RoomConfigFilter::init();
+  for (uint16_t room_id = 1; room_id <= ROOMS; room_id++) {
+    rooms.push_back(createRoomConfig(room_id));
+  }
+  UNITY_BEGIN();
+  RUN_TEST(test_filtered_parse_reads_the_same_lights);
+  RUN_TEST(test_light_config_reads_string_values);
+  RUN_TEST(test_benchmark_300_lights);
+  return UNITY_END();
+}